@@ -0,0 +1,152 @@
+#!/bin/bash
+#bench_script
+#Benchmarks mfind on synthetic trees made by make_tree, for every tree, mode,
+#number of threads and cache state asked for. Each case is run a number of
+#times and reported as one JSON object per line on stdout, so the output of
+#two versions can be diffed or compared by a script:
+#
+#  {"version": ..., "tree": ..., "mode": ..., "threads": ..., "cache": ...,
+#   "runs": ..., "entries": ..., "median_s": ..., "p95_s": ...,
+#   "syscalls_per_entry": ..., "max_rss_kb": ...}
+#
+#The wall time is measured around mfind. The system calls are those of the
+#walk counted by mfind -stats: the opens of directories, the getdents64 or
+#readdir calls and the statx calls, not the reads of files by -grep. The
+#peak memory use is also taken from -stats, the largest of the runs.
+#
+#A warm case is run once before it is measured. A cold case drops the page,
+#dentry and inode caches before each run, which needs root. Put the trees on
+#a tmpfs with -d to leave the disk out of the warm cases.
+#
+#Usage: ./bench_script.sh [-d tree directory] [-s scale] [-r runs]
+#         [-t "trees"] [-m "modes"] [-p "threads"] [-k "caches"]
+#  trees:   wide deep small giant symlinks
+#  modes:   name (-name), stat (-size, a statx per entry), uring (-size with
+#           -u 64), grep (-grep) and namesN (N patterns given with -n, to see
+#           the cost per entry as the patterns grow, for example names1,
+#           names16 and names256)
+#  threads: numbers or auto, for -p
+#  caches:  warm cold
+
+dir=/tmp/mfind_bench
+scale=1
+runs=5
+trees="wide deep small giant symlinks"
+modes="name stat uring grep"
+threads="1 2 4 8 auto"
+caches="warm"
+
+while getopts "d:s:r:t:m:p:k:" opt; do
+	case $opt in
+		d) dir=$OPTARG ;;
+		s) scale=$OPTARG ;;
+		r) runs=$OPTARG ;;
+		t) trees=$OPTARG ;;
+		m) modes=$OPTARG ;;
+		p) threads=$OPTARG ;;
+		k) caches=$OPTARG ;;
+		*) sed -n '/^#Usage/,/^#  caches/s/^#//p' "$0" >&2; exit 1 ;;
+	esac
+done
+
+if [[ ! -x ./mfind || ! -x ./make_tree ]]; then
+	echo "Build mfind and make_tree first, with make bench" >&2
+	exit 1
+fi
+
+if [[ $caches == *cold* && ! -w /proc/sys/vm/drop_caches ]]; then
+	echo "Dropping the caches for the cold cases needs root" >&2
+	exit 1
+fi
+
+version=$(git describe --always --dirty 2> /dev/null || echo unknown)
+stats=$(mktemp)
+trap 'rm -f "$stats"' EXIT
+
+#mode_args mode
+#Prints the options of mfind for a mode.
+mode_args() {
+	case $1 in
+		name) echo "-name *.h" ;;
+		stat) echo "-name * -size +0" ;;
+		uring) echo "-u 64 -name * -size +0" ;;
+		grep) echo "-grep needle -name *.txt" ;;
+		names[0-9]*)
+			#Each pattern matches about one in a thousand .h files
+			for ((i = 0; i < ${1#names}; i++)); do
+				printf -- "-n f*%03d.h " $(( i % 1000 ))
+			done
+			echo ;;
+		*) echo "Invalid mode, got: $1" >&2; exit 1 ;;
+	esac
+}
+
+#json_field name
+#Prints the first number of a field in the -stats file, from the total.
+json_field() {
+	grep -o "\"$1\": [{\"a-z: ]*[0-9.]*" "$stats" | head -n 1 | \
+			grep -o '[0-9.]*$'
+}
+
+mkdir -p "$dir"
+for tree in $trees; do
+	>&2 echo "Making the $tree tree in $dir/$tree"
+	./make_tree -s "$scale" "$tree" "$dir/$tree" || exit 1
+done
+
+for tree in $trees; do
+	for mode in $modes; do
+		args=$(mode_args "$mode") || exit 1
+		for p in $threads; do
+			for cache in $caches; do
+				>&2 echo "$tree $mode -p $p $cache"
+				set -f
+				if [[ $cache == warm ]]; then
+					./mfind -p "$p" $args "$dir/$tree" > /dev/null 2>&1
+				fi
+
+				times=""
+				rss=0
+				for ((run = 0; run < runs; run++)); do
+					if [[ $cache == cold ]]; then
+						sync
+						echo 3 > /proc/sys/vm/drop_caches
+					fi
+					start=$(date +%s%N)
+					./mfind -p "$p" -stats="$stats" $args "$dir/$tree" \
+							> /dev/null 2>&1
+					end=$(date +%s%N)
+					times="$times $(( end - start ))"
+
+					run_rss=$(json_field max_rss_kb)
+					(( run_rss > rss )) && rss=$run_rss
+				done
+				set +f
+
+				entries=$(json_field entries)
+				calls=$(( $(json_field open) + $(json_field getdents) + \
+						$(json_field stat_calls) ))
+
+				echo $times | tr ' ' '\n' | sort -n | awk \
+						-v v="$version" -v t="$tree" -v m="$mode" -v p="$p" \
+						-v c="$cache" -v e="$entries" -v s="$calls" \
+						-v r="$rss" '
+					{ns[NR] = $1}
+					END{
+						mid = int((NR + 1) / 2)
+						median = (NR % 2) ? ns[mid] : (ns[mid] + ns[mid + 1]) / 2
+						p95 = ns[int(NR * 0.95 + 0.999999)]
+						printf "{\"version\": \"%s\", \"tree\": \"%s\", " \
+								"\"mode\": \"%s\", \"threads\": \"%s\", " \
+								"\"cache\": \"%s\", \"runs\": %d, " \
+								"\"entries\": %d, \"median_s\": %.4f, " \
+								"\"p95_s\": %.4f, " \
+								"\"syscalls_per_entry\": %.4f, " \
+								"\"max_rss_kb\": %d}\n", v, t, m, p, c, NR, \
+								e, median / 1e9, p95 / 1e9, \
+								(e > 0) ? s / e : 0, r
+					}'
+			done
+		done
+	done
+done
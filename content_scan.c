@@ -0,0 +1,240 @@
+#include "content_scan.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * A search for a text in the contents of regular files, like grep -F -q. The
+ * file is read in large blocks with pread(), and each block is scanned with
+ * memchr() for the byte of the text least likely to be common, and only where
+ * that byte is found is the whole text compared. The scan stops at the first
+ * hit. The end of a block is kept at the start of the next one, so a hit
+ * spanning two blocks is not missed. Files over a size cap are not read.
+ *
+ * A pattern is only read once created, so any number of threads may share
+ * it, while each thread scans with its own scanner.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The pattern type.
+struct content_pattern{
+	size_t len;
+	size_t rare; //Where the byte looked for with memchr() is in the text
+	char text[];
+};
+
+// The scanner type.
+struct content_scanner{
+	const content_pattern *p;
+	char *buf; //Room for a block and the end of the one before
+};
+
+/**
+ * byte_rank() - Guesses how common a byte is in files, from 0 for rare to 3
+ * for the most common bytes of text.
+ * @c: The byte.
+ * Returns: The rank.
+ */
+static int byte_rank(unsigned char c){
+	if(strchr(" etaoinsrhl\n", c) != NULL){
+		return 3;
+	}
+	if(((c >= 'a') && (c <= 'z')) || (strchr("\t_.,", c) != NULL)){
+		return 2;
+	}
+	if(((c >= 'A') && (c <= 'Z')) || ((c >= '0') && (c <= '9')) ||
+			(strchr("/()=;:\"'-", c) != NULL)){
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * find_text() - Looks for the text in a buffer.
+ * @p: The pattern.
+ * @buf: The buffer.
+ * @len: The number of bytes in the buffer.
+ * Returns: true if the text is in the buffer, else false.
+ */
+static bool find_text(const content_pattern *p, const char *buf, size_t len){
+	if(len < p->len){
+		return false;
+	}
+
+	//The rare byte can only be this far into the buffer for a hit
+	const char *pos = buf + p->rare;
+	const char *end = buf + len - (p->len - 1 - p->rare);
+	char rare = p->text[p->rare];
+
+	while((pos = memchr(pos, rare, (size_t)(end - pos))) != NULL){
+		if(memcmp(pos - p->rare, p->text, p->len) == 0){
+			return true;
+		}
+		pos++;
+	}
+
+	return false;
+}
+
+/**
+ * content_pattern_new() - Create a new pattern.
+ * @text: The text to search for, which must not be empty.
+ * Returns: A pointer to the new pattern, or NULL if the text is empty or
+ * longer than CONTENT_SCAN_MAX_TEXT.
+ */
+content_pattern *content_pattern_new(const char *text){
+	size_t len = strlen(text);
+
+	if((len == 0) || (len > CONTENT_SCAN_MAX_TEXT)){
+		return NULL;
+	}
+
+	content_pattern *p = malloc(sizeof(*p) + len + 1);
+	if(p == NULL){
+		perror("content_scan.c");
+		exit(errno);
+	}
+
+	p->len = len;
+	memcpy(p->text, text, len + 1);
+
+	//The last of the rarest, so a miss skips the most
+	p->rare = 0;
+	for(size_t i = 1; i < len; i++){
+		if(byte_rank((unsigned char)text[i]) <=
+				byte_rank((unsigned char)text[p->rare])){
+			p->rare = i;
+		}
+	}
+
+	return p;
+}
+
+/**
+ * content_pattern_kill() - Removes the pattern. All its scanners must be
+ * removed first.
+ * @p: The pattern which to remove, or NULL.
+ */
+void content_pattern_kill(content_pattern *p){
+	free(p);
+}
+
+/**
+ * content_scanner_new() - Create a new scanner, for one thread.
+ * @p: The pattern to search for.
+ * Returns: A pointer to the new scanner.
+ */
+content_scanner *content_scanner_new(const content_pattern *p){
+	content_scanner *s = malloc(sizeof(*s));
+	if(s == NULL){
+		perror("content_scan.c");
+		exit(errno);
+	}
+
+	s->p = p;
+	s->buf = malloc(CONTENT_SCAN_BLOCK_SIZE + p->len);
+	if(s->buf == NULL){
+		perror("content_scan.c");
+		exit(errno);
+	}
+
+	return s;
+}
+
+/**
+ * content_scanner_scan() - Searches a file for the text. Anything but a
+ * regular file never holds it, and neither does a file larger than the cap.
+ * @s: The scanner.
+ * @dir_fd: An open file descriptor of the directory holding the file, or
+ * AT_FDCWD.
+ * @name: The name of the file in the directory.
+ * @max_size: The size cap in bytes, or 0 for none.
+ * @follow_links: true if a symbolic link is followed to the file it points
+ * to, false if the link itself is taken, which holds no text.
+ * Returns: 1 if the file holds the text, 0 if it does not or -1 on failure
+ * with errno set.
+ */
+int content_scanner_scan(content_scanner *s, int dir_fd, const char *name,
+		off_t max_size, bool follow_links){
+	struct stat info;
+	size_t kept = 0; //The end of the block before
+	off_t offset = 0;
+	int found = 0;
+
+	//A file swapped for a fifo or a device must not block or be opened
+	int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC | O_NOCTTY |
+			(follow_links ? 0 : O_NOFOLLOW) | O_NONBLOCK);
+	if(fd < 0){
+		return -1;
+	}
+
+	if(fstat(fd, &info) < 0){
+		int saved = errno;
+		close(fd);
+		errno = saved;
+		return -1;
+	}
+	if(!S_ISREG(info.st_mode) || (info.st_size < (off_t)s->p->len) ||
+			((max_size > 0) && (info.st_size > max_size))){
+		close(fd);
+		return 0;
+	}
+
+	if(info.st_size > CONTENT_SCAN_BLOCK_SIZE){
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	}
+
+	while(found == 0){
+		ssize_t n = pread(fd, s->buf + kept, CONTENT_SCAN_BLOCK_SIZE, offset);
+		if(n < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			found = -1;
+			break;
+		}
+		if(n == 0){
+			break;
+		}
+
+		size_t len = kept + (size_t)n;
+		if(find_text(s->p, s->buf, len)){
+			found = 1;
+			break;
+		}
+
+		offset += n;
+		kept = (len < s->p->len - 1) ? len : s->p->len - 1;
+		memmove(s->buf, s->buf + len - kept, kept);
+	}
+
+	if(found < 0){
+		int saved = errno;
+		close(fd);
+		errno = saved;
+		return -1;
+	}
+	close(fd);
+
+	return found;
+}
+
+/**
+ * content_scanner_kill() - Removes the scanner.
+ * @s: The scanner which to remove, or NULL.
+ */
+void content_scanner_kill(content_scanner *s){
+	if(s == NULL){
+		return;
+	}
+
+	free(s->buf);
+	free(s);
+}
@@ -0,0 +1,77 @@
+#ifndef __CONTENT_SCAN_H_
+#define __CONTENT_SCAN_H_
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/*
+ * A search for a text in the contents of regular files, like grep -F -q. The
+ * file is read in large blocks with pread(), and each block is scanned with
+ * memchr() for the byte of the text least likely to be common, and only where
+ * that byte is found is the whole text compared. The scan stops at the first
+ * hit. The end of a block is kept at the start of the next one, so a hit
+ * spanning two blocks is not missed. Files over a size cap are not read.
+ *
+ * A pattern is only read once created, so any number of threads may share
+ * it, while each thread scans with its own scanner.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The number of bytes read at a time.
+#define CONTENT_SCAN_BLOCK_SIZE (256 * 1024)
+
+// The longest text which can be searched for.
+#define CONTENT_SCAN_MAX_TEXT 4096
+
+// The pattern type.
+typedef struct content_pattern content_pattern;
+
+// The scanner type.
+typedef struct content_scanner content_scanner;
+
+/**
+ * content_pattern_new() - Create a new pattern.
+ * @text: The text to search for, which must not be empty.
+ * Returns: A pointer to the new pattern, or NULL if the text is empty or
+ * longer than CONTENT_SCAN_MAX_TEXT.
+ */
+content_pattern *content_pattern_new(const char *text);
+
+/**
+ * content_pattern_kill() - Removes the pattern. All its scanners must be
+ * removed first.
+ * @p: The pattern which to remove, or NULL.
+ */
+void content_pattern_kill(content_pattern *p);
+
+/**
+ * content_scanner_new() - Create a new scanner, for one thread.
+ * @p: The pattern to search for.
+ * Returns: A pointer to the new scanner.
+ */
+content_scanner *content_scanner_new(const content_pattern *p);
+
+/**
+ * content_scanner_scan() - Searches a file for the text. Anything but a
+ * regular file never holds it, and neither does a file larger than the cap.
+ * @s: The scanner.
+ * @dir_fd: An open file descriptor of the directory holding the file, or
+ * AT_FDCWD.
+ * @name: The name of the file in the directory.
+ * @max_size: The size cap in bytes, or 0 for none.
+ * @follow_links: true if a symbolic link is followed to the file it points
+ * to, false if the link itself is taken, which holds no text.
+ * Returns: 1 if the file holds the text, 0 if it does not or -1 on failure
+ * with errno set.
+ */
+int content_scanner_scan(content_scanner *s, int dir_fd, const char *name,
+		off_t max_size, bool follow_links);
+
+/**
+ * content_scanner_kill() - Removes the scanner.
+ * @s: The scanner which to remove, or NULL.
+ */
+void content_scanner_kill(content_scanner *s);
+
+#endif //__CONTENT_SCAN_H_
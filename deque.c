@@ -0,0 +1,208 @@
+#include "deque.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/*
+ * A work-stealing deque which can store any given object. The deque has one
+ * owner thread which pushes and pops at the bottom end (LIFO), while any other
+ * thread may steal from the top end (FIFO). The owner operations take no lock,
+ * and a steal only competes with other thieves and with the owner when the
+ * deque holds a single element. This is the Chase-Lev deque, written with C11
+ * atomics. The objects given to the deque will not be freed, so the user of
+ * this deque should handle that.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The size of the first buffer. Must be a power of two.
+#define DEQUE_INITIAL_SIZE 64
+
+// The circular buffer holding the elements.
+struct deque_buffer{
+	long size; //Always a power of two.
+	struct deque_buffer *prev; //Older, smaller buffer still kept alive.
+	_Atomic(void *) slots[];
+};
+
+// The deque type.
+struct deque{
+	atomic_long top;
+	atomic_long bottom;
+	_Atomic(struct deque_buffer *) buffer;
+};
+
+/**
+ * buffer_new() - Creates a new buffer with the given size.
+ * @size: The number of slots in the buffer.
+ * Returns: A pointer to the new buffer.
+ */
+static struct deque_buffer *buffer_new(long size){
+	struct deque_buffer *b = calloc(1, sizeof(*b) + size * sizeof(b->slots[0]));
+	if(b == NULL){
+		perror("deque.c");
+		exit(errno);
+	}
+	b->size = size;
+
+	return b;
+}
+
+/**
+ * buffer_grow() - Creates a buffer twice the size of the given one and copies
+ * the elements between top and bottom into it. The old buffer is not freed
+ * since a thief might still be reading from it, it is freed with the deque.
+ * @old: The full buffer.
+ * @top: The top index of the deque.
+ * @bottom: The bottom index of the deque.
+ * Returns: A pointer to the new buffer.
+ */
+static struct deque_buffer *buffer_grow(struct deque_buffer *old, long top,
+		long bottom){
+	struct deque_buffer *b = buffer_new(old->size * 2);
+
+	for(long i = top; i < bottom; i++){
+		void *val = atomic_load_explicit(&old->slots[i & (old->size - 1)],
+				memory_order_relaxed);
+		atomic_store_explicit(&b->slots[i & (b->size - 1)], val,
+				memory_order_relaxed);
+	}
+	b->prev = old;
+
+	return b;
+}
+
+/**
+ * deque_new() - Create a new and empty deque.
+ * Returns: A pointer to the new deque.
+ */
+deque *deque_new(void){
+	deque *d = calloc(1, sizeof(*d));
+	if(d == NULL){
+		perror("deque.c");
+		exit(errno);
+	}
+
+	atomic_init(&d->top, 0);
+	atomic_init(&d->bottom, 0);
+	atomic_init(&d->buffer, buffer_new(DEQUE_INITIAL_SIZE));
+
+	return d;
+}
+
+/**
+ * deque_push() - Adds a value at the bottom of the deque. May only be called
+ * by the owner of the deque. The deque grows when it is full.
+ * @d: The deque which to add the value to.
+ * @val: A value to add, must not be NULL.
+ */
+void deque_push(deque *d, void *val){
+	long bottom = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+	long top = atomic_load_explicit(&d->top, memory_order_acquire);
+	struct deque_buffer *b = atomic_load_explicit(&d->buffer,
+			memory_order_relaxed);
+
+	if(bottom - top > b->size - 1){ //Full
+		b = buffer_grow(b, top, bottom);
+		atomic_store_explicit(&d->buffer, b, memory_order_release);
+	}
+
+	atomic_store_explicit(&b->slots[bottom & (b->size - 1)], val,
+			memory_order_relaxed);
+	atomic_store_explicit(&d->bottom, bottom + 1, memory_order_release);
+}
+
+/**
+ * deque_pop() - Removes the value at the bottom of the deque, which is the
+ * value pushed last. May only be called by the owner of the deque.
+ * @d: The deque which to take the value from.
+ * Returns: The value or NULL if the deque is empty.
+ */
+void *deque_pop(deque *d){
+	long bottom = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+	struct deque_buffer *b = atomic_load_explicit(&d->buffer,
+			memory_order_relaxed);
+	atomic_store_explicit(&d->bottom, bottom, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	long top = atomic_load_explicit(&d->top, memory_order_relaxed);
+	void *val = NULL;
+
+	if(top <= bottom){
+		val = atomic_load_explicit(&b->slots[bottom & (b->size - 1)],
+				memory_order_relaxed);
+
+		if(top == bottom){ //Last element, race against the thieves.
+			if(!atomic_compare_exchange_strong_explicit(&d->top, &top, top + 1,
+					memory_order_seq_cst, memory_order_relaxed)){
+				val = NULL;
+			}
+			atomic_store_explicit(&d->bottom, bottom + 1, memory_order_relaxed);
+		}
+	}
+	else{ //Empty
+		atomic_store_explicit(&d->bottom, bottom + 1, memory_order_relaxed);
+	}
+
+	return val;
+}
+
+/**
+ * deque_steal() - Removes the value at the top of the deque, which is the
+ * oldest value. May be called by any thread.
+ * @d: The deque which to take the value from.
+ * Returns: The value or NULL if the deque is empty or if another thread took
+ * the value first.
+ */
+void *deque_steal(deque *d){
+	long top = atomic_load_explicit(&d->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	long bottom = atomic_load_explicit(&d->bottom, memory_order_acquire);
+	void *val = NULL;
+
+	if(top < bottom){
+		struct deque_buffer *b = atomic_load_explicit(&d->buffer,
+				memory_order_acquire);
+		val = atomic_load_explicit(&b->slots[top & (b->size - 1)],
+				memory_order_relaxed);
+
+		if(!atomic_compare_exchange_strong_explicit(&d->top, &top, top + 1,
+				memory_order_seq_cst, memory_order_relaxed)){
+			val = NULL; //Lost the race
+		}
+	}
+
+	return val;
+}
+
+/**
+ * deque_is_empty() - Checks if the given deque is empty. When called by any
+ * other thread than the owner the answer is only a snapshot.
+ * @d: A deque to check for emptiness.
+ * Returns: true if the deque is empty, else false.
+ */
+bool deque_is_empty(deque *d){
+	long bottom = atomic_load_explicit(&d->bottom, memory_order_acquire);
+	long top = atomic_load_explicit(&d->top, memory_order_acquire);
+
+	return bottom <= top;
+}
+
+/**
+ * deque_kill() - Removes the deque but the elements are not freed. No other
+ * thread may use the deque any more.
+ * @d: The deque which to remove.
+ */
+void deque_kill(deque *d){
+	struct deque_buffer *b = atomic_load_explicit(&d->buffer,
+			memory_order_relaxed);
+
+	while(b != NULL){
+		struct deque_buffer *prev = b->prev;
+		free(b);
+		b = prev;
+	}
+
+	free(d);
+}
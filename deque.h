@@ -0,0 +1,67 @@
+#ifndef __DEQUE_H_
+#define __DEQUE_H_
+
+#include <stdbool.h>
+
+/*
+ * A work-stealing deque which can store any given object. The deque has one
+ * owner thread which pushes and pops at the bottom end (LIFO), while any other
+ * thread may steal from the top end (FIFO). The owner operations take no lock,
+ * and a steal only competes with other thieves and with the owner when the
+ * deque holds a single element. This is the Chase-Lev deque, written with C11
+ * atomics. The objects given to the deque will not be freed, so the user of
+ * this deque should handle that.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The deque type.
+typedef struct deque deque;
+
+/**
+ * deque_new() - Create a new and empty deque.
+ * Returns: A pointer to the new deque.
+ */
+deque *deque_new(void);
+
+/**
+ * deque_push() - Adds a value at the bottom of the deque. May only be called
+ * by the owner of the deque. The deque grows when it is full.
+ * @d: The deque which to add the value to.
+ * @val: A value to add, must not be NULL.
+ */
+void deque_push(deque *d, void *val);
+
+/**
+ * deque_pop() - Removes the value at the bottom of the deque, which is the
+ * value pushed last. May only be called by the owner of the deque.
+ * @d: The deque which to take the value from.
+ * Returns: The value or NULL if the deque is empty.
+ */
+void *deque_pop(deque *d);
+
+/**
+ * deque_steal() - Removes the value at the top of the deque, which is the
+ * oldest value. May be called by any thread.
+ * @d: The deque which to take the value from.
+ * Returns: The value or NULL if the deque is empty or if another thread took
+ * the value first.
+ */
+void *deque_steal(deque *d);
+
+/**
+ * deque_is_empty() - Checks if the given deque is empty. When called by any
+ * other thread than the owner the answer is only a snapshot.
+ * @d: A deque to check for emptiness.
+ * Returns: true if the deque is empty, else false.
+ */
+bool deque_is_empty(deque *d);
+
+/**
+ * deque_kill() - Removes the deque but the elements are not freed. No other
+ * thread may use the deque any more.
+ * @d: The deque which to remove.
+ */
+void deque_kill(deque *d);
+
+#endif //__DEQUE_H_
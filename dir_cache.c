@@ -0,0 +1,686 @@
+/* For statx() and mkstemp() */
+#define _GNU_SOURCE
+
+#include "dir_cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * A cache of the entries of directories, kept in a file between searches.
+ * A directory is known by its device and inode, and its entries are only
+ * taken from the cache while its modification and change times are those it
+ * had when it was read, so an unchanged directory is never read again. The
+ * change time can not be set back by a program, unlike the modification time.
+ *
+ * The file is only ever appended to, with whole records, so many searches
+ * may share it at once: the newest record of a directory is the one used.
+ * When most of the file is old records it is compacted by the next search to
+ * open it. Once opened the cache is only read, and each thread writes the
+ * directories it reads through its own writer. struct statx needs
+ * _GNU_SOURCE.
+ *
+ * The file starts with the magic, followed by the records. A record is a
+ * struct record followed by its entries and zeros up to a multiple of eight
+ * bytes. An entry is stored as:
+ *   byte    type
+ *   byte    length of the name
+ *   bytes   the name
+ *
+ * Appending takes a shared flock() of the file and a compaction an exclusive
+ * one. A compaction writes the file under another name and renames it, so a
+ * search appending to the old file opens the new one. A record cut short,
+ * by a search which was killed or ran out of space, ends what is read of the
+ * file and has it compacted.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The first bytes of a cache, which change with the format.
+#define CACHE_MAGIC "MFINDDC1"
+#define MAGIC_SIZE 8
+
+// A writer appends what it has collected when it holds this much.
+#define FLUSH_SIZE (64 * 1024)
+
+// A file smaller than this is never compacted.
+#define COMPACT_MIN_SIZE (1024 * 1024)
+
+// A directory changed less than this many seconds before the search started
+// is not recorded.
+#define RECENT_SECONDS 2
+
+struct record{
+	uint32_t size; //Of the whole record, a multiple of 8
+	uint32_t sum; //Of the bytes after this field
+	uint32_t dev_major;
+	uint32_t dev_minor;
+	uint64_t ino;
+	int64_t mtime_sec;
+	int64_t ctime_sec;
+	uint32_t mtime_nsec;
+	uint32_t ctime_nsec;
+	uint32_t num_entries;
+	uint32_t unused;
+};
+
+// The cache type.
+struct dir_cache{
+	char *file;
+	int fd; //Open for appending
+	pthread_mutex_t fd_lock; //Held by a writer appending
+	unsigned char *map;
+	size_t size;
+	const struct record **slots; //Open addressing, NULL if free
+	size_t num_slots; //A power of two
+	size_t num_records;
+	int64_t start_sec;
+};
+
+// The writer type.
+struct dir_cache_writer{
+	dir_cache *cache;
+	unsigned char *buffer;
+	size_t len;
+	size_t size;
+	size_t record_start;
+	bool recording;
+};
+
+/**
+ * xrealloc() - Like realloc(), but exits on failure.
+ * @p: The memory to resize, or NULL.
+ * @size: The new size.
+ * Returns: A pointer to the memory.
+ */
+static void *xrealloc(void *p, size_t size){
+	p = realloc(p, size);
+	if(p == NULL){
+		perror("dir_cache.c");
+		exit(errno);
+	}
+
+	return p;
+}
+
+/**
+ * checksum() - Computes the FNV-1a hash of the bytes of a record after its
+ * checksum.
+ * @r: The record, whose size must be valid.
+ * Returns: The checksum.
+ */
+static uint32_t checksum(const struct record *r){
+	const unsigned char *p = (const unsigned char *)r;
+	uint32_t h = 2166136261u;
+
+	for(size_t i = 2 * sizeof(uint32_t); i < r->size; i++){
+		h = (h ^ p[i]) * 16777619u;
+	}
+
+	return h;
+}
+
+/**
+ * slot_of() - Finds the slot of a directory, or the free slot where it would
+ * go.
+ * @c: The cache.
+ * @dev_major: The major number of the device of the directory.
+ * @dev_minor: The minor number of the device of the directory.
+ * @ino: The inode of the directory.
+ * Returns: The number of the slot.
+ */
+static size_t slot_of(const dir_cache *c, uint32_t dev_major,
+		uint32_t dev_minor, uint64_t ino){
+	uint64_t h = (ino ^ (((uint64_t)dev_major << 32) | dev_minor)) *
+			0x9e3779b97f4a7c15u;
+	size_t mask = c->num_slots - 1;
+	size_t i = (size_t)(h >> 32) & mask;
+
+	while(c->slots[i] != NULL){
+		const struct record *r = c->slots[i];
+
+		if((r->ino == ino) && (r->dev_major == dev_major) &&
+				(r->dev_minor == dev_minor)){
+			break;
+		}
+		i = (i + 1) & mask;
+	}
+
+	return i;
+}
+
+/**
+ * insert() - Puts a record in the table, in place of an older one of the
+ * same directory.
+ * @c: The cache.
+ * @r: The record.
+ * @live_size: The size of the newest records, which is updated.
+ */
+static void insert(dir_cache *c, const struct record *r, size_t *live_size){
+	//Kept at most half full
+	if(2 * (c->num_records + 1) > c->num_slots){
+		const struct record **old = c->slots;
+		size_t num_old = c->num_slots;
+
+		c->num_slots = (num_old == 0) ? 1024 : 2 * num_old;
+		c->slots = xrealloc(NULL, c->num_slots * sizeof(*c->slots));
+		memset(c->slots, 0, c->num_slots * sizeof(*c->slots));
+		for(size_t i = 0; i < num_old; i++){
+			if(old[i] != NULL){
+				c->slots[slot_of(c, old[i]->dev_major, old[i]->dev_minor,
+						old[i]->ino)] = old[i];
+			}
+		}
+		free(old);
+	}
+
+	size_t i = slot_of(c, r->dev_major, r->dev_minor, r->ino);
+	if(c->slots[i] != NULL){
+		*live_size -= c->slots[i]->size;
+	}
+	else{
+		c->num_records++;
+	}
+	c->slots[i] = r;
+	*live_size += r->size;
+}
+
+/**
+ * next_record() - Checks the record at a place in the mapped file.
+ * @c: The cache.
+ * @pos: The offset of the record.
+ * Returns: The record, or NULL at the end of the file or of what is whole.
+ */
+static const struct record *next_record(const dir_cache *c, size_t pos){
+	const struct record *r = (const struct record *)(c->map + pos);
+
+	if((c->size - pos < sizeof(*r)) || (r->size < sizeof(*r)) ||
+			(r->size % 8 != 0) || (r->size > c->size - pos) ||
+			(checksum(r) != r->sum)){
+		return NULL;
+	}
+
+	return r;
+}
+
+/**
+ * write_all() - Writes all of a buffer to a file descriptor.
+ * @fd: The file descriptor.
+ * @buffer: The bytes to write.
+ * @len: The number of bytes.
+ * Returns: 0 on success, -1 on failure with errno set.
+ */
+static int write_all(int fd, const void *buffer, size_t len){
+	const char *p = buffer;
+
+	while(len > 0){
+		ssize_t n = write(fd, p, len);
+
+		if(n < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			return -1;
+		}
+		p += n;
+		len -= (size_t)n;
+	}
+
+	return 0;
+}
+
+/**
+ * compact() - Writes the newest record of every directory to a new file,
+ * which then replaces the cache. The exclusive lock must be held.
+ * @c: The cache.
+ * @end: The end of the whole records of the file.
+ * Returns: 0 on success, -1 on failure with errno set.
+ */
+static int compact(dir_cache *c, size_t end){
+	char *tmp_name = xrealloc(NULL, strlen(c->file) + sizeof(".XXXXXX"));
+	sprintf(tmp_name, "%s.XXXXXX", c->file);
+
+	int fd = mkstemp(tmp_name);
+	if(fd < 0){
+		free(tmp_name);
+		return -1;
+	}
+
+	//mkstemp() gives 0600, the cache is as readable as any file
+	mode_t mask = umask(0);
+	umask(mask);
+	fchmod(fd, 0666 & ~mask);
+
+	int ret = write_all(fd, CACHE_MAGIC, MAGIC_SIZE);
+	size_t pos = MAGIC_SIZE;
+	while((ret == 0) && (pos < end)){
+		const struct record *r = (const struct record *)(c->map + pos);
+
+		if(c->slots[slot_of(c, r->dev_major, r->dev_minor, r->ino)] == r){
+			ret = write_all(fd, r, r->size);
+		}
+		pos += r->size;
+	}
+
+	int saved_errno = errno;
+	if(close(fd) < 0){
+		saved_errno = errno;
+		ret = -1;
+	}
+	if((ret == 0) && (rename(tmp_name, c->file) < 0)){
+		saved_errno = errno;
+		ret = -1;
+	}
+	if(ret < 0){
+		unlink(tmp_name);
+	}
+
+	free(tmp_name);
+	errno = saved_errno;
+
+	return ret;
+}
+
+/**
+ * unload() - Unmaps the file of the cache and empties the table.
+ * @c: The cache.
+ */
+static void unload(dir_cache *c){
+	if(c->map != NULL){
+		munmap(c->map, c->size);
+	}
+	if(c->fd >= 0){
+		close(c->fd);
+	}
+	free(c->slots);
+	c->map = NULL;
+	c->size = 0;
+	c->fd = -1;
+	c->slots = NULL;
+	c->num_slots = 0;
+	c->num_records = 0;
+}
+
+/**
+ * load() - Opens and maps the file of the cache and puts the newest record of
+ * every directory in the table, under an exclusive lock so no record is read
+ * while it is being appended.
+ * @c: The cache, with no file loaded.
+ * @may_compact: If the file may be compacted.
+ * Returns: NULL on success, or a description of the error.
+ */
+static const char *load(dir_cache *c, bool may_compact){
+	struct stat info;
+	struct stat file_info;
+
+	//Until the file opened is not one a compaction has just replaced
+	for(;;){
+		c->fd = open(c->file, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+		if((c->fd < 0) || (flock(c->fd, LOCK_EX) < 0) ||
+				(fstat(c->fd, &info) < 0)){
+			return strerror(errno);
+		}
+		if((stat(c->file, &file_info) < 0) ||
+				((info.st_dev == file_info.st_dev) &&
+				(info.st_ino == file_info.st_ino))){
+			break;
+		}
+		close(c->fd);
+	}
+
+	if((info.st_size == 0) && (write_all(c->fd, CACHE_MAGIC, MAGIC_SIZE) < 0)){
+		return strerror(errno);
+	}
+	c->size = (info.st_size == 0) ? MAGIC_SIZE : (size_t)info.st_size;
+
+	void *map = mmap(NULL, c->size, PROT_READ, MAP_SHARED, c->fd, 0);
+	if(map == MAP_FAILED){
+		return strerror(errno);
+	}
+	c->map = map;
+
+	if((c->size < MAGIC_SIZE) ||
+			(memcmp(c->map, CACHE_MAGIC, MAGIC_SIZE) != 0)){
+		return "not a cache, or written by another version";
+	}
+
+	size_t pos = MAGIC_SIZE;
+	size_t live_size = MAGIC_SIZE;
+	const struct record *r;
+	while((r = next_record(c, pos)) != NULL){
+		insert(c, r, &live_size);
+		pos += r->size;
+	}
+
+	bool cut_short = pos < c->size;
+	if(may_compact && (cut_short || ((c->size >= COMPACT_MIN_SIZE) &&
+			(c->size - live_size > live_size)))){
+		//A cache which can not be compacted is still used
+		if(compact(c, pos) == 0){
+			unload(c);
+			return load(c, false);
+		}
+	}
+
+	flock(c->fd, LOCK_UN);
+
+	return NULL;
+}
+
+/**
+ * dir_cache_open() - Opens a cache, which is created if it does not exist.
+ * @file: The path of the cache.
+ * @error: Where to put a description of the error.
+ * Returns: A pointer to the cache, or NULL on an error.
+ */
+dir_cache *dir_cache_open(const char *file, const char **error){
+	dir_cache *c = calloc(1, sizeof(*c));
+	if(c == NULL){
+		perror("dir_cache.c");
+		exit(errno);
+	}
+
+	c->file = xrealloc(NULL, strlen(file) + 1);
+	strcpy(c->file, file);
+	c->fd = -1;
+	pthread_mutex_init(&c->fd_lock, NULL);
+	c->start_sec = (int64_t)time(NULL);
+
+	*error = load(c, true);
+	if(*error != NULL){
+		dir_cache_close(c);
+		return NULL;
+	}
+
+	return c;
+}
+
+/**
+ * dir_cache_find() - Looks for a directory which has not changed since it
+ * was cached.
+ * @c: The cache.
+ * @dir_info: The directory examined with DIR_CACHE_STAT_MASK.
+ * @cursor: Where to put the start of the entries.
+ * Returns: true if the directory was found, else false.
+ */
+bool dir_cache_find(const dir_cache *c, const struct statx *dir_info,
+		dir_cache_cursor *cursor){
+	if(((dir_info->stx_mask & DIR_CACHE_STAT_MASK) != DIR_CACHE_STAT_MASK) ||
+			(c->num_slots == 0)){
+		return false;
+	}
+
+	const struct record *r = c->slots[slot_of(c, dir_info->stx_dev_major,
+			dir_info->stx_dev_minor, dir_info->stx_ino)];
+	if((r == NULL) || (r->mtime_sec != dir_info->stx_mtime.tv_sec) ||
+			(r->mtime_nsec != dir_info->stx_mtime.tv_nsec) ||
+			(r->ctime_sec != dir_info->stx_ctime.tv_sec) ||
+			(r->ctime_nsec != dir_info->stx_ctime.tv_nsec)){
+		return false;
+	}
+
+	cursor->pos = (const unsigned char *)(r + 1);
+	cursor->end = (const unsigned char *)r + r->size;
+	cursor->left = r->num_entries;
+
+	return true;
+}
+
+/**
+ * dir_cache_cursor_next() - Reads the next entry of a cached directory.
+ * @cursor: The cursor.
+ * @type: Where to put the type, 'f', 'd', 'l' or '?'.
+ * Returns: The name of the entry, valid until the next call, or NULL at the
+ * end of the directory.
+ */
+const char *dir_cache_cursor_next(dir_cache_cursor *cursor, char *type){
+	if((cursor->left == 0) || (cursor->end - cursor->pos < 2) ||
+			(cursor->end - cursor->pos - 2 < cursor->pos[1])){
+		return NULL;
+	}
+
+	size_t len = cursor->pos[1];
+	*type = (char)cursor->pos[0];
+	memcpy(cursor->name, cursor->pos + 2, len);
+	cursor->name[len] = '\0';
+	cursor->pos += 2 + len;
+	cursor->left--;
+
+	return cursor->name;
+}
+
+/**
+ * dir_cache_close() - Unmaps and removes the cache. The writers must be
+ * removed first.
+ * @c: The cache which to remove, or NULL.
+ */
+void dir_cache_close(dir_cache *c){
+	if(c == NULL){
+		return;
+	}
+
+	unload(c);
+	pthread_mutex_destroy(&c->fd_lock);
+	free(c->file);
+	free(c);
+}
+
+/**
+ * dir_cache_writer_new() - Create a new writer for a cache.
+ * @c: The cache.
+ * Returns: A pointer to the new writer.
+ */
+dir_cache_writer *dir_cache_writer_new(dir_cache *c){
+	dir_cache_writer *w = calloc(1, sizeof(*w));
+	if(w == NULL){
+		perror("dir_cache.c");
+		exit(errno);
+	}
+
+	w->cache = c;
+	w->size = 2 * FLUSH_SIZE;
+	w->buffer = xrealloc(NULL, w->size);
+
+	return w;
+}
+
+/**
+ * reserve() - Makes room in the buffer of a writer.
+ * @w: The writer.
+ * @len: The number of bytes to make room for.
+ */
+static void reserve(dir_cache_writer *w, size_t len){
+	if(w->size - w->len < len){
+		while(w->size - w->len < len){
+			w->size *= 2;
+		}
+		w->buffer = xrealloc(w->buffer, w->size);
+	}
+}
+
+/**
+ * dir_cache_writer_begin() - Starts a record of a directory being read. A
+ * directory changed too shortly before the search is not recorded, since
+ * another change within the same tick of the clock would not show.
+ * @w: The writer.
+ * @dir_info: The directory examined with DIR_CACHE_STAT_MASK before it is
+ * read.
+ */
+void dir_cache_writer_begin(dir_cache_writer *w, const struct statx *dir_info){
+	w->recording = false;
+	if(((dir_info->stx_mask & DIR_CACHE_STAT_MASK) != DIR_CACHE_STAT_MASK) ||
+			(dir_info->stx_ctime.tv_sec + RECENT_SECONDS >
+			w->cache->start_sec)){
+		return;
+	}
+
+	struct record r;
+	memset(&r, 0, sizeof(r));
+	r.dev_major = dir_info->stx_dev_major;
+	r.dev_minor = dir_info->stx_dev_minor;
+	r.ino = dir_info->stx_ino;
+	r.mtime_sec = dir_info->stx_mtime.tv_sec;
+	r.mtime_nsec = dir_info->stx_mtime.tv_nsec;
+	r.ctime_sec = dir_info->stx_ctime.tv_sec;
+	r.ctime_nsec = dir_info->stx_ctime.tv_nsec;
+
+	reserve(w, sizeof(r));
+	w->record_start = w->len;
+	memcpy(w->buffer + w->len, &r, sizeof(r));
+	w->len += sizeof(r);
+	w->recording = true;
+}
+
+/**
+ * dir_cache_writer_add() - Adds an entry to the record being written. Does
+ * nothing if no record is.
+ * @w: The writer.
+ * @name: The name of the entry.
+ * @type: The type of the entry, 'f', 'd', 'l' or '?'.
+ */
+void dir_cache_writer_add(dir_cache_writer *w, const char *name, char type){
+	if(!w->recording){
+		return;
+	}
+
+	size_t len = strlen(name);
+	reserve(w, 2 + len);
+	w->buffer[w->len++] = (unsigned char)type;
+	w->buffer[w->len++] = (unsigned char)len;
+	memcpy(w->buffer + w->len, name, len);
+	w->len += len;
+
+	struct record *r = (struct record *)(w->buffer + w->record_start);
+	r->num_entries++;
+}
+
+/**
+ * dir_cache_writer_cancel() - Drops the record being written, for when not
+ * all the entries of the directory could be read.
+ * @w: The writer.
+ */
+void dir_cache_writer_cancel(dir_cache_writer *w){
+	if(w->recording){
+		w->len = w->record_start;
+		w->recording = false;
+	}
+}
+
+/**
+ * dir_cache_writer_end() - Ends the record being written, which is appended
+ * to the file along with others once enough are collected. Does nothing if
+ * no record is being written.
+ * @w: The writer.
+ * Returns: 0 on success, -1 on failure to append with errno set.
+ */
+int dir_cache_writer_end(dir_cache_writer *w){
+	if(!w->recording){
+		return 0;
+	}
+	w->recording = false;
+
+	size_t padding = (8 - (w->len - w->record_start) % 8) % 8;
+	reserve(w, padding);
+	memset(w->buffer + w->len, 0, padding);
+	w->len += padding;
+
+	struct record *r = (struct record *)(w->buffer + w->record_start);
+	r->size = (uint32_t)(w->len - w->record_start);
+	r->sum = checksum(r);
+
+	if(w->len >= FLUSH_SIZE){
+		return dir_cache_writer_flush(w);
+	}
+
+	return 0;
+}
+
+/**
+ * reopen_if_replaced() - Opens the file of the cache again if a compaction
+ * has replaced it, and takes the shared lock of the file. The lock of the
+ * file descriptor must be held.
+ * @c: The cache.
+ * Returns: 0 on success, -1 on failure with errno set.
+ */
+static int reopen_if_replaced(dir_cache *c){
+	for(;;){
+		struct stat open_info;
+		struct stat file_info;
+
+		if((flock(c->fd, LOCK_SH) < 0) || (fstat(c->fd, &open_info) < 0)){
+			return -1;
+		}
+
+		//Removed by the user, the records are lost with it
+		if(stat(c->file, &file_info) < 0){
+			return 0;
+		}
+		if((open_info.st_dev == file_info.st_dev) &&
+				(open_info.st_ino == file_info.st_ino)){
+			return 0;
+		}
+
+		int fd = open(c->file, O_WRONLY | O_APPEND | O_CLOEXEC);
+		if(fd < 0){
+			return -1;
+		}
+		close(c->fd);
+		c->fd = fd;
+	}
+}
+
+/**
+ * dir_cache_writer_flush() - Appends the records collected to the file.
+ * @w: The writer.
+ * Returns: 0 on success, -1 on failure with errno set.
+ */
+int dir_cache_writer_flush(dir_cache_writer *w){
+	dir_cache *c = w->cache;
+	size_t len = w->recording ? w->record_start : w->len;
+	int ret = 0;
+
+	if(len == 0){
+		return 0;
+	}
+
+	//One write() of whole records, which O_APPEND keeps in one piece
+	pthread_mutex_lock(&c->fd_lock);
+	if((reopen_if_replaced(c) < 0) || (write_all(c->fd, w->buffer, len) < 0)){
+		ret = -1;
+	}
+	int saved_errno = errno;
+	flock(c->fd, LOCK_UN);
+	pthread_mutex_unlock(&c->fd_lock);
+
+	memmove(w->buffer, w->buffer + len, w->len - len);
+	w->len -= len;
+	if(w->recording){
+		w->record_start -= len;
+	}
+	errno = saved_errno;
+
+	return ret;
+}
+
+/**
+ * dir_cache_writer_kill() - Removes the writer, dropping what has not been
+ * flushed.
+ * @w: The writer which to remove, or NULL.
+ */
+void dir_cache_writer_kill(dir_cache_writer *w){
+	if(w == NULL){
+		return;
+	}
+
+	free(w->buffer);
+	free(w);
+}
@@ -0,0 +1,134 @@
+#ifndef __DIR_CACHE_H_
+#define __DIR_CACHE_H_
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/stat.h>
+
+/*
+ * A cache of the entries of directories, kept in a file between searches.
+ * A directory is known by its device and inode, and its entries are only
+ * taken from the cache while its modification and change times are those it
+ * had when it was read, so an unchanged directory is never read again. The
+ * change time can not be set back by a program, unlike the modification time.
+ *
+ * The file is only ever appended to, with whole records, so many searches
+ * may share it at once: the newest record of a directory is the one used.
+ * When most of the file is old records it is compacted by the next search to
+ * open it. Once opened the cache is only read, and each thread writes the
+ * directories it reads through its own writer. struct statx needs
+ * _GNU_SOURCE.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The statx() fields of a directory the cache needs.
+#define DIR_CACHE_STAT_MASK (STATX_INO | STATX_MTIME | STATX_CTIME)
+
+// The cache type.
+typedef struct dir_cache dir_cache;
+
+// The writer type, which collects the directories read by one thread.
+typedef struct dir_cache_writer dir_cache_writer;
+
+// Where a thread is in the entries of a cached directory.
+typedef struct dir_cache_cursor{
+	const unsigned char *pos;
+	const unsigned char *end;
+	size_t left; //The number of entries not read
+	char name[NAME_MAX + 1];
+}dir_cache_cursor;
+
+/**
+ * dir_cache_open() - Opens a cache, which is created if it does not exist.
+ * @file: The path of the cache.
+ * @error: Where to put a description of the error.
+ * Returns: A pointer to the cache, or NULL on an error.
+ */
+dir_cache *dir_cache_open(const char *file, const char **error);
+
+/**
+ * dir_cache_find() - Looks for a directory which has not changed since it
+ * was cached.
+ * @c: The cache.
+ * @dir_info: The directory examined with DIR_CACHE_STAT_MASK.
+ * @cursor: Where to put the start of the entries.
+ * Returns: true if the directory was found, else false.
+ */
+bool dir_cache_find(const dir_cache *c, const struct statx *dir_info,
+		dir_cache_cursor *cursor);
+
+/**
+ * dir_cache_cursor_next() - Reads the next entry of a cached directory.
+ * @cursor: The cursor.
+ * @type: Where to put the type, 'f', 'd', 'l' or '?'.
+ * Returns: The name of the entry, valid until the next call, or NULL at the
+ * end of the directory.
+ */
+const char *dir_cache_cursor_next(dir_cache_cursor *cursor, char *type);
+
+/**
+ * dir_cache_close() - Unmaps and removes the cache. The writers must be
+ * removed first.
+ * @c: The cache which to remove, or NULL.
+ */
+void dir_cache_close(dir_cache *c);
+
+/**
+ * dir_cache_writer_new() - Create a new writer for a cache.
+ * @c: The cache.
+ * Returns: A pointer to the new writer.
+ */
+dir_cache_writer *dir_cache_writer_new(dir_cache *c);
+
+/**
+ * dir_cache_writer_begin() - Starts a record of a directory being read. A
+ * directory changed too shortly before the search is not recorded, since
+ * another change within the same tick of the clock would not show.
+ * @w: The writer.
+ * @dir_info: The directory examined with DIR_CACHE_STAT_MASK before it is
+ * read.
+ */
+void dir_cache_writer_begin(dir_cache_writer *w, const struct statx *dir_info);
+
+/**
+ * dir_cache_writer_add() - Adds an entry to the record being written. Does
+ * nothing if no record is.
+ * @w: The writer.
+ * @name: The name of the entry.
+ * @type: The type of the entry, 'f', 'd', 'l' or '?'.
+ */
+void dir_cache_writer_add(dir_cache_writer *w, const char *name, char type);
+
+/**
+ * dir_cache_writer_cancel() - Drops the record being written, for when not
+ * all the entries of the directory could be read.
+ * @w: The writer.
+ */
+void dir_cache_writer_cancel(dir_cache_writer *w);
+
+/**
+ * dir_cache_writer_end() - Ends the record being written, which is appended
+ * to the file along with others once enough are collected. Does nothing if
+ * no record is being written.
+ * @w: The writer.
+ * Returns: 0 on success, -1 on failure to append with errno set.
+ */
+int dir_cache_writer_end(dir_cache_writer *w);
+
+/**
+ * dir_cache_writer_flush() - Appends the records collected to the file.
+ * @w: The writer.
+ * Returns: 0 on success, -1 on failure with errno set.
+ */
+int dir_cache_writer_flush(dir_cache_writer *w);
+
+/**
+ * dir_cache_writer_kill() - Removes the writer, dropping what has not been
+ * flushed.
+ * @w: The writer which to remove, or NULL.
+ */
+void dir_cache_writer_kill(dir_cache_writer *w);
+
+#endif //__DIR_CACHE_H_
@@ -0,0 +1,107 @@
+#include "dir_node.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A directory found during the search, stored as a pointer to the directory
+ * holding it and its own name, instead of as a full path. The full path is
+ * only built when it is needed, see dir_node_path(). A node keeps its parent
+ * alive: it is reference counted, holding one reference for itself until it
+ * has been checked and one for every child node. A node without a parent
+ * holds a start directory, and its name is the path as given by the user.
+ * The depth of a node is the number of directories it is below its start
+ * directory.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+/**
+ * dir_node_new() - Create a new node in the given arena. The parent gets one
+ * more reference.
+ * @paths: The arena which to allocate the node from.
+ * @parent: The node of the directory holding this one, or NULL.
+ * @name: The name of the directory, or the path of a start directory.
+ * Returns: A pointer to the new node, holding one reference.
+ */
+dir_node *dir_node_new(path_arena *paths, dir_node *parent, const char *name){
+	size_t name_len = strlen(name);
+	dir_node *node = (dir_node *)path_arena_alloc(paths,
+			sizeof(*node) + name_len + 1);
+
+	node->parent = parent;
+	atomic_init(&node->refs, 1);
+	node->name_len = (unsigned int)name_len;
+	node->depth = (parent != NULL) ? parent->depth + 1 : 0;
+	memcpy(node->name, name, name_len + 1);
+
+	if(parent != NULL){
+		atomic_fetch_add_explicit(&parent->refs, 1, memory_order_relaxed);
+	}
+
+	return node;
+}
+
+/**
+ * dir_node_hold() - Takes one more reference to a node, for a holder other
+ * than those above. May be called by any thread holding a reference.
+ * @node: The node.
+ */
+void dir_node_hold(dir_node *node){
+	atomic_fetch_add_explicit(&node->refs, 1, memory_order_relaxed);
+}
+
+/**
+ * dir_node_release() - Drops one reference to a node. When it was the last
+ * one the node is freed and its reference to the parent is dropped. May be
+ * called by any thread.
+ * @node: The node.
+ */
+void dir_node_release(dir_node *node){
+	while((node != NULL) && (atomic_fetch_sub_explicit(&node->refs, 1,
+			memory_order_acq_rel) == 1)){
+		dir_node *parent = node->parent;
+		path_arena_free((char *)node);
+		node = parent;
+	}
+}
+
+/**
+ * dir_node_path() - Builds the full path of a node into a buffer, which is
+ * grown with realloc() when it is too small.
+ * @node: The node.
+ * @buf: The buffer, may point to NULL.
+ * @size: The size of the buffer.
+ * Returns: The path, which is *buf. NULL if the buffer could not be grown.
+ */
+char *dir_node_path(dir_node *node, char **buf, size_t *size){
+	size_t len = 0;
+
+	for(dir_node *n = node; n != NULL; n = n->parent){
+		len += n->name_len + ((n->parent != NULL) ? 1 : 0);
+	}
+
+	if((*buf == NULL) || (*size < len + 1)){
+		char *bigger = realloc(*buf, len + 1);
+		if(bigger == NULL){
+			perror("realloc");
+			return NULL;
+		}
+		*buf = bigger;
+		*size = len + 1;
+	}
+
+	//Fill in the names from the end
+	char *end = *buf + len;
+	*end = '\0';
+	for(dir_node *n = node; n != NULL; n = n->parent){
+		end -= n->name_len;
+		memcpy(end, n->name, n->name_len);
+		if(n->parent != NULL){
+			*--end = '/';
+		}
+	}
+
+	return *buf;
+}
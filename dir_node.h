@@ -0,0 +1,66 @@
+#ifndef __DIR_NODE_H_
+#define __DIR_NODE_H_
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "path_arena.h"
+
+/*
+ * A directory found during the search, stored as a pointer to the directory
+ * holding it and its own name, instead of as a full path. The full path is
+ * only built when it is needed, see dir_node_path(). A node keeps its parent
+ * alive: it is reference counted, holding one reference for itself until it
+ * has been checked and one for every child node. A node without a parent
+ * holds a start directory, and its name is the path as given by the user.
+ * The depth of a node is the number of directories it is below its start
+ * directory.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The directory node type.
+typedef struct dir_node{
+	struct dir_node *parent;
+	atomic_int refs;
+	unsigned int name_len;
+	unsigned int depth; //0 for a start directory
+	char name[];
+}dir_node;
+
+/**
+ * dir_node_new() - Create a new node in the given arena. The parent gets one
+ * more reference.
+ * @paths: The arena which to allocate the node from.
+ * @parent: The node of the directory holding this one, or NULL.
+ * @name: The name of the directory, or the path of a start directory.
+ * Returns: A pointer to the new node, holding one reference.
+ */
+dir_node *dir_node_new(path_arena *paths, dir_node *parent, const char *name);
+
+/**
+ * dir_node_hold() - Takes one more reference to a node, for a holder other
+ * than those above. May be called by any thread holding a reference.
+ * @node: The node.
+ */
+void dir_node_hold(dir_node *node);
+
+/**
+ * dir_node_release() - Drops one reference to a node. When it was the last
+ * one the node is freed and its reference to the parent is dropped. May be
+ * called by any thread.
+ * @node: The node.
+ */
+void dir_node_release(dir_node *node);
+
+/**
+ * dir_node_path() - Builds the full path of a node into a buffer, which is
+ * grown with realloc() when it is too small.
+ * @node: The node.
+ * @buf: The buffer, may point to NULL.
+ * @size: The size of the buffer.
+ * Returns: The path, which is *buf. NULL if the buffer could not be grown.
+ */
+char *dir_node_path(dir_node *node, char **buf, size_t *size);
+
+#endif //__DIR_NODE_H_
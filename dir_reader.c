@@ -0,0 +1,224 @@
+#include "dir_reader.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+/*
+ * A reader for the entries of an open directory. Each thread should have its
+ * own reader, which is reused for every directory the thread reads. On Linux
+ * the reader calls getdents64 directly into a large buffer and hands out the
+ * entries in place, without copying them. The reader can also be created to
+ * use opendir()/readdir(), which is also used where getdents64 is missing.
+ * Each read of the directory can be timed into the statistics of the thread.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+#if defined(SYS_getdents64) && !defined(MFIND_NO_GETDENTS)
+#define HAVE_GETDENTS64 1
+#else
+#define HAVE_GETDENTS64 0
+#endif
+
+// The record layout written by getdents64.
+struct linux_dirent64{
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+// The reader type.
+struct dir_reader{
+	char *buffer; //NULL when readdir() is used.
+	size_t buffer_size;
+	size_t pos; //Next record in the buffer.
+	size_t end; //End of the valid records in the buffer.
+	int fd;
+	DIR *stream;
+	worker_stats *stats; //NULL when not timed.
+};
+
+/**
+ * dir_reader_new() - Create a new reader.
+ * @buffer_size: The size of the getdents64 buffer, or 0 to use readdir().
+ * Returns: A pointer to the new reader.
+ */
+dir_reader *dir_reader_new(size_t buffer_size){
+	dir_reader *r = calloc(1, sizeof(*r));
+	if(r == NULL){
+		perror("dir_reader.c");
+		exit(errno);
+	}
+	r->fd = -1;
+
+	if(HAVE_GETDENTS64 && (buffer_size > 0)){
+		if(buffer_size < DIR_READER_MIN_BUFFER_SIZE){
+			buffer_size = DIR_READER_MIN_BUFFER_SIZE;
+		}
+
+		r->buffer = malloc(buffer_size);
+		if(r->buffer == NULL){
+			perror("dir_reader.c");
+			exit(errno);
+		}
+		r->buffer_size = buffer_size;
+	}
+
+	return r;
+}
+
+/**
+ * dir_reader_open() - Starts reading a directory. The reader takes over the
+ * file descriptor and closes it in dir_reader_close(), also on failure.
+ * @r: The reader.
+ * @dir_fd: An open file descriptor of the directory.
+ * Returns: 0 on success, -1 on failure with errno set.
+ */
+int dir_reader_open(dir_reader *r, int dir_fd){
+	r->fd = dir_fd;
+	r->pos = 0;
+	r->end = 0;
+
+	if(r->buffer == NULL){
+		r->stream = fdopendir(dir_fd);
+		if(r->stream == NULL){
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * fill_buffer() - Reads the next batch of records into the buffer.
+ * @r: The reader.
+ * Returns: The number of bytes read, 0 at the end of the directory or -1 on
+ * failure with errno set.
+ */
+static long fill_buffer(dir_reader *r){
+#if HAVE_GETDENTS64
+	uint64_t start = (r->stats != NULL) ? stats_clock(r->stats) : 0;
+	long n = syscall(SYS_getdents64, r->fd, r->buffer, r->buffer_size);
+
+	if(r->stats != NULL){
+		latency_add(&r->stats->read_latency, start);
+	}
+	if(n > 0){
+		r->pos = 0;
+		r->end = (size_t)n;
+	}
+
+	return n;
+#else
+	(void)r;
+	errno = ENOSYS;
+
+	return -1;
+#endif
+}
+
+/**
+ * dir_reader_next() - Gets the next entry of the directory. The entries "."
+ * and ".." are included.
+ * @r: The reader.
+ * @entry: Filled in with the next entry.
+ * Returns: 1 if an entry was read, 0 at the end of the directory or -1 on
+ * failure with errno set.
+ */
+int dir_reader_next(dir_reader *r, dir_entry *entry){
+	if(r->buffer == NULL){
+		int saved_errno = errno;
+		struct dirent *dir_pointer;
+
+		uint64_t start = (r->stats != NULL) ? stats_clock(r->stats) : 0;
+
+		errno = 0;
+		dir_pointer = readdir(r->stream);
+		if(r->stats != NULL){
+			latency_add(&r->stats->read_latency, start);
+		}
+		if(dir_pointer == NULL){
+			if(errno != 0){
+				return -1;
+			}
+			errno = saved_errno;
+
+			return 0;
+		}
+
+		entry->name = dir_pointer->d_name;
+		entry->type = dir_pointer->d_type;
+		entry->ino = dir_pointer->d_ino;
+
+		return 1;
+	}
+
+	if(r->pos >= r->end){
+		long n = fill_buffer(r);
+		if(n <= 0){
+			return (int)n;
+		}
+	}
+
+	struct linux_dirent64 *d = (struct linux_dirent64 *)(r->buffer + r->pos);
+	r->pos += d->d_reclen;
+
+	entry->name = d->d_name;
+	entry->type = d->d_type;
+	entry->ino = (ino_t)d->d_ino;
+
+	return 1;
+}
+
+/**
+ * dir_reader_close() - Stops reading the directory and closes its file
+ * descriptor.
+ * @r: The reader.
+ * Returns: 0 on success, -1 on failure with errno set.
+ */
+int dir_reader_close(dir_reader *r){
+	int ret = 0;
+
+	if(r->stream != NULL){
+		ret = closedir(r->stream);
+	}
+	else if(r->fd >= 0){
+		ret = close(r->fd);
+	}
+
+	r->stream = NULL;
+	r->fd = -1;
+
+	return ret;
+}
+
+/**
+ * dir_reader_set_stats() - Times each read of a directory from now on, each
+ * call of getdents64 or of readdir(), into the read latency of the
+ * statistics. They must outlive the reader.
+ * @r: The reader.
+ * @stats: The statistics of the thread using the reader, or NULL to stop.
+ */
+void dir_reader_set_stats(dir_reader *r, worker_stats *stats){
+	r->stats = stats;
+}
+
+/**
+ * dir_reader_kill() - Removes the reader. Any open directory is closed.
+ * @r: The reader which to remove.
+ */
+void dir_reader_kill(dir_reader *r){
+	dir_reader_close(r);
+	free(r->buffer);
+	free(r);
+}
@@ -0,0 +1,85 @@
+#ifndef __DIR_READER_H_
+#define __DIR_READER_H_
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "search_stats.h"
+
+/*
+ * A reader for the entries of an open directory. Each thread should have its
+ * own reader, which is reused for every directory the thread reads. On Linux
+ * the reader calls getdents64 directly into a large buffer and hands out the
+ * entries in place, without copying them. The reader can also be created to
+ * use opendir()/readdir(), which is also used where getdents64 is missing.
+ * Each read of the directory can be timed into the statistics of the thread.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The default size of the getdents64 buffer.
+#define DIR_READER_DEFAULT_BUFFER_SIZE (128 * 1024)
+
+// The smallest getdents64 buffer allowed, fits any single entry.
+#define DIR_READER_MIN_BUFFER_SIZE 1024
+
+// The reader type.
+typedef struct dir_reader dir_reader;
+
+// An entry of a directory. The name is only valid until the next call.
+typedef struct dir_entry{
+	const char *name;
+	unsigned char type; //Same values as d_type of struct dirent.
+	ino_t ino;
+}dir_entry;
+
+/**
+ * dir_reader_new() - Create a new reader.
+ * @buffer_size: The size of the getdents64 buffer, or 0 to use readdir().
+ * Returns: A pointer to the new reader.
+ */
+dir_reader *dir_reader_new(size_t buffer_size);
+
+/**
+ * dir_reader_open() - Starts reading a directory. The reader takes over the
+ * file descriptor and closes it in dir_reader_close(), also on failure.
+ * @r: The reader.
+ * @dir_fd: An open file descriptor of the directory.
+ * Returns: 0 on success, -1 on failure with errno set.
+ */
+int dir_reader_open(dir_reader *r, int dir_fd);
+
+/**
+ * dir_reader_next() - Gets the next entry of the directory. The entries "."
+ * and ".." are included.
+ * @r: The reader.
+ * @entry: Filled in with the next entry.
+ * Returns: 1 if an entry was read, 0 at the end of the directory or -1 on
+ * failure with errno set.
+ */
+int dir_reader_next(dir_reader *r, dir_entry *entry);
+
+/**
+ * dir_reader_close() - Stops reading the directory and closes its file
+ * descriptor.
+ * @r: The reader.
+ * Returns: 0 on success, -1 on failure with errno set.
+ */
+int dir_reader_close(dir_reader *r);
+
+/**
+ * dir_reader_set_stats() - Times each read of a directory from now on, each
+ * call of getdents64 or of readdir(), into the read latency of the
+ * statistics. They must outlive the reader.
+ * @r: The reader.
+ * @stats: The statistics of the thread using the reader, or NULL to stop.
+ */
+void dir_reader_set_stats(dir_reader *r, worker_stats *stats);
+
+/**
+ * dir_reader_kill() - Removes the reader. Any open directory is closed.
+ * @r: The reader which to remove.
+ */
+void dir_reader_kill(dir_reader *r);
+
+#endif //__DIR_READER_H_
@@ -0,0 +1,213 @@
+#include "entry_batch.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A batch of entries read from a directory, copied out of the reader so they
+ * can be checked by another thread than the one reading the directory. The
+ * entries are packed into one buffer of a fixed size. A batch is handed over
+ * through a batch queue, which any number of threads may push to and pop from
+ * at once. The queue is a list under a lock, taken once per batch, and it can
+ * be checked for batches without taking the lock.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// Each entry is its inode number, its type and its name ending with '\0'.
+#define ENTRY_HEADER_SIZE (sizeof(ino_t) + 1)
+
+// The batch type.
+struct entry_batch{
+	struct entry_batch *next; //In the queue
+	void *owner;
+	size_t used;
+	size_t pos; //Of the next entry to give out
+	unsigned char data[ENTRY_BATCH_SIZE];
+};
+
+// The queue type.
+struct batch_queue{
+	pthread_mutex_t lock;
+	entry_batch *first;
+	entry_batch *last;
+	atomic_size_t num_batches;
+};
+
+/**
+ * entry_batch_new() - Create a new and empty batch.
+ * @owner: What the entries belong to, given back by entry_batch_owner().
+ * Returns: A pointer to the new batch.
+ */
+entry_batch *entry_batch_new(void *owner){
+	entry_batch *b = malloc(sizeof(*b));
+	if(b == NULL){
+		perror("entry_batch.c");
+		exit(errno);
+	}
+
+	b->next = NULL;
+	b->owner = owner;
+	b->used = 0;
+	b->pos = 0;
+
+	return b;
+}
+
+/**
+ * entry_batch_add() - Copies an entry into the batch.
+ * @b: The batch.
+ * @entry: The entry.
+ * Returns: true if the entry was added, false if the batch is too full.
+ */
+bool entry_batch_add(entry_batch *b, const dir_entry *entry){
+	size_t name_len = strlen(entry->name);
+
+	if(b->used + ENTRY_HEADER_SIZE + name_len + 1 > ENTRY_BATCH_SIZE){
+		return false;
+	}
+
+	memcpy(b->data + b->used, &entry->ino, sizeof(ino_t));
+	b->data[b->used + sizeof(ino_t)] = entry->type;
+	memcpy(b->data + b->used + ENTRY_HEADER_SIZE, entry->name, name_len + 1);
+	b->used += ENTRY_HEADER_SIZE + name_len + 1;
+
+	return true;
+}
+
+/**
+ * entry_batch_next() - Gets the next entry of the batch, in the order they
+ * were added.
+ * @b: The batch.
+ * @entry: Filled in with the next entry, whose name is valid until the batch
+ * is removed.
+ * Returns: true if an entry was given, false at the end of the batch.
+ */
+bool entry_batch_next(entry_batch *b, dir_entry *entry){
+	if(b->pos >= b->used){
+		return false;
+	}
+
+	memcpy(&entry->ino, b->data + b->pos, sizeof(ino_t));
+	entry->type = b->data[b->pos + sizeof(ino_t)];
+	entry->name = (const char *)b->data + b->pos + ENTRY_HEADER_SIZE;
+	b->pos += ENTRY_HEADER_SIZE + strlen(entry->name) + 1;
+
+	return true;
+}
+
+/**
+ * entry_batch_owner() - Gives what the entries of the batch belong to.
+ * @b: The batch.
+ * Returns: The owner given to entry_batch_new().
+ */
+void *entry_batch_owner(const entry_batch *b){
+	return b->owner;
+}
+
+/**
+ * entry_batch_kill() - Removes the batch.
+ * @b: The batch which to remove, or NULL.
+ */
+void entry_batch_kill(entry_batch *b){
+	free(b);
+}
+
+/**
+ * batch_queue_new() - Create a new and empty queue.
+ * Returns: A pointer to the new queue.
+ */
+batch_queue *batch_queue_new(void){
+	batch_queue *q = malloc(sizeof(*q));
+	if(q == NULL){
+		perror("entry_batch.c");
+		exit(errno);
+	}
+
+	pthread_mutex_init(&q->lock, NULL);
+	q->first = NULL;
+	q->last = NULL;
+	atomic_init(&q->num_batches, 0);
+
+	return q;
+}
+
+/**
+ * batch_queue_push() - Adds a batch to the end of the queue.
+ * @q: The queue.
+ * @b: The batch, which is taken over by the queue.
+ */
+void batch_queue_push(batch_queue *q, entry_batch *b){
+	b->next = NULL;
+
+	pthread_mutex_lock(&q->lock);
+	if(q->last != NULL){
+		q->last->next = b;
+	}
+	else{
+		q->first = b;
+	}
+	q->last = b;
+	atomic_fetch_add(&q->num_batches, 1);
+	pthread_mutex_unlock(&q->lock);
+}
+
+/**
+ * batch_queue_pop() - Takes the batch first in the queue.
+ * @q: The queue.
+ * Returns: The batch, which the caller must remove, or NULL if the queue is
+ * empty.
+ */
+entry_batch *batch_queue_pop(batch_queue *q){
+	entry_batch *b;
+
+	if(batch_queue_is_empty(q)){
+		return NULL;
+	}
+
+	pthread_mutex_lock(&q->lock);
+	b = q->first;
+	if(b != NULL){
+		q->first = b->next;
+		if(q->first == NULL){
+			q->last = NULL;
+		}
+		atomic_fetch_sub(&q->num_batches, 1);
+	}
+	pthread_mutex_unlock(&q->lock);
+
+	return b;
+}
+
+/**
+ * batch_queue_is_empty() - Checks if the queue holds a batch, without taking
+ * the lock. A batch pushed by another thread at the same time may be missed.
+ * @q: The queue.
+ * Returns: true if the queue seemed empty, else false.
+ */
+bool batch_queue_is_empty(batch_queue *q){
+	return atomic_load(&q->num_batches) == 0;
+}
+
+/**
+ * batch_queue_kill() - Removes the queue and any batch left in it.
+ * @q: The queue which to remove, or NULL.
+ */
+void batch_queue_kill(batch_queue *q){
+	if(q == NULL){
+		return;
+	}
+
+	while(q->first != NULL){
+		entry_batch *next = q->first->next;
+		entry_batch_kill(q->first);
+		q->first = next;
+	}
+
+	pthread_mutex_destroy(&q->lock);
+	free(q);
+}
@@ -0,0 +1,102 @@
+#ifndef __ENTRY_BATCH_H_
+#define __ENTRY_BATCH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "dir_reader.h"
+
+/*
+ * A batch of entries read from a directory, copied out of the reader so they
+ * can be checked by another thread than the one reading the directory. The
+ * entries are packed into one buffer of a fixed size. A batch is handed over
+ * through a batch queue, which any number of threads may push to and pop from
+ * at once. The queue is a list under a lock, taken once per batch, and it can
+ * be checked for batches without taking the lock.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The number of bytes of entries a batch holds.
+#define ENTRY_BATCH_SIZE (32 * 1024)
+
+// The batch type.
+typedef struct entry_batch entry_batch;
+
+// The queue type.
+typedef struct batch_queue batch_queue;
+
+/**
+ * entry_batch_new() - Create a new and empty batch.
+ * @owner: What the entries belong to, given back by entry_batch_owner().
+ * Returns: A pointer to the new batch.
+ */
+entry_batch *entry_batch_new(void *owner);
+
+/**
+ * entry_batch_add() - Copies an entry into the batch.
+ * @b: The batch.
+ * @entry: The entry.
+ * Returns: true if the entry was added, false if the batch is too full.
+ */
+bool entry_batch_add(entry_batch *b, const dir_entry *entry);
+
+/**
+ * entry_batch_next() - Gets the next entry of the batch, in the order they
+ * were added.
+ * @b: The batch.
+ * @entry: Filled in with the next entry, whose name is valid until the batch
+ * is removed.
+ * Returns: true if an entry was given, false at the end of the batch.
+ */
+bool entry_batch_next(entry_batch *b, dir_entry *entry);
+
+/**
+ * entry_batch_owner() - Gives what the entries of the batch belong to.
+ * @b: The batch.
+ * Returns: The owner given to entry_batch_new().
+ */
+void *entry_batch_owner(const entry_batch *b);
+
+/**
+ * entry_batch_kill() - Removes the batch.
+ * @b: The batch which to remove, or NULL.
+ */
+void entry_batch_kill(entry_batch *b);
+
+/**
+ * batch_queue_new() - Create a new and empty queue.
+ * Returns: A pointer to the new queue.
+ */
+batch_queue *batch_queue_new(void);
+
+/**
+ * batch_queue_push() - Adds a batch to the end of the queue.
+ * @q: The queue.
+ * @b: The batch, which is taken over by the queue.
+ */
+void batch_queue_push(batch_queue *q, entry_batch *b);
+
+/**
+ * batch_queue_pop() - Takes the batch first in the queue.
+ * @q: The queue.
+ * Returns: The batch, which the caller must remove, or NULL if the queue is
+ * empty.
+ */
+entry_batch *batch_queue_pop(batch_queue *q);
+
+/**
+ * batch_queue_is_empty() - Checks if the queue holds a batch, without taking
+ * the lock. A batch pushed by another thread at the same time may be missed.
+ * @q: The queue.
+ * Returns: true if the queue seemed empty, else false.
+ */
+bool batch_queue_is_empty(batch_queue *q);
+
+/**
+ * batch_queue_kill() - Removes the queue and any batch left in it.
+ * @q: The queue which to remove, or NULL.
+ */
+void batch_queue_kill(batch_queue *q);
+
+#endif //__ENTRY_BATCH_H_
@@ -0,0 +1,734 @@
+/* For statx() */
+#define _GNU_SOURCE
+
+#include "expr.h"
+#include "meta_filter.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * An expression of tests on a file, like that of find, with the operators
+ * -not (or '!'), -and (or -a, or nothing between two tests), -or (or -o) and
+ * parentheses. The tests are -name, -type, the metadata tests of meta_filter.h
+ * and -prune, which is always true and keeps a directory from being searched.
+ *
+ * The tokens are parsed into a tree, which is then lowered into a flat
+ * program. Every instruction of the program is one test with the instruction
+ * to go to when it passes and the one to go to when it fails, so -and, -or
+ * and -not cost nothing when a file is checked. Before lowering, the operands
+ * of each -and and -or are reordered so the cheap tests, on the type and the
+ * name, run before the ones needing statx(). Operands are never moved past a
+ * -prune. A run of metadata tests joined by -and becomes one instruction.
+ * Once compiled the expression is only read, so any number of threads may
+ * check files against it at once. struct statx needs _GNU_SOURCE.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// Where a program ends, as the instruction to go to next.
+#define GOTO_TRUE (-1)
+#define GOTO_FALSE (-2)
+
+// The rough cost of a test, for ordering the operands.
+#define COST_TYPE 1
+#define COST_NAME 2
+#define COST_META 10
+
+// What a token, a node of the tree or an instruction is.
+enum kind{
+	KIND_AND,
+	KIND_OR,
+	KIND_NOT,
+	KIND_OPEN,
+	KIND_CLOSE,
+	KIND_TYPE,
+	KIND_NAME,
+	KIND_META,
+	KIND_PRUNE
+};
+
+struct token{
+	enum kind kind;
+	char type;
+	char *pattern;
+	meta_filter *meta;
+};
+
+// A node of the tree. -and and -or have any number of operands.
+typedef struct node{
+	enum kind kind;
+	struct node **kids;
+	size_t num_kids;
+	char type;
+	name_set *names;
+	meta_filter *meta;
+	unsigned int cost;
+	bool has_prune;
+}node;
+
+struct instruction{
+	enum kind kind;
+	char type;
+	int next[2]; //Where to go when the test fails and when it passes
+	name_set *names;
+	meta_filter *meta;
+};
+
+// The expression type.
+struct expr{
+	struct token *tokens;
+	size_t num_tokens;
+	size_t max_tokens;
+
+	struct instruction *program;
+	size_t num_instructions;
+	size_t max_instructions;
+	unsigned int stat_mask;
+	bool may_prune;
+};
+
+// The state of the parser.
+struct parser{
+	struct token *tokens;
+	size_t num_tokens;
+	size_t pos;
+	bool ignore_case;
+	const char *error;
+};
+
+static node *parse_or(struct parser *p);
+
+/**
+ * xrealloc() - realloc() which exits the program on failure.
+ * @p: The memory to resize, or NULL.
+ * @size: The new size.
+ * Returns: A pointer to the memory.
+ */
+static void *xrealloc(void *p, size_t size){
+	p = realloc(p, size);
+	if(p == NULL){
+		perror("expr.c");
+		exit(errno);
+	}
+
+	return p;
+}
+
+/**
+ * expr_new() - Create a new and empty expression, which every file matches.
+ * Returns: A pointer to the new expression.
+ */
+expr *expr_new(void){
+	expr *e = calloc(1, sizeof(*e));
+	if(e == NULL){
+		perror("expr.c");
+		exit(errno);
+	}
+
+	return e;
+}
+
+/**
+ * expr_add() - Adds the next token of the expression. Must be called before
+ * expr_compile().
+ * @e: The expression.
+ * @token: The token without the '-', like "name", "or", "(" or "size".
+ * @arg: The argument of the test, or NULL for an operator or -prune.
+ * Returns: NULL on success, or a description of the error.
+ */
+const char *expr_add(expr *e, const char *token, const char *arg){
+	struct token t;
+
+	memset(&t, 0, sizeof(t));
+
+	if((strcmp(token, "and") == 0) || (strcmp(token, "a") == 0)){
+		t.kind = KIND_AND;
+	}
+	else if((strcmp(token, "or") == 0) || (strcmp(token, "o") == 0)){
+		t.kind = KIND_OR;
+	}
+	else if((strcmp(token, "not") == 0) || (strcmp(token, "!") == 0)){
+		t.kind = KIND_NOT;
+	}
+	else if(strcmp(token, "(") == 0){
+		t.kind = KIND_OPEN;
+	}
+	else if(strcmp(token, ")") == 0){
+		t.kind = KIND_CLOSE;
+	}
+	else if(strcmp(token, "prune") == 0){
+		t.kind = KIND_PRUNE;
+	}
+	else if(strcmp(token, "type") == 0){
+		t.kind = KIND_TYPE;
+		if((strcmp(arg, "f") != 0) && (strcmp(arg, "d") != 0) &&
+				(strcmp(arg, "l") != 0)){
+			return "unknown type, must be f, d or l";
+		}
+		t.type = arg[0];
+	}
+	else if(strcmp(token, "name") == 0){
+		t.kind = KIND_NAME;
+		t.pattern = strdup(arg);
+		if(t.pattern == NULL){
+			perror("expr.c");
+			exit(errno);
+		}
+	}
+	else{
+		t.kind = KIND_META;
+		t.meta = meta_filter_new();
+
+		const char *error = meta_filter_add(t.meta, token, arg);
+		if(error != NULL){
+			meta_filter_kill(t.meta);
+			return error;
+		}
+	}
+
+	if(e->num_tokens == e->max_tokens){
+		e->max_tokens = (e->max_tokens > 0) ? e->max_tokens * 2 : 16;
+		e->tokens = xrealloc(e->tokens, e->max_tokens * sizeof(*e->tokens));
+	}
+	e->tokens[e->num_tokens++] = t;
+
+	return NULL;
+}
+
+/**
+ * node_new() - Creates a node of the tree without operands.
+ * @kind: What the node is.
+ * Returns: A pointer to the new node.
+ */
+static node *node_new(enum kind kind){
+	node *n = calloc(1, sizeof(*n));
+	if(n == NULL){
+		perror("expr.c");
+		exit(errno);
+	}
+	n->kind = kind;
+
+	return n;
+}
+
+/**
+ * node_add_kid() - Adds an operand to a node.
+ * @n: The node.
+ * @kid: The operand, which the node takes over.
+ */
+static void node_add_kid(node *n, node *kid){
+	n->kids = xrealloc(n->kids, (n->num_kids + 1) * sizeof(*n->kids));
+	n->kids[n->num_kids++] = kid;
+}
+
+/**
+ * node_kill() - Removes a node, its operands and what it holds.
+ * @n: The node which to remove, or NULL.
+ */
+static void node_kill(node *n){
+	if(n == NULL){
+		return;
+	}
+
+	for(size_t i = 0; i < n->num_kids; i++){
+		node_kill(n->kids[i]);
+	}
+	free(n->kids);
+	if(n->names != NULL){
+		name_set_kill(n->names);
+	}
+	if(n->meta != NULL){
+		meta_filter_kill(n->meta);
+	}
+	free(n);
+}
+
+/**
+ * starts_operand() - Checks if the next token starts an operand, which is
+ * then joined to the one before by an implied -and.
+ * @p: The parser.
+ * Returns: true if the next token is a test, -not or '('.
+ */
+static bool starts_operand(const struct parser *p){
+	if(p->pos == p->num_tokens){
+		return false;
+	}
+
+	enum kind kind = p->tokens[p->pos].kind;
+	return (kind != KIND_AND) && (kind != KIND_OR) && (kind != KIND_CLOSE);
+}
+
+/**
+ * parse_operand() - Parses a test, a negated operand or an expression in
+ * parentheses.
+ * @p: The parser.
+ * Returns: The node, or NULL on an error.
+ */
+static node *parse_operand(struct parser *p){
+	if(!starts_operand(p)){
+		p->error = "expected a test";
+		return NULL;
+	}
+
+	struct token *t = &p->tokens[p->pos++];
+	node *n;
+	node *negated;
+
+	switch(t->kind){
+		case KIND_NOT:
+			n = parse_operand(p);
+			if(n == NULL){
+				return NULL;
+			}
+			negated = node_new(KIND_NOT);
+			node_add_kid(negated, n);
+			return negated;
+		case KIND_OPEN:
+			n = parse_or(p);
+			if(n == NULL){
+				return NULL;
+			}
+			if((p->pos == p->num_tokens) ||
+					(p->tokens[p->pos].kind != KIND_CLOSE)){
+				p->error = "missing ')'";
+				node_kill(n);
+				return NULL;
+			}
+			p->pos++;
+			return n;
+		case KIND_NAME:
+			n = node_new(KIND_NAME);
+			n->names = name_set_new(p->ignore_case);
+			name_set_add(n->names, t->pattern);
+			name_set_compile(n->names);
+			return n;
+		case KIND_META:
+			n = node_new(KIND_META);
+			n->meta = t->meta;
+			t->meta = NULL;
+			return n;
+		case KIND_TYPE:
+		case KIND_PRUNE:
+		default:
+			n = node_new(t->kind);
+			n->type = t->type;
+			return n;
+	}
+}
+
+/**
+ * parse_and() - Parses operands joined by -and or by nothing.
+ * @p: The parser.
+ * Returns: The node, or NULL on an error.
+ */
+static node *parse_and(struct parser *p){
+	node *n = parse_operand(p);
+	node *all = NULL;
+
+	while(n != NULL){
+		if((p->pos < p->num_tokens) && (p->tokens[p->pos].kind == KIND_AND)){
+			p->pos++;
+		}
+		else if(!starts_operand(p)){
+			break;
+		}
+
+		if(all == NULL){
+			all = node_new(KIND_AND);
+			node_add_kid(all, n);
+		}
+
+		n = parse_operand(p);
+		if(n != NULL){
+			node_add_kid(all, n);
+		}
+	}
+
+	if(n == NULL){
+		node_kill(all);
+		return NULL;
+	}
+
+	return (all != NULL) ? all : n;
+}
+
+/**
+ * parse_or() - Parses operands joined by -or.
+ * @p: The parser.
+ * Returns: The node, or NULL on an error.
+ */
+static node *parse_or(struct parser *p){
+	node *n = parse_and(p);
+	node *any = NULL;
+
+	while((n != NULL) && (p->pos < p->num_tokens) &&
+			(p->tokens[p->pos].kind == KIND_OR)){
+		p->pos++;
+
+		if(any == NULL){
+			any = node_new(KIND_OR);
+			node_add_kid(any, n);
+		}
+
+		n = parse_and(p);
+		if(n != NULL){
+			node_add_kid(any, n);
+		}
+	}
+
+	if(n == NULL){
+		node_kill(any);
+		return NULL;
+	}
+
+	return (any != NULL) ? any : n;
+}
+
+/**
+ * flatten() - Moves the operands of an -and which is an operand of another
+ * -and up into that one, and the same for -or, and removes double -not.
+ * @n: The node.
+ * Returns: The node, or what replaced it.
+ */
+static node *flatten(node *n){
+	for(size_t i = 0; i < n->num_kids; i++){
+		n->kids[i] = flatten(n->kids[i]);
+	}
+
+	if((n->kind == KIND_NOT) && (n->kids[0]->kind == KIND_NOT)){
+		node *inner = n->kids[0]->kids[0];
+		n->kids[0]->num_kids = 0;
+		node_kill(n);
+		return inner;
+	}
+
+	if((n->kind != KIND_AND) && (n->kind != KIND_OR)){
+		return n;
+	}
+
+	node **kids = n->kids;
+	size_t num_kids = n->num_kids;
+
+	n->kids = NULL;
+	n->num_kids = 0;
+	for(size_t i = 0; i < num_kids; i++){
+		node *kid = kids[i];
+
+		if(kid->kind != n->kind){
+			node_add_kid(n, kid);
+			continue;
+		}
+		for(size_t j = 0; j < kid->num_kids; j++){
+			node_add_kid(n, kid->kids[j]);
+		}
+		kid->num_kids = 0;
+		node_kill(kid);
+	}
+	free(kids);
+
+	return n;
+}
+
+/**
+ * reorder() - Sorts the operands of every -and and -or by their cost, cheap
+ * ones first, and joins runs of metadata tests under an -and. An operand
+ * holding a -prune is never moved, nor is any other operand moved past it,
+ * since what it does depends on which operands run before it.
+ * @n: The node.
+ */
+static void reorder(node *n){
+	switch(n->kind){
+		case KIND_TYPE:
+			n->cost = COST_TYPE;
+			return;
+		case KIND_NAME:
+			n->cost = COST_NAME;
+			return;
+		case KIND_META:
+			n->cost = COST_META;
+			return;
+		case KIND_PRUNE:
+			n->has_prune = true;
+			return;
+		default:
+			break;
+	}
+
+	n->cost = 0;
+	for(size_t i = 0; i < n->num_kids; i++){
+		reorder(n->kids[i]);
+		n->cost += n->kids[i]->cost;
+		n->has_prune |= n->kids[i]->has_prune;
+	}
+
+	//Insertion sort, which is stable, of each run between the -prune ones
+	for(size_t i = 1; i < n->num_kids; i++){
+		node *kid = n->kids[i];
+		size_t j = i;
+
+		if(kid->has_prune){
+			continue;
+		}
+		while((j > 0) && !n->kids[j-1]->has_prune &&
+				(n->kids[j-1]->cost > kid->cost)){
+			n->kids[j] = n->kids[j-1];
+			j--;
+		}
+		n->kids[j] = kid;
+	}
+
+	if((n->kind != KIND_AND) || (n->num_kids == 0)){
+		return;
+	}
+
+	size_t num_kids = 1;
+	for(size_t i = 1; i < n->num_kids; i++){
+		node *last = n->kids[num_kids - 1];
+		node *kid = n->kids[i];
+
+		if((last->kind == KIND_META) && (kid->kind == KIND_META)){
+			meta_filter_join(last->meta, kid->meta);
+			node_kill(kid);
+			continue;
+		}
+		n->kids[num_kids++] = kid;
+	}
+	n->num_kids = num_kids;
+}
+
+/**
+ * lower() - Adds the instructions of a node to the program. The instructions
+ * are added last one first, so the targets of the jumps are known, and the
+ * program is turned around afterwards.
+ * @e: The expression.
+ * @n: The node, whose names and filters are taken over by the program.
+ * @on_true: Where to go if the node is true.
+ * @on_false: Where to go if the node is false.
+ * Returns: The first instruction of the node.
+ */
+static int lower(expr *e, node *n, int on_true, int on_false){
+	switch(n->kind){
+		case KIND_AND:
+			for(size_t i = n->num_kids; i > 0; i--){
+				on_true = lower(e, n->kids[i-1], on_true, on_false);
+			}
+			return on_true;
+		case KIND_OR:
+			for(size_t i = n->num_kids; i > 0; i--){
+				on_false = lower(e, n->kids[i-1], on_true, on_false);
+			}
+			return on_false;
+		case KIND_NOT:
+			return lower(e, n->kids[0], on_false, on_true);
+		default:
+			break;
+	}
+
+	if(e->num_instructions == e->max_instructions){
+		e->max_instructions = (e->max_instructions > 0) ?
+				e->max_instructions * 2 : 16;
+		e->program = xrealloc(e->program,
+				e->max_instructions * sizeof(*e->program));
+	}
+
+	struct instruction *in = &e->program[e->num_instructions];
+	in->kind = n->kind;
+	in->type = n->type;
+	in->next[0] = on_false;
+	in->next[1] = on_true;
+	in->names = n->names;
+	in->meta = n->meta;
+	n->names = NULL;
+	n->meta = NULL;
+
+	if(in->meta != NULL){
+		e->stat_mask |= meta_filter_mask(in->meta);
+	}
+	if(in->kind == KIND_PRUNE){
+		e->may_prune = true;
+	}
+
+	return (int)e->num_instructions++;
+}
+
+/**
+ * turn_around() - Puts the program, which was added last instruction first,
+ * in the order it runs.
+ * @e: The expression.
+ */
+static void turn_around(expr *e){
+	int last = (int)e->num_instructions - 1;
+
+	for(size_t i = 0; i < e->num_instructions; i++){
+		for(int j = 0; j < 2; j++){
+			if(e->program[i].next[j] >= 0){
+				e->program[i].next[j] = last - e->program[i].next[j];
+			}
+		}
+	}
+
+	for(size_t i = 0; i < e->num_instructions / 2; i++){
+		struct instruction tmp = e->program[i];
+		e->program[i] = e->program[last - i];
+		e->program[last - i] = tmp;
+	}
+}
+
+/**
+ * free_tokens() - Removes the tokens of an expression.
+ * @e: The expression.
+ */
+static void free_tokens(expr *e){
+	for(size_t i = 0; i < e->num_tokens; i++){
+		free(e->tokens[i].pattern);
+		if(e->tokens[i].meta != NULL){
+			meta_filter_kill(e->tokens[i].meta);
+		}
+	}
+	free(e->tokens);
+	e->tokens = NULL;
+	e->num_tokens = 0;
+	e->max_tokens = 0;
+}
+
+/**
+ * expr_compile() - Parses the tokens and lowers them into the program. The
+ * expression given by the tokens must be true for a file to match, and so
+ * must the type and the names if given. No token may be added afterwards.
+ * @e: The expression.
+ * @ignore_case: If true, -name matches letters regardless of their case.
+ * @type: The type a file must have, or 'a' for any type.
+ * @names: A compiled set of names of which one must match, or NULL. The
+ * expression takes it over.
+ * Returns: NULL on success, or a description of the error.
+ */
+const char *expr_compile(expr *e, bool ignore_case, char type,
+		name_set *names){
+	struct parser p = {e->tokens, e->num_tokens, 0, ignore_case, NULL};
+	node *root = node_new(KIND_AND);
+
+	if(e->num_tokens > 0){
+		node *n = parse_or(&p);
+
+		if((n != NULL) && (p.pos < p.num_tokens)){
+			p.error = (p.tokens[p.pos].kind == KIND_CLOSE) ?
+					"unexpected ')'" : "expected a test";
+			node_kill(n);
+			n = NULL;
+		}
+		if(n == NULL){
+			node_kill(root);
+			if(names != NULL){
+				name_set_kill(names);
+			}
+			return p.error;
+		}
+		node_add_kid(root, n);
+	}
+
+	if(type != 'a'){
+		node *n = node_new(KIND_TYPE);
+		n->type = type;
+		node_add_kid(root, n);
+	}
+	if(names != NULL){
+		node *n = node_new(KIND_NAME);
+		n->names = names;
+		node_add_kid(root, n);
+	}
+
+	root = flatten(root);
+	reorder(root);
+	lower(e, root, GOTO_TRUE, GOTO_FALSE);
+	turn_around(e);
+	node_kill(root);
+
+	free_tokens(e);
+
+	return NULL;
+}
+
+/**
+ * expr_stat_mask() - Gives the statx() fields the tests of the compiled
+ * expression need.
+ * @e: The expression.
+ * Returns: The STATX_* mask, 0 if no test needs statx().
+ */
+unsigned int expr_stat_mask(const expr *e){
+	return e->stat_mask;
+}
+
+/**
+ * expr_may_prune() - Checks if the compiled expression holds a -prune.
+ * @e: The expression.
+ * Returns: true if running the expression may set prune, else false.
+ */
+bool expr_may_prune(const expr *e){
+	return e->may_prune;
+}
+
+/**
+ * expr_run() - Checks a file against the compiled expression. If a test needs
+ * the file examined and info is NULL, the run stops. The caller should then
+ * examine the file with the fields of expr_stat_mask() and call again, and the
+ * run continues where it stopped.
+ * @e: The expression.
+ * @file: The file, with pc and prune zeroed on the first call.
+ * Returns: EXPR_TRUE or EXPR_FALSE, or EXPR_NEED_INFO if the file must be
+ * examined first.
+ */
+enum expr_result expr_run(const expr *e, expr_file *file){
+	int pc = (e->num_instructions > 0) ? file->pc : GOTO_TRUE;
+
+	while(pc >= 0){
+		const struct instruction *in = &e->program[pc];
+		bool pass;
+
+		switch(in->kind){
+			case KIND_TYPE:
+				pass = (file->type == in->type);
+				break;
+			case KIND_NAME:
+				pass = name_set_match(in->names, file->name);
+				break;
+			case KIND_META:
+				if(file->info == NULL){
+					file->pc = pc;
+					return EXPR_NEED_INFO;
+				}
+				pass = meta_filter_match(in->meta, file->info);
+				break;
+			case KIND_PRUNE:
+			default:
+				file->prune = true;
+				pass = true;
+				break;
+		}
+
+		pc = in->next[pass];
+	}
+
+	return (pc == GOTO_TRUE) ? EXPR_TRUE : EXPR_FALSE;
+}
+
+/**
+ * expr_kill() - Removes the expression.
+ * @e: The expression which to remove.
+ */
+void expr_kill(expr *e){
+	free_tokens(e);
+
+	for(size_t i = 0; i < e->num_instructions; i++){
+		if(e->program[i].names != NULL){
+			name_set_kill(e->program[i].names);
+		}
+		if(e->program[i].meta != NULL){
+			meta_filter_kill(e->program[i].meta);
+		}
+	}
+	free(e->program);
+	free(e);
+}
@@ -0,0 +1,110 @@
+#ifndef __EXPR_H_
+#define __EXPR_H_
+
+#include <stdbool.h>
+#include <sys/stat.h>
+
+#include "name_set.h"
+
+/*
+ * An expression of tests on a file, like that of find, with the operators
+ * -not (or '!'), -and (or -a, or nothing between two tests), -or (or -o) and
+ * parentheses. The tests are -name, -type, the metadata tests of meta_filter.h
+ * and -prune, which is always true and keeps a directory from being searched.
+ *
+ * The tokens are parsed into a tree, which is then lowered into a flat
+ * program. Every instruction of the program is one test with the instruction
+ * to go to when it passes and the one to go to when it fails, so -and, -or
+ * and -not cost nothing when a file is checked. Before lowering, the operands
+ * of each -and and -or are reordered so the cheap tests, on the type and the
+ * name, run before the ones needing statx(). Operands are never moved past a
+ * -prune. A run of metadata tests joined by -and becomes one instruction.
+ * Once compiled the expression is only read, so any number of threads may
+ * check files against it at once. struct statx needs _GNU_SOURCE.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The expression type.
+typedef struct expr expr;
+
+// A file being checked against an expression.
+typedef struct expr_file{
+	const char *name; //The name, without any directory
+	char type; //'f' for file, 'd' for directory, 'l' for link, '?' else
+	const struct statx *info; //NULL if the file has not been examined
+	bool prune; //Set when a -prune is run on the file
+	int pc; //Where to continue, 0 at the start
+}expr_file;
+
+// The results of expr_run().
+enum expr_result{
+	EXPR_FALSE,
+	EXPR_TRUE,
+	EXPR_NEED_INFO
+};
+
+/**
+ * expr_new() - Create a new and empty expression, which every file matches.
+ * Returns: A pointer to the new expression.
+ */
+expr *expr_new(void);
+
+/**
+ * expr_add() - Adds the next token of the expression. Must be called before
+ * expr_compile().
+ * @e: The expression.
+ * @token: The token without the '-', like "name", "or", "(" or "size".
+ * @arg: The argument of the test, or NULL for an operator or -prune.
+ * Returns: NULL on success, or a description of the error.
+ */
+const char *expr_add(expr *e, const char *token, const char *arg);
+
+/**
+ * expr_compile() - Parses the tokens and lowers them into the program. The
+ * expression given by the tokens must be true for a file to match, and so
+ * must the type and the names if given. No token may be added afterwards.
+ * @e: The expression.
+ * @ignore_case: If true, -name matches letters regardless of their case.
+ * @type: The type a file must have, or 'a' for any type.
+ * @names: A compiled set of names of which one must match, or NULL. The
+ * expression takes it over.
+ * Returns: NULL on success, or a description of the error.
+ */
+const char *expr_compile(expr *e, bool ignore_case, char type,
+		name_set *names);
+
+/**
+ * expr_stat_mask() - Gives the statx() fields the tests of the compiled
+ * expression need.
+ * @e: The expression.
+ * Returns: The STATX_* mask, 0 if no test needs statx().
+ */
+unsigned int expr_stat_mask(const expr *e);
+
+/**
+ * expr_may_prune() - Checks if the compiled expression holds a -prune.
+ * @e: The expression.
+ * Returns: true if running the expression may set prune, else false.
+ */
+bool expr_may_prune(const expr *e);
+
+/**
+ * expr_run() - Checks a file against the compiled expression. If a test needs
+ * the file examined and info is NULL, the run stops. The caller should then
+ * examine the file with the fields of expr_stat_mask() and call again, and the
+ * run continues where it stopped.
+ * @e: The expression.
+ * @file: The file, with pc and prune zeroed on the first call.
+ * Returns: EXPR_TRUE or EXPR_FALSE, or EXPR_NEED_INFO if the file must be
+ * examined first.
+ */
+enum expr_result expr_run(const expr *e, expr_file *file);
+
+/**
+ * expr_kill() - Removes the expression.
+ * @e: The expression which to remove.
+ */
+void expr_kill(expr *e);
+
+#endif //__EXPR_H_
@@ -0,0 +1,3146 @@
+/* For statx() */
+#define _GNU_SOURCE
+
+#include "libmfind.h"
+
+#include "content_scan.h"
+#include "deque.h"
+#include "dir_node.h"
+#include "dir_reader.h"
+#include "entry_batch.h"
+#include "path_arena.h"
+#include "search_stats.h"
+#include "uring.h"
+#include "visited_set.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+
+/*
+ * The search engine of mfind as a library. A search is a context holding all
+ * the state of one search, so any number of searches may run at once in one
+ * process. Every file matching is handed to a callback, or taken one at a
+ * time from an iterator, with its name, the directory holding it and its
+ * type, unformatted. The threads of a search either are its own, or are
+ * borrowed from a pool which searches running at the same time share: a
+ * search takes the threads of the pool which are free when it starts, and
+ * searches with the ones it got until it is done.
+ *
+ * Errors on the files searched are written to stderr and counted, and a
+ * failure to allocate memory ends the process, like in the rest of mfind.
+ * struct statx needs _GNU_SOURCE.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+/* A directory being opened through io_uring. The path must live until the
+ * open completes and is then used for reading the directory. */
+typedef struct uring_slot{
+	dir_node *dir;
+	char *path;
+	size_t path_size;
+	int fd; //-errno if the open failed
+}uring_slot;
+
+/* The state of a worker using the io_uring engine. Up to depth directories
+ * are being opened or waiting to be read at once, and the entries of a
+ * directory which have no d_type are examined with a batch of statx requests
+ * which are all in flight together. */
+typedef struct uring_engine{
+	uring *ring;
+	unsigned depth;
+	uring_slot *slots;
+	unsigned *free_slots;
+	unsigned num_free;
+	unsigned *ready; //Slots of opened directories waiting to be read
+	unsigned num_ready;
+	unsigned opens_in_flight;
+	unsigned num_stats;
+	unsigned stats_in_flight;
+	struct statx *stat_bufs;
+	int *stat_results;
+	char (*stat_names)[NAME_MAX + 1];
+}uring_engine;
+
+/* A subdirectory held back until its directory has been read, so the
+ * subdirectories can be queued by their inode numbers with -order inode. */
+typedef struct queued_child{
+	dir_node *dir;
+	ino_t ino;
+}queued_child;
+
+/* A directory whose entries are handed out in batches to be checked by other
+ * workers than its reader. The reader and every batch hold a reference, and
+ * the last one done with it closes it. */
+typedef struct shared_dir{
+	dir_node *dir; //Holding a reference of its own
+	int fd; //A duplicate, since the reader closes its own
+	atomic_int refs;
+	char path[];
+}shared_dir;
+
+/* A directory of the index which has changed since the index was written,
+ * found by the -fresh check. */
+typedef struct changed_dir{
+	dir_node *dir;
+	size_t id; //Its number in the index
+}changed_dir;
+
+/* What the -fresh check found of a directory of the index. */
+enum index_dir_state{
+	INDEX_DIR_FRESH, //Unchanged, the index holds what is in it
+	INDEX_DIR_CHANGED, //To be read again
+	INDEX_DIR_GONE, //Removed, or no longer a directory
+	INDEX_DIR_PRUNED //Changed, but below a pruned directory
+};
+
+/* A search thread and the deque holding the directories it has found. The
+ * thread pushes and pops its own deque without locking and steals from the
+ * deques of the other workers when its own deque is empty. */
+typedef struct worker{
+	mfind_search *search; //The search it belongs to
+	deque *dirs_to_check;
+	path_arena *paths; //Where the nodes of the found directories are kept
+	char *path_buf; //The path of the directory being checked
+	size_t path_buf_size;
+	dir_reader *reader;
+	uring_engine *engine; //NULL when the normal system calls are used
+	index_builder *index; //The files found for -D, NULL without -D
+	dir_cache_writer *cache_writer; //The directories read, NULL without -c
+	changed_dir *changed; //Those this worker found with -fresh
+	size_t num_changed;
+	size_t max_changed;
+	queued_child *children; //Of the directory being read, -order inode
+	size_t num_children;
+	size_t max_children;
+	ino_t entry_ino; //The inode of the file being checked
+	unsigned long read_entries; //Of the directory being read
+	shared_dir *shared; //The directory being read, once it is handed out
+	entry_batch *batch; //The entries being collected to hand out
+	content_scanner *scanner; //For -grep, NULL without it
+	int id;
+	worker_stats stats; //Only written by this worker
+	atomic_ulong progress; //stats.dirs, for the watcher of the search
+}worker;
+
+/* What the watcher of the search saw at one look at it. */
+typedef struct pool_sample{
+	double wall; //Seconds
+	double cpu; //Seconds of user and system time of all threads
+	unsigned long dirs; //Directories checked
+}pool_sample;
+
+/* The threads shared by searches. A search borrows the free ones when it
+ * starts, and each is handed one worker of the search to run. */
+struct mfind_pool{
+	pthread_t *threads;
+	int num_threads;
+	int num_free; //Not borrowed by any search
+	worker **jobs; //Handed to the pool, not yet taken by a thread
+	int num_jobs;
+	bool closing;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+/* The state of one search, shared by its workers. What is set up when the
+ * search is created is only read afterwards. */
+struct mfind_search{
+	mfind_pool *pool; //NULL if the search starts threads of its own
+
+	/* The workers. Worker 0 is the thread running the search. */
+	worker *workers;
+	int num_workers;
+	int max_workers;
+
+	/* The start directories, none when an index is searched. */
+	char **start_dirs;
+	int num_start_dirs;
+
+	/* The expression a file must match to be handed out. */
+	expr *search_expr;
+
+	/* The files less deep than this below the start directories are not
+	 * checked, and the directories this deep are not searched. */
+	unsigned int min_depth;
+	unsigned int max_depth;
+
+	/* The number of matches after which the search stops, 0 if it is never
+	 * stopped early, and the number of matches so far, counted only then. */
+	unsigned long max_matches;
+	atomic_ulong num_matches;
+
+	/* Set when the search has been stopped early. The workers then drop the
+	 * directories left in the deques instead of checking them. */
+	atomic_bool search_cancelled;
+
+	/* The text the files must hold, NULL if the contents are not searched,
+	 * and the largest file searched for it, 0 if there is no limit. */
+	content_pattern *search_content;
+	off_t grep_max_size;
+
+	/* If the system calls are timed and the queue sampled, and the samples
+	 * taken by the watcher of the search. */
+	bool stats_wanted;
+	stats_timeline *search_timeline;
+
+	/* When the search started and ended, in seconds of the monotonic
+	 * clock. */
+	double search_start;
+	double search_end;
+
+	enum mfind_order search_order;
+
+	/* The size of each worker's getdents64 buffer. 0 means readdir() is
+	 * used. */
+	size_t dir_buffer_size;
+
+	/* The index written of all the files found, NULL if none is. */
+	char *index_to_write;
+
+	/* The index searched instead of the start directories, NULL if the
+	 * start directories are searched. */
+	path_index *search_index;
+
+	/* The cache of the entries of directories, NULL if none is used. Only
+	 * read once opened, while each worker appends through its own writer. */
+	dir_cache *search_cache;
+
+	/* If the directories of the index are checked for changes, and the
+	 * state each was found in. A state is only set by the worker reading
+	 * the directory in the index. */
+	bool index_fresh;
+	unsigned char *index_dir_states;
+
+	/* The next block of the index to check or search, taken by the
+	 * workers, and the number of changed directories the check found. */
+	atomic_size_t next_block_to_check;
+	atomic_size_t next_block_to_search;
+	atomic_size_t num_changed_dirs;
+
+	/* Keeps the workers in step between the passes over the index. */
+	pthread_barrier_t index_barrier;
+
+	/* The batches of entries of huge directories, handed out by the workers
+	 * reading them to be checked by the others. NULL when the entries are
+	 * always checked by the reader: with one thread, and with io_uring, a
+	 * cache and an index written, whose state of the directory being read
+	 * belongs to the reader. */
+	batch_queue *entry_batches;
+
+	/* The statx() fields asked for when a file is examined. */
+	unsigned int file_stat_mask;
+
+	/* The flags of statx() when a file is examined, 0 when links are
+	 * followed, and the directories read so far, only kept then. */
+	int stat_flags;
+	visited_set *visited;
+
+	/* The number of directories each worker keeps in flight through
+	 * io_uring. 0 means the io_uring engine is not used. */
+	unsigned uring_depth;
+
+	/* If the number of threads searching is adapted while searching, and
+	 * the number of workers which may search, the others are parked. Always
+	 * all of them otherwise. */
+	bool pool_is_auto;
+	atomic_int active_workers;
+
+	/* The number of processors, which bounds the threads running at once. */
+	int num_cpus;
+
+	/* What next_pool_size() remembers between the looks at the search. */
+	double last_rate;
+	int last_change;
+	int cooldown;
+
+	atomic_uint err_count;
+
+	/* The number of directories and batches of entries which are queued or
+	 * being checked. The search is done when this reaches zero, since only
+	 * a directory or batch being checked can queue new ones. */
+	atomic_long pending_dirs;
+
+	/* Idle workers sleep on idle_cond until a directory is queued or the
+	 * search is done. idle_workers lets add_dir_to_list() skip the lock
+	 * when nobody sleeps. Parked workers and the watcher of the search
+	 * sleep on pool_cond, and the thread running the search waits on
+	 * threads_cond for the threads borrowed from a pool to be done. All
+	 * are under idle_lock. */
+	atomic_int idle_workers;
+	bool search_done;
+	int borrowed_running;
+	pthread_mutex_t idle_lock;
+	pthread_cond_t idle_cond;
+	pthread_cond_t pool_cond;
+	pthread_cond_t threads_cond;
+
+	/* Where the files matching go. */
+	mfind_match_fn on_match;
+	void *match_arg;
+
+	bool has_run;
+};
+
+/* The number of matches an iterator holds before the search waits for them
+ * to be taken. */
+#define ITER_QUEUE_SIZE 1024
+
+/* A search run by a thread of its own, whose matches are queued for the
+ * user to take. */
+struct mfind_iter{
+	mfind_search *search; //The search it runs
+	pthread_t runner;
+	char *paths[ITER_QUEUE_SIZE]; //The matches as whole paths
+	char types[ITER_QUEUE_SIZE];
+	size_t first;
+	size_t num_queued;
+	char *taken; //The path handed out last
+	bool done; //The search has returned
+	bool stopped; //The user wants no more matches
+	unsigned int errors;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+/* The entries of a directory its reader checks before it hands out any, so
+ * only huge directories are shared. */
+#define FAN_OUT_MIN_ENTRIES 4096
+
+/* How often the watcher of the search looks at it, in ms. */
+#define WATCH_INTERVAL_MS 20
+
+/* The number of looks after a change was undone before the next change. */
+#define POOL_COOLDOWN 5
+
+/* The most threads auto_pool_max_threads() asks for, per processor and in
+ * all. */
+#define POOL_THREADS_PER_CPU 8
+#define POOL_MIN_MAX_THREADS 16
+#define POOL_MAX_THREADS 64
+
+/* Function prototypes */
+static const char *check_options(const mfind_options *o);
+static int borrow_threads(mfind_pool *p, int wanted);
+static void lend_workers(mfind_search *s);
+static void *run_pool_thread(void *arg);
+static void *run_iter_search(void *arg);
+static bool queue_iter_match(const mfind_match *m, void *arg);
+static void thread_and_start_search(mfind_search *s);
+static void *search_through_list(void *arg);
+static void finish_dir(worker *self, dir_node *dir);
+static void check_directory(worker *self, dir_node *dir);
+static int open_dir_by_steps(dir_node *dir);
+static bool open_needs_steps(const mfind_search *s, int err);
+static void report_dir_error(mfind_search *s, const char *dir_path);
+static void read_directory(worker *self, int dir_fd, dir_node *dir,
+		const char *dir_path);
+static bool read_cached_directory(worker *self, int dir_fd, dir_node *dir,
+		const char *dir_path);
+static void check_file(worker *self, int dir_fd, dir_node *dir,
+		const char *dir_path, const char *name, unsigned char d_type);
+static bool hand_out_entry(worker *self, int dir_fd, dir_node *dir,
+		const char *dir_path, const dir_entry *entry);
+static void hand_out_batch(worker *self);
+static bool check_handed_out_batch(worker *self);
+static void check_batch(worker *self, entry_batch *batch);
+static shared_dir *share_dir(int dir_fd, dir_node *dir, const char *dir_path);
+static void release_shared_dir(shared_dir *shared);
+static void check_file_of_type(worker *self, int dir_fd, dir_node *dir,
+		const char *dir_path, const char *name, char type,
+		const struct statx *file_info);
+static bool matches_expression(worker *self, int dir_fd, const char *dir_path,
+		expr_file *file);
+static bool matches_content(worker *self, int dir_fd, const char *dir_path,
+		const char *name, char type);
+static void report_match(worker *self, int dir_fd, const char *dir_path,
+		const char *name, char type);
+static uring_engine *uring_engine_new(unsigned depth);
+static void uring_engine_kill(uring_engine *e);
+static void search_with_uring(worker *self);
+static void drop_uring_dirs(worker *self);
+static void reap_completions(worker *self);
+static void defer_stat(worker *self, int dir_fd, dir_node *dir,
+		const char *dir_path, const char *name);
+static void flush_stats(worker *self, int dir_fd, dir_node *dir,
+		const char *dir_path);
+static void search_through_index(worker *self);
+static void check_index_dirs(worker *self);
+static void check_index_dir(worker *self, const index_entry *entry);
+static void search_index_blocks(worker *self);
+static bool check_index_entry(worker *self, const index_entry *entry);
+static bool matches_index_entry(worker *self, const index_entry *entry,
+		expr_file *file);
+static void queue_changed_dirs(worker *self);
+static bool is_indexed_dir(mfind_search *s, const char *dir_path,
+		const char *name);
+static void write_index(mfind_search *s);
+static char type_from_dirent(unsigned char d_type);
+static char type_from_mode(mode_t mode);
+static bool wait_for_work(worker *self);
+static bool work_is_available(mfind_search *s);
+static void wake_idle_worker(mfind_search *s);
+static void finish_search(mfind_search *s);
+static int auto_pool_max_threads(mfind_search *s);
+static void *watch_search(void *arg);
+static void adapt_pool(mfind_search *s, const pool_sample *last,
+		const pool_sample *now);
+static int next_pool_size(mfind_search *s, int active, double rate,
+		double busy, long queued);
+static void take_pool_sample(mfind_search *s, pool_sample *sample);
+static bool worker_is_parked(const worker *self);
+static void park_worker(worker *self);
+static void cancel_search(mfind_search *s);
+static bool search_is_cancelled(const mfind_search *s);
+static void initialize_workers(mfind_search *s, int num_of_threads);
+static void check_input_arguments(worker *self);
+static void check_input_argument(worker *self, char *arg);
+static int stat_file(worker *self, int dir_fd, const char *name, int flags,
+		unsigned int mask, struct statx *info);
+static int stat_search_file(worker *self, int dir_fd, const char *name,
+		unsigned int mask, struct statx *info);
+static bool is_broken_link(int err);
+static bool first_visit(worker *self, int dir_fd, const char *dir_path);
+static double monotonic_seconds(void);
+static void count_error(mfind_search *s);
+static void remove_leftover_dirs_from_list(mfind_search *s);
+static void add_dir_to_list(worker *self, dir_node *dir);
+static void add_child_to_list(worker *self, dir_node *dir);
+static void queue_children(worker *self);
+static int compare_children(const void *a, const void *b);
+static dir_node *get_dir_from_list(worker *self);
+
+/**
+ * mfind_options_init() - Sets the options to their defaults: one thread, in
+ * depth first order, without any limits. The expression and the start
+ * directories must still be given.
+ * @o: The options.
+ */
+void mfind_options_init(mfind_options *o){
+	memset(o, 0, sizeof(*o));
+	o->threads = 1;
+	o->order = MFIND_ORDER_DFS;
+	o->max_depth = UINT_MAX;
+	o->dir_buffer_size = DIR_READER_DEFAULT_BUFFER_SIZE;
+}
+
+/**
+ * mfind_pool_new() - Create a new pool and start its threads, which wait
+ * until a search borrows them.
+ * @num_threads: The number of threads, 1 or more.
+ * Returns: A pointer to the new pool.
+ */
+mfind_pool *mfind_pool_new(int num_threads){
+	mfind_pool *p = calloc(1, sizeof(*p));
+	if(p == NULL){
+		perror("libmfind.c");
+		exit(errno);
+	}
+
+	p->threads = calloc(num_threads, sizeof(*p->threads));
+	p->jobs = calloc(num_threads, sizeof(*p->jobs));
+	if((p->threads == NULL) || (p->jobs == NULL)){
+		perror("libmfind.c");
+		exit(errno);
+	}
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->cond, NULL);
+
+	for(int i = 0; i < num_threads; i++){
+		if(pthread_create(&p->threads[p->num_threads], NULL, run_pool_thread,
+				p)){
+			perror("pthread");
+			continue;
+		}
+		p->num_threads++;
+	}
+	p->num_free = p->num_threads;
+
+	return p;
+}
+
+/**
+ * mfind_pool_kill() - Ends the threads of the pool and removes it. No search
+ * may be running with it.
+ * @p: The pool which to remove, or NULL.
+ */
+void mfind_pool_kill(mfind_pool *p){
+	if(p == NULL){
+		return;
+	}
+
+	pthread_mutex_lock(&p->lock);
+	p->closing = true;
+	pthread_cond_broadcast(&p->cond);
+	pthread_mutex_unlock(&p->lock);
+
+	for(int i = 0; i < p->num_threads; i++){
+		if(pthread_join(p->threads[i], NULL)){
+			perror("pthread");
+		}
+	}
+
+	pthread_mutex_destroy(&p->lock);
+	pthread_cond_destroy(&p->cond);
+	free(p->threads);
+	free(p->jobs);
+	free(p);
+}
+
+/**
+ * mfind_search_new() - Create a new search. The threads searching are the
+ * thread running it and threads - 1 more, which are borrowed from the pool if
+ * one is given, else started for the search.
+ * @o: The options, taken over or copied, so they may be removed afterwards.
+ * @pool: The pool to borrow threads from, or NULL.
+ * @error: Set to a message if the options are invalid.
+ * Returns: A pointer to the new search, or NULL if the options are invalid.
+ * The expression, index and cache are then not taken over.
+ */
+mfind_search *mfind_search_new(const mfind_options *o, mfind_pool *pool,
+		const char **error){
+	const char *invalid = check_options(o);
+
+	if(invalid != NULL){
+		if(error != NULL){
+			*error = invalid;
+		}
+		return NULL;
+	}
+
+	mfind_search *s = calloc(1, sizeof(*s));
+	if(s == NULL){
+		perror("libmfind.c");
+		exit(errno);
+	}
+
+	s->pool = pool;
+	s->max_workers = o->threads;
+	s->search_expr = o->expr;
+	s->min_depth = o->min_depth;
+	s->max_depth = o->max_depth;
+	s->max_matches = o->max_matches;
+	s->grep_max_size = o->grep_max_size;
+	s->stats_wanted = o->stats;
+	s->search_order = o->order;
+	s->dir_buffer_size = o->dir_buffer_size;
+	s->search_index = o->index;
+	s->search_cache = o->cache;
+	s->index_fresh = o->index_fresh;
+	s->uring_depth = o->uring_depth;
+	s->num_cpus = 1;
+	atomic_init(&s->active_workers, 1);
+
+	pthread_mutex_init(&s->idle_lock, NULL);
+	pthread_cond_init(&s->idle_cond, NULL);
+	pthread_cond_init(&s->pool_cond, NULL);
+	pthread_cond_init(&s->threads_cond, NULL);
+
+	if(o->num_start_dirs > 0){
+		s->start_dirs = calloc(o->num_start_dirs, sizeof(*s->start_dirs));
+		if(s->start_dirs == NULL){
+			perror("libmfind.c");
+			exit(errno);
+		}
+		for(int i = 0; i < o->num_start_dirs; i++){
+			s->start_dirs[i] = strdup(o->start_dirs[i]);
+			if(s->start_dirs[i] == NULL){
+				perror("libmfind.c");
+				exit(errno);
+			}
+		}
+		s->num_start_dirs = o->num_start_dirs;
+	}
+
+	if(o->grep != NULL){
+		s->search_content = content_pattern_new(o->grep);
+	}
+
+	if(o->index_to_write != NULL){
+		s->index_to_write = strdup(o->index_to_write);
+		if(s->index_to_write == NULL){
+			perror("libmfind.c");
+			exit(errno);
+		}
+	}
+
+	//Only the fields the expression needs, and those the search keeps
+	s->file_stat_mask = STATX_TYPE | expr_stat_mask(s->search_expr);
+	if(s->index_to_write != NULL){
+		s->file_stat_mask |= STATX_MTIME;
+	}
+	if(s->search_order == MFIND_ORDER_INODE){
+		s->file_stat_mask |= STATX_INO;
+	}
+
+	s->stat_flags = AT_SYMLINK_NOFOLLOW;
+	if(o->follow_links){
+		s->stat_flags = 0;
+		s->visited = visited_set_new();
+	}
+
+	if(s->index_fresh){
+		s->index_dir_states = calloc(path_index_num_dirs(s->search_index) + 1,
+				sizeof(*s->index_dir_states));
+		if(s->index_dir_states == NULL){
+			perror("libmfind.c");
+			exit(errno);
+		}
+	}
+
+	if(o->auto_threads){
+		s->max_workers = auto_pool_max_threads(s);
+	}
+
+	return s;
+}
+
+/**
+ * mfind_search_threads() - Gives the most threads the search may use.
+ * @s: The search.
+ * Returns: The number of threads, which the thread of a match is below.
+ */
+int mfind_search_threads(const mfind_search *s){
+	return s->max_workers;
+}
+
+/**
+ * mfind_search_run() - Runs the search, in the calling thread and those of
+ * the search, and returns when it is done. With an index to write it is
+ * written at the end. A search can only be run once.
+ * @s: The search.
+ * @fn: The callback getting the files which match.
+ * @arg: Given to the callback.
+ * Returns: The number of errors.
+ */
+unsigned int mfind_search_run(mfind_search *s, mfind_match_fn fn, void *arg){
+	int num_threads = s->max_workers;
+
+	if(s->has_run){
+		fprintf(stderr, "libmfind: A search can only be run once\n");
+		return 1;
+	}
+	s->has_run = true;
+	s->on_match = fn;
+	s->match_arg = arg;
+
+	if(s->pool != NULL){
+		num_threads = 1 + borrow_threads(s->pool, s->max_workers - 1);
+		if(atomic_load(&s->active_workers) > num_threads){
+			atomic_store(&s->active_workers, num_threads);
+		}
+	}
+
+	initialize_workers(s, num_threads);
+	s->search_start = monotonic_seconds();
+
+	//The start directories are found in the index
+	if(s->search_index == NULL){
+		check_input_arguments(&s->workers[0]);
+	}
+
+	thread_and_start_search(s);
+	s->search_end = monotonic_seconds();
+
+	if(s->index_to_write != NULL){
+		write_index(s);
+	}
+
+	return atomic_load(&s->err_count);
+}
+
+/**
+ * mfind_search_print_stats() - Writes the statistics of a search which has
+ * been run.
+ * @s: The search.
+ * @out: Where to write them.
+ * @json: true for one JSON object, false for a table for people to read.
+ */
+void mfind_search_print_stats(const mfind_search *s, FILE *out, bool json){
+	double wall = s->search_end - s->search_start;
+	size_t visited = (s->visited != NULL) ? visited_set_size(s->visited) : 0;
+	const worker_stats *all[s->num_workers + 1];
+
+	for(int i = 0; i < s->num_workers; i++){
+		all[i] = &s->workers[i].stats;
+	}
+
+	if(json){
+		stats_print_json(out, all, s->num_workers, s->search_timeline, wall,
+				visited);
+	}
+	else{
+		stats_print(out, all, s->num_workers, s->search_timeline, wall,
+				visited);
+	}
+}
+
+/**
+ * mfind_search_kill() - Removes the search, which may not be running.
+ * @s: The search which to remove, or NULL.
+ */
+void mfind_search_kill(mfind_search *s){
+	if(s == NULL){
+		return;
+	}
+
+	for(int i = 0; i < s->num_workers; i++){
+		for(size_t j = 0; j < s->workers[i].num_changed; j++){
+			dir_node_release(s->workers[i].changed[j].dir);
+		}
+		dir_cache_writer_kill(s->workers[i].cache_writer);
+		free(s->workers[i].children);
+	}
+	if((s->search_index != NULL) && (s->num_workers > 0)){
+		pthread_barrier_destroy(&s->index_barrier);
+	}
+	remove_leftover_dirs_from_list(s);
+
+	expr_kill(s->search_expr);
+	path_index_close(s->search_index);
+	dir_cache_close(s->search_cache);
+	content_pattern_kill(s->search_content);
+	stats_timeline_kill(s->search_timeline);
+	visited_set_kill(s->visited);
+	free(s->index_dir_states);
+	free(s->index_to_write);
+	for(int i = 0; i < s->num_start_dirs; i++){
+		free(s->start_dirs[i]);
+	}
+	free(s->start_dirs);
+
+	pthread_mutex_destroy(&s->idle_lock);
+	pthread_cond_destroy(&s->idle_cond);
+	pthread_cond_destroy(&s->pool_cond);
+	pthread_cond_destroy(&s->threads_cond);
+	free(s);
+}
+
+/**
+ * mfind_iter_new() - Starts running a search in a thread of its own, for its
+ * files to be taken one at a time. The search should not be touched until
+ * the iterator is removed.
+ * @s: The search, which has not been run.
+ * Returns: A pointer to the new iterator.
+ */
+mfind_iter *mfind_iter_new(mfind_search *s){
+	mfind_iter *it = calloc(1, sizeof(*it));
+	if(it == NULL){
+		perror("libmfind.c");
+		exit(errno);
+	}
+
+	it->search = s;
+	pthread_mutex_init(&it->lock, NULL);
+	pthread_cond_init(&it->cond, NULL);
+
+	if(pthread_create(&it->runner, NULL, run_iter_search, it)){
+		perror("pthread");
+		exit(EXIT_FAILURE);
+	}
+
+	return it;
+}
+
+/**
+ * mfind_iter_next() - Takes the next file which matched, waiting for it if
+ * the search is still running. The match has the whole path in name, with
+ * dir_fd AT_FDCWD, and is valid until the next call.
+ * @it: The iterator.
+ * @m: Filled in with the file.
+ * Returns: true if a file was given, false when the search is done.
+ */
+bool mfind_iter_next(mfind_iter *it, mfind_match *m){
+	free(it->taken);
+	it->taken = NULL;
+
+	pthread_mutex_lock(&it->lock);
+	while((it->num_queued == 0) && !it->done){
+		pthread_cond_wait(&it->cond, &it->lock);
+	}
+	if(it->num_queued == 0){
+		pthread_mutex_unlock(&it->lock);
+		return false;
+	}
+
+	it->taken = it->paths[it->first];
+	m->dir_path = NULL;
+	m->name = it->taken;
+	m->dir_fd = AT_FDCWD;
+	m->type = it->types[it->first];
+	m->thread = 0;
+	it->first = (it->first + 1) % ITER_QUEUE_SIZE;
+	it->num_queued--;
+
+	//The search waits for room when the queue is full
+	pthread_cond_broadcast(&it->cond);
+	pthread_mutex_unlock(&it->lock);
+
+	return true;
+}
+
+/**
+ * mfind_iter_kill() - Stops the search if it is still running, waits for it
+ * and removes the iterator. The search can then be removed.
+ * @it: The iterator.
+ * Returns: The number of errors of the search.
+ */
+unsigned int mfind_iter_kill(mfind_iter *it){
+	unsigned int errors;
+
+	pthread_mutex_lock(&it->lock);
+	it->stopped = true;
+	pthread_cond_broadcast(&it->cond);
+	pthread_mutex_unlock(&it->lock);
+
+	if(pthread_join(it->runner, NULL)){
+		perror("pthread");
+	}
+	errors = it->errors;
+
+	while(it->num_queued > 0){
+		free(it->paths[it->first]);
+		it->first = (it->first + 1) % ITER_QUEUE_SIZE;
+		it->num_queued--;
+	}
+	free(it->taken);
+	pthread_mutex_destroy(&it->lock);
+	pthread_cond_destroy(&it->cond);
+	free(it);
+
+	return errors;
+}
+
+/**
+ * check_options() - Checks that the options of a search can be used
+ * together.
+ *
+ * @param o The options.
+ * @returns NULL if they can, else a message telling why not.
+ */
+static const char *check_options(const mfind_options *o){
+	if(o->expr == NULL){
+		return "No expression given";
+	}
+	if(!o->auto_threads && (o->threads < 1)){
+		return "The number of threads must be 1 or more";
+	}
+	if((o->index != NULL) && ((o->min_depth > 0) ||
+			(o->max_depth != UINT_MAX))){
+		return "The depth can not be limited when an index is searched";
+	}
+	if(o->index_fresh && (o->index == NULL)){
+		return "Only an index can be checked for changes";
+	}
+	if((o->index != NULL) && (o->num_start_dirs > 0)){
+		return "No start directories can be given when an index is searched";
+	}
+	if((o->index == NULL) && (o->num_start_dirs < 1)){
+		return "No start directory given";
+	}
+	if((o->index != NULL) && (o->index_to_write != NULL)){
+		return "An index can not be written when an index is searched";
+	}
+	if((o->grep != NULL) && ((*o->grep == '\0') ||
+			(strlen(o->grep) > CONTENT_SCAN_MAX_TEXT))){
+		return "The text searched for is empty or too long";
+	}
+	if(o->uring_depth > MFIND_MAX_URING_DEPTH){
+		return "The io_uring depth is too large";
+	}
+	if((o->dir_buffer_size > 0) &&
+			(o->dir_buffer_size < DIR_READER_MIN_BUFFER_SIZE)){
+		return "The directory buffer is too small";
+	}
+	if(o->follow_links && ((o->index != NULL) || (o->cache != NULL) ||
+			(o->index_to_write != NULL))){
+		return "Links can not be followed with an index or a cache";
+	}
+
+	return NULL;
+}
+
+/**
+ * borrow_threads() - Takes up to a number of the free threads of a pool, for
+ * a search to hand its workers to.
+ *
+ * @param p The pool.
+ * @param wanted The number of threads wanted.
+ * @returns The number of threads taken, 0 or more.
+ */
+static int borrow_threads(mfind_pool *p, int wanted){
+	pthread_mutex_lock(&p->lock);
+	int taken = (wanted < p->num_free) ? wanted : p->num_free;
+
+	p->num_free -= taken;
+	pthread_mutex_unlock(&p->lock);
+
+	return taken;
+}
+
+/**
+ * lend_workers() - Hands all the workers of a search but worker 0 to the
+ * threads borrowed from its pool.
+ *
+ * @param s The search.
+ */
+static void lend_workers(mfind_search *s){
+	mfind_pool *p = s->pool;
+
+	s->borrowed_running = s->num_workers - 1;
+
+	pthread_mutex_lock(&p->lock);
+	for(int i = 1; i < s->num_workers; i++){
+		p->jobs[p->num_jobs++] = &s->workers[i];
+	}
+	pthread_cond_broadcast(&p->cond);
+	pthread_mutex_unlock(&p->lock);
+}
+
+/**
+ * run_pool_thread() - Runs the workers handed to a thread of the pool until
+ * the pool is removed. The thread is free again once it is done with a
+ * worker.
+ *
+ * This function is the start for the threads and this requires the function to
+ * take in a void * and return a void *.
+ *
+ * @param arg The pool.
+ * @return Pointer to NULL.
+ */
+static void *run_pool_thread(void *arg){
+	mfind_pool *p = arg;
+
+	pthread_mutex_lock(&p->lock);
+	while(true){
+		while((p->num_jobs == 0) && !p->closing){
+			pthread_cond_wait(&p->cond, &p->lock);
+		}
+		if(p->num_jobs == 0){
+			break;
+		}
+		worker *job = p->jobs[--p->num_jobs];
+		pthread_mutex_unlock(&p->lock);
+
+		mfind_search *s = job->search;
+
+		search_through_list(job);
+
+		//The search may be removed as soon as the lock is let go of
+		pthread_mutex_lock(&s->idle_lock);
+		if(--s->borrowed_running == 0){
+			pthread_cond_signal(&s->threads_cond);
+		}
+		pthread_mutex_unlock(&s->idle_lock);
+
+		pthread_mutex_lock(&p->lock);
+		p->num_free++;
+	}
+	pthread_mutex_unlock(&p->lock);
+
+	return NULL;
+}
+
+/**
+ * run_iter_search() - Runs the search of an iterator, in the thread of the
+ * iterator.
+ *
+ * @param arg The iterator.
+ * @return Pointer to NULL.
+ */
+static void *run_iter_search(void *arg){
+	mfind_iter *it = arg;
+	unsigned int errors = mfind_search_run(it->search, queue_iter_match, it);
+
+	pthread_mutex_lock(&it->lock);
+	it->errors = errors;
+	it->done = true;
+	pthread_cond_broadcast(&it->cond);
+	pthread_mutex_unlock(&it->lock);
+
+	return NULL;
+}
+
+/**
+ * queue_iter_match() - Queues a file which matched for the user of an
+ * iterator to take, waiting while the queue is full.
+ *
+ * @param m The file.
+ * @param arg The iterator.
+ * @returns false if the iterator has been removed, else true.
+ */
+static bool queue_iter_match(const mfind_match *m, void *arg){
+	mfind_iter *it = arg;
+	size_t dir_len = (m->dir_path != NULL) ? strlen(m->dir_path) + 1 : 0;
+	size_t name_len = strlen(m->name);
+	char *path = malloc(dir_len + name_len + 1);
+	if(path == NULL){
+		perror("libmfind.c");
+		exit(errno);
+	}
+
+	if(m->dir_path != NULL){
+		memcpy(path, m->dir_path, dir_len - 1);
+		path[dir_len - 1] = '/';
+	}
+	memcpy(path + dir_len, m->name, name_len + 1);
+
+	pthread_mutex_lock(&it->lock);
+	while((it->num_queued == ITER_QUEUE_SIZE) && !it->stopped){
+		pthread_cond_wait(&it->cond, &it->lock);
+	}
+	if(it->stopped){
+		pthread_mutex_unlock(&it->lock);
+		free(path);
+		return false;
+	}
+
+	size_t last = (it->first + it->num_queued) % ITER_QUEUE_SIZE;
+
+	it->paths[last] = path;
+	it->types[last] = m->type;
+	it->num_queued++;
+	pthread_cond_broadcast(&it->cond);
+	pthread_mutex_unlock(&it->lock);
+
+	return true;
+}
+
+
+/**
+ * thread_and_start_search() - Starts the other workers of the search, on the
+ * threads borrowed from the pool or on threads of their own, and runs worker
+ * 0 in the calling thread until the search is done. With auto threads or
+ * statistics one more thread watches the search.
+ *
+ * @param s The search.
+ */
+static void thread_and_start_search(mfind_search *s){
+	bool watched = s->pool_is_auto || s->stats_wanted;
+	pthread_t watcher;
+	pthread_t thread_id[s->num_workers];
+
+	if(watched && pthread_create(&watcher, NULL, watch_search, s)){
+		perror("pthread");
+		watched = false;
+		s->pool_is_auto = false;
+	}
+
+	if(s->pool != NULL){
+		lend_workers(s);
+	}
+	else{
+		for(int i = 1; i < s->num_workers; i++){
+			if(pthread_create(&thread_id[i], NULL, search_through_list,
+					&s->workers[i])){
+				perror("pthread");
+				thread_id[i] = 0;
+			}
+		}
+	}
+
+	search_through_list(&s->workers[0]);
+
+	if(s->pool == NULL){
+		for(int i = 1; i < s->num_workers; i++){
+			if((thread_id[i] != 0) && pthread_join(thread_id[i], NULL)){
+				perror("pthread");
+			}
+		}
+	}
+	else{
+		pthread_mutex_lock(&s->idle_lock);
+		while(s->borrowed_running > 0){
+			pthread_cond_wait(&s->threads_cond, &s->idle_lock);
+		}
+		pthread_mutex_unlock(&s->idle_lock);
+	}
+
+	//A search which queued no directory was never marked as done
+	finish_search(s);
+	if(watched && pthread_join(watcher, NULL)){
+		perror("pthread");
+	}
+
+}
+
+/**
+ * search_through_list() - This function starts the search through the deques.
+ * As long as the deques are not empty, the threads will take directories from
+ * their own deque or steal from the others. Batches of entries handed out from
+ * huge directories are taken first. When there is nothing to take the
+ * thread sleeps until more directories are queued. When no directory is queued
+ * or being checked any more, the function will return.
+ *
+ * This function is the start for the threads and this requires the function to
+ * take in a void * and return a void *.
+ *
+ * @param arg The worker which is running the search.
+ * @return Pointer to NULL.
+ */
+static void *search_through_list(void *arg){
+
+	worker *self = (worker *)arg;
+	mfind_search *s = self->search;
+	dir_node *dir;
+
+	//Only the directories which have changed since are read with -d
+	if(s->search_index != NULL){
+		search_through_index(self);
+	}
+
+	if(self->engine != NULL){
+		search_with_uring(self);
+	}
+	else{
+		do{
+			while(!search_is_cancelled(s)){
+				if(check_handed_out_batch(self)){
+					continue;
+				}
+				if((dir = get_dir_from_list(self)) == NULL){
+					break;
+				}
+
+				check_directory(self, dir);
+				finish_dir(self, dir);
+
+				if(worker_is_parked(self)){
+					park_worker(self);
+				}
+			}
+		}while(wait_for_work(self));
+	}
+
+	if((self->cache_writer != NULL) &&
+			(dir_cache_writer_flush(self->cache_writer) < 0)){
+		perror("cache");
+		count_error(s);
+	}
+
+	return NULL;
+}
+
+/**
+ * finish_dir() - Releases a directory which has been checked and ends the
+ * search if it was the last one.
+ *
+ * @param self The worker which checked the directory.
+ * @param dir The directory.
+ */
+static void finish_dir(worker *self, dir_node *dir){
+	mfind_search *s = self->search;
+
+	self->stats.dirs++;
+	atomic_store_explicit(&self->progress, self->stats.dirs,
+			memory_order_relaxed);
+	dir_node_release(dir);
+
+	//The last directory of the search has been checked
+	if(atomic_fetch_sub(&s->pending_dirs, 1) == 1){
+		finish_search(s);
+	}
+}
+
+/**
+ * check_directory() - Check if the given directory contains a file with the
+ * name we are searching for. The path of the directory is built into the
+ * worker's path buffer and the directory is opened once by it. The files in it
+ * are examined relative to its file descriptor, so the kernel does not walk
+ * the whole path again for every file.
+ *
+ * @param self The worker checking the directory.
+ * @param dir The directory which should be opened.
+ */
+static void check_directory(worker *self, dir_node *dir){
+	mfind_search *s = self->search;
+	char *dir_path = dir_node_path(dir, &self->path_buf, &self->path_buf_size);
+	if(dir_path == NULL){
+		count_error(s);
+		return;
+	}
+
+	uint64_t start = stats_clock(&self->stats);
+	int dir_fd = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if((dir_fd < 0) && open_needs_steps(s, errno)){
+		dir_fd = open_dir_by_steps(dir);
+	}
+	latency_add(&self->stats.open_latency, start);
+
+	if (dir_fd < 0) {
+		report_dir_error(s, dir_path);
+		return;
+	}
+
+	read_directory(self, dir_fd, dir, dir_path);
+}
+
+/**
+ * open_dir_by_steps() - Opens a directory one directory of its path at a
+ * time. A path longer than PATH_MAX, or through more followed links than the
+ * kernel resolves at once, can still be opened this way, since each step
+ * only resolves one name.
+ *
+ * @param dir The directory.
+ * @returns An open file descriptor of the directory, or -1 on failure with
+ * errno set.
+ */
+static int open_dir_by_steps(dir_node *dir){
+	if(dir->parent == NULL){
+		return open(dir->name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	}
+
+	int parent_fd = open_dir_by_steps(dir->parent);
+	if(parent_fd < 0){
+		return -1;
+	}
+
+	int dir_fd = openat(parent_fd, dir->name,
+			O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	int err = errno;
+
+	close(parent_fd);
+	errno = err;
+
+	return dir_fd;
+}
+
+/**
+ * open_needs_steps() - Tells if a directory which could not be opened by its
+ * path may still be opened by open_dir_by_steps().
+ *
+ * @param s The search.
+ * @param err The error from opening the directory, as an errno.
+ * @returns true if the path was too long, or went through too many links
+ * when links are followed, else false.
+ */
+static bool open_needs_steps(const mfind_search *s, int err){
+	return (err == ENAMETOOLONG) || ((err == ELOOP) && (s->visited != NULL));
+}
+
+/**
+ * report_dir_error() - Prints the error, in errno, from opening a directory
+ * and counts it.
+ *
+ * @param s The search.
+ * @param dir_path The path to the directory which could not be opened.
+ */
+static void report_dir_error(mfind_search *s, const char *dir_path){
+	if(errno != EACCES){ //FIXME: labres does not count this as an error...
+		count_error(s);
+	}
+	perror(dir_path);
+}
+
+/**
+ * read_directory() - Checks all the files in an opened directory, but "." and
+ * ".." are ignored. The entries are read with the worker's own reader, in
+ * large batches when getdents64 is used, unless they are taken from the cache.
+ * Past the first entries of a huge directory, those read while other workers
+ * are idle are handed out to them, see hand_out_entry(). When links are
+ * followed a directory already read, through another path, is not read again.
+ * The file descriptor is closed.
+ *
+ * @param self The worker checking the directory.
+ * @param dir_fd An open file descriptor of the directory.
+ * @param dir The directory.
+ * @param dir_path The path to the directory.
+ */
+static void read_directory(worker *self, int dir_fd, dir_node *dir,
+		const char *dir_path){
+	mfind_search *s = self->search;
+	dir_entry entry;
+	int ret = 0;
+
+	if((s->visited != NULL) && !first_visit(self, dir_fd, dir_path)){
+		if(close(dir_fd) < 0){
+			perror(dir_path);
+		}
+
+		return;
+	}
+
+	if((s->search_cache != NULL) &&
+			read_cached_directory(self, dir_fd, dir, dir_path)){
+		return;
+	}
+
+	if (dir_reader_open(self->reader, dir_fd) < 0) {
+		report_dir_error(s, dir_path);
+		dir_reader_close(self->reader);
+		if(self->cache_writer != NULL){
+			dir_cache_writer_cancel(self->cache_writer);
+		}
+
+		return;
+	}
+
+	self->read_entries = 0;
+	while (!search_is_cancelled(s) &&
+			((ret = dir_reader_next(self->reader, &entry)) > 0)) {
+
+		if((strcmp(entry.name,".") == 0) ||
+				(strcmp(entry.name, "..") == 0)){
+			continue;
+		}
+
+		self->read_entries++;
+		if(hand_out_entry(self, dir_fd, dir, dir_path, &entry)){
+			continue;
+		}
+
+		self->entry_ino = entry.ino;
+		check_file(self, dir_fd, dir, dir_path, entry.name, entry.type);
+	}
+
+	//The reader is free to check the entries collected last itself
+	if(self->batch != NULL){
+		check_batch(self, self->batch);
+		self->batch = NULL;
+	}
+	if(self->shared != NULL){
+		release_shared_dir(self->shared);
+		self->shared = NULL;
+	}
+
+	self->stats.entries += self->read_entries;
+	if(ret < 0){
+		count_error(s);
+		perror(dir_path);
+	}
+	if((self->cache_writer != NULL) && ((ret < 0) || search_is_cancelled(s))){
+		dir_cache_writer_cancel(self->cache_writer);
+	}
+
+	//The deferred stats need the directory open
+	if((self->engine != NULL) && (self->engine->num_stats > 0)){
+		flush_stats(self, dir_fd, dir, dir_path);
+	}
+
+	if(dir_reader_close(self->reader) < 0){
+		perror(dir_path);
+	}
+
+	if(self->num_children > 0){
+		queue_children(self);
+	}
+
+	if((self->cache_writer != NULL) &&
+			(dir_cache_writer_end(self->cache_writer) < 0)){
+		perror("cache");
+		count_error(s);
+	}
+}
+
+/**
+ * read_cached_directory() - Checks the files of a directory as they are in the
+ * cache, if it has not changed since it was cached. Else a record of the
+ * directory is started, which the files are added to as they are checked.
+ * When an index is written the files are always examined, so the directory
+ * is read as well.
+ *
+ * @param self The worker checking the directory.
+ * @param dir_fd An open file descriptor of the directory, closed if it was
+ * found in the cache.
+ * @param dir The directory.
+ * @param dir_path The path to the directory.
+ * @returns true if the files were taken from the cache, else false.
+ */
+static bool read_cached_directory(worker *self, int dir_fd, dir_node *dir,
+		const char *dir_path){
+	mfind_search *s = self->search;
+	struct statx dir_info;
+	dir_cache_cursor cursor;
+	const char *name;
+	char type;
+
+	if(stat_file(self, dir_fd, "", AT_EMPTY_PATH, DIR_CACHE_STAT_MASK,
+			&dir_info) < 0){
+		return false;
+	}
+
+	if((self->index != NULL) ||
+			!dir_cache_find(s->search_cache, &dir_info, &cursor)){
+		dir_cache_writer_begin(self->cache_writer, &dir_info);
+		return false;
+	}
+
+	//The cache keeps the order the directory was read in
+	self->stats.cached_dirs++;
+	self->entry_ino = 0;
+	while(!search_is_cancelled(s) &&
+			((name = dir_cache_cursor_next(&cursor, &type)) != NULL)){
+		self->stats.avoided_stats++;
+		check_file_of_type(self, dir_fd, dir, dir_path, name, type, NULL);
+	}
+
+	if(close(dir_fd) < 0){
+		perror(dir_path);
+	}
+
+	if(self->num_children > 0){
+		queue_children(self);
+	}
+
+	return true;
+}
+
+/**
+ * check_file() - Checks if the given file in a directory has the name the
+ * program is searching for. This also depends on which type of file the
+ * program is searching for. The file is handed out if the file matches what
+ * the program is searching for.
+ *
+ * The type of the file is taken from the directory entry when the file system
+ * fills in d_type. Only when it does not, or when an index is written, is the
+ * file examined with statx(), which then also fills in the fields the
+ * expression needs.
+ *
+ * If the file is a directory, a node holding its name is added to the
+ * worker's deque.
+ *
+ * @param self The worker checking the file.
+ * @param dir_fd An open file descriptor of the directory holding the file.
+ * @param dir The directory holding the file.
+ * @param dir_path The path to the directory holding the file.
+ * @param name The name of the file in the directory.
+ * @param d_type The type of the file from the directory entry.
+ */
+static void check_file(worker *self, int dir_fd, dir_node *dir,
+		const char *dir_path, const char *name, unsigned char d_type){
+	mfind_search *s = self->search;
+
+	//An index holds the modification time of every file
+	char type = (self->index == NULL) ? type_from_dirent(d_type) : '\0';
+
+	//What a followed link points to is only known by examining it
+	if((type == 'l') && (s->visited != NULL)){
+		type = '\0';
+	}
+
+	if((type == '\0') && (self->engine != NULL)){
+		defer_stat(self, dir_fd, dir, dir_path, name);
+		return;
+	}
+
+	if(type == '\0'){ //Unknown, ask the file system
+		struct statx file_info;
+
+		if(stat_search_file(self, dir_fd, name, s->file_stat_mask,
+				&file_info) < 0) {
+			fprintf(stderr, "%s/%s: %s\n", dir_path, name, strerror(errno));
+			if(self->cache_writer != NULL){
+				dir_cache_writer_cancel(self->cache_writer);
+			}
+			return;
+		}
+
+		check_file_of_type(self, dir_fd, dir, dir_path, name,
+				type_from_mode(file_info.stx_mode), &file_info);
+		return;
+	}
+
+	self->stats.avoided_stats++;
+	check_file_of_type(self, dir_fd, dir, dir_path, name, type, NULL);
+}
+
+/**
+ * hand_out_entry() - Collects an entry of a huge directory into a batch for
+ * another worker to check. A batch is only started when a worker is idle, so
+ * the reader keeps checking the entries itself while all are busy. A full
+ * batch is handed out. The first batch of a directory shares it, with a file
+ * descriptor of its own for the workers checking the batches.
+ *
+ * @param self The worker reading the directory.
+ * @param dir_fd An open file descriptor of the directory.
+ * @param dir The directory.
+ * @param dir_path The path to the directory.
+ * @param entry The entry read.
+ * @returns true if the entry was collected, false if the reader should check
+ * it.
+ */
+static bool hand_out_entry(worker *self, int dir_fd, dir_node *dir,
+		const char *dir_path, const dir_entry *entry){
+	mfind_search *s = self->search;
+
+	if(self->batch == NULL){
+		if((s->entry_batches == NULL) ||
+				(self->read_entries <= FAN_OUT_MIN_ENTRIES) ||
+				(atomic_load_explicit(&s->idle_workers,
+				memory_order_relaxed) == 0)){
+			return false;
+		}
+
+		if(self->shared == NULL){
+			self->shared = share_dir(dir_fd, dir, dir_path);
+			if(self->shared == NULL){
+				return false;
+			}
+		}
+
+		atomic_fetch_add(&self->shared->refs, 1);
+		self->batch = entry_batch_new(self->shared);
+	}
+
+	if(!entry_batch_add(self->batch, entry)){
+		hand_out_batch(self);
+		return hand_out_entry(self, dir_fd, dir, dir_path, entry);
+	}
+
+	return true;
+}
+
+/**
+ * hand_out_batch() - Queues the batch the worker has collected and wakes a
+ * sleeping worker to take it. It is counted as pending like a directory, so
+ * the search is not done before it has been checked.
+ *
+ * @param self The worker reading the directory.
+ */
+static void hand_out_batch(worker *self){
+	mfind_search *s = self->search;
+
+	atomic_fetch_add(&s->pending_dirs, 1);
+	batch_queue_push(s->entry_batches, self->batch);
+	self->batch = NULL;
+	self->stats.batches++;
+	wake_idle_worker(s);
+}
+
+/**
+ * check_handed_out_batch() - Takes a batch handed out by a worker reading a
+ * huge directory, if there is any, and checks it.
+ *
+ * @param self The worker.
+ * @returns true if a batch was checked, else false.
+ */
+static bool check_handed_out_batch(worker *self){
+	mfind_search *s = self->search;
+	entry_batch *batch;
+
+	if((s->entry_batches == NULL) ||
+			((batch = batch_queue_pop(s->entry_batches)) == NULL)){
+		return false;
+	}
+
+	check_batch(self, batch);
+
+	//The last batch of the search has been checked
+	if(atomic_fetch_sub(&s->pending_dirs, 1) == 1){
+		finish_search(s);
+	}
+
+	return true;
+}
+
+/**
+ * check_batch() - Checks the entries of a batch, like they would have been by
+ * the reader of the directory, and removes it along with its reference to the
+ * directory.
+ *
+ * @param self The worker checking the batch.
+ * @param batch The batch.
+ */
+static void check_batch(worker *self, entry_batch *batch){
+	mfind_search *s = self->search;
+	shared_dir *shared = entry_batch_owner(batch);
+	dir_entry entry;
+
+	while(!search_is_cancelled(s) && entry_batch_next(batch, &entry)){
+		self->entry_ino = entry.ino;
+		check_file(self, shared->fd, shared->dir, shared->path, entry.name,
+				entry.type);
+	}
+
+	if(self->num_children > 0){
+		queue_children(self);
+	}
+
+	entry_batch_kill(batch);
+	release_shared_dir(shared);
+}
+
+/**
+ * share_dir() - Shares a directory being read, for its entries to be checked
+ * by other workers.
+ *
+ * @param dir_fd An open file descriptor of the directory.
+ * @param dir The directory, which gets one more reference.
+ * @param dir_path The path to the directory.
+ * @returns The shared directory, holding one reference for the reader, or
+ * NULL if it could not be shared.
+ */
+static shared_dir *share_dir(int dir_fd, dir_node *dir, const char *dir_path){
+	size_t path_len = strlen(dir_path);
+	shared_dir *shared = malloc(sizeof(*shared) + path_len + 1);
+	if(shared == NULL){
+		perror("malloc");
+		return NULL;
+	}
+
+	shared->fd = fcntl(dir_fd, F_DUPFD_CLOEXEC, 0);
+	if(shared->fd < 0){
+		perror(dir_path);
+		free(shared);
+		return NULL;
+	}
+
+	dir_node_hold(dir);
+	shared->dir = dir;
+	atomic_init(&shared->refs, 1);
+	memcpy(shared->path, dir_path, path_len + 1);
+
+	return shared;
+}
+
+/**
+ * release_shared_dir() - Drops one reference to a shared directory. The last
+ * one closes it.
+ *
+ * @param shared The shared directory.
+ */
+static void release_shared_dir(shared_dir *shared){
+	if(atomic_fetch_sub(&shared->refs, 1) != 1){
+		return;
+	}
+
+	if(close(shared->fd) < 0){
+		perror(shared->path);
+	}
+	dir_node_release(shared->dir);
+	free(shared);
+}
+
+/**
+ * check_file_of_type() - Hands out the file if it matches the expression and
+ * adds it to the worker's deque if it is a directory which was not pruned.
+ * A file less deep than -mindepth is not checked against the expression, and
+ * a directory as deep as -maxdepth is not added. With -grep the contents of a
+ * file are only read once it matches the expression.
+ * With -D the file is added to the index instead of being handed out. When an
+ * index is searched with -fresh, a directory which is in the index is not
+ * added, since the index or the check of changed directories covers it. With
+ * -c the file is added to the record of the directory being read.
+ *
+ * @param self The worker checking the file.
+ * @param dir_fd An open file descriptor of the directory holding the file.
+ * @param dir The directory holding the file.
+ * @param dir_path The path to the directory holding the file.
+ * @param name The name of the file in the directory.
+ * @param type The type of the file, as given by type_from_mode().
+ * @param file_info The file examined with the fields of the expression, or
+ * NULL if it has not been examined.
+ */
+static void check_file_of_type(worker *self, int dir_fd, dir_node *dir,
+		const char *dir_path, const char *name, char type,
+		const struct statx *file_info){
+	mfind_search *s = self->search;
+	expr_file file = {.name = name, .type = type, .info = file_info};
+	unsigned int depth = dir->depth + 1;
+
+	if(self->cache_writer != NULL){
+		dir_cache_writer_add(self->cache_writer, name, type);
+	}
+
+	if(self->index != NULL){
+		index_builder_add(self->index, dir_path, name, type,
+				file_info->stx_mtime);
+	}
+	else if((depth >= s->min_depth) &&
+			matches_expression(self, dir_fd, dir_path, &file) &&
+			matches_content(self, dir_fd, dir_path, name, type)){
+		report_match(self, dir_fd, dir_path, name, type);
+	}
+
+	if((type == 'd') && !file.prune && (depth < s->max_depth) &&
+			!is_indexed_dir(s, dir_path, name)){
+		add_child_to_list(self, dir_node_new(self->paths, dir, name));
+	}
+}
+
+/**
+ * matches_expression() - Checks a file against the expression. The file is
+ * only examined with statx(), asking for just the fields the expression
+ * needs, when a test needing them is reached and it has not been already.
+ *
+ * @param self The worker checking the file.
+ * @param dir_fd An open file descriptor of the directory holding the file.
+ * @param dir_path The path to the directory holding the file.
+ * @param file The file, whose prune field is set if a -prune was run.
+ * @returns true if the file matches, else false.
+ */
+static bool matches_expression(worker *self, int dir_fd, const char *dir_path,
+		expr_file *file){
+	mfind_search *s = self->search;
+	struct statx own_info;
+	enum expr_result result = expr_run(s->search_expr, file);
+
+	if(result == EXPR_NEED_INFO){
+		if(stat_search_file(self, dir_fd, file->name,
+				expr_stat_mask(s->search_expr), &own_info) < 0){
+			fprintf(stderr, "%s/%s: %s\n", dir_path, file->name,
+					strerror(errno));
+			return false;
+		}
+		file->info = &own_info;
+		result = expr_run(s->search_expr, file);
+		file->info = NULL;
+	}
+
+	return result == EXPR_TRUE;
+}
+
+/**
+ * matches_content() - Checks if a file holds the text of -grep. Only regular
+ * files are read, and not those larger than -grepmax.
+ *
+ * @param self The worker checking the file.
+ * @param dir_fd An open file descriptor of the directory holding the file, or
+ * AT_FDCWD if name is the whole path.
+ * @param dir_path The path to the directory holding the file, or NULL if name
+ * is the whole path.
+ * @param name The name of the file.
+ * @param type The type of the file, as given by type_from_mode().
+ * @returns true if the file holds the text or -grep was not given, else
+ * false.
+ */
+static bool matches_content(worker *self, int dir_fd, const char *dir_path,
+		const char *name, char type){
+	mfind_search *s = self->search;
+
+	if(s->search_content == NULL){
+		return true;
+	}
+	if(type != 'f'){
+		return false;
+	}
+
+	self->stats.scanned_files++;
+	int ret = content_scanner_scan(self->scanner, dir_fd, name,
+			s->grep_max_size, s->visited != NULL);
+	if(ret < 0){
+		if(dir_path != NULL){
+			fprintf(stderr, "%s/%s: %s\n", dir_path, name, strerror(errno));
+		}
+		else{
+			perror(name);
+		}
+		return false;
+	}
+
+	return ret == 1;
+}
+
+/**
+ * report_match() - Hands a file which matched to the callback of the search.
+ * The callback is called by all the workers at once. With max_matches the
+ * matches are counted, and the one reaching the count stops the search.
+ * Those found by other workers after it are not handed out. A callback
+ * returning false also stops the search.
+ *
+ * @param self The worker which found the file.
+ * @param dir_fd An open file descriptor of the directory holding the file, or
+ * AT_FDCWD.
+ * @param dir_path The path to the directory holding the file, or NULL if name
+ * is the whole path.
+ * @param name The name of the file.
+ * @param type The type of the file, as given by type_from_mode().
+ */
+static void report_match(worker *self, int dir_fd, const char *dir_path,
+		const char *name, char type){
+	mfind_search *s = self->search;
+
+	if(s->max_matches > 0){
+		unsigned long match = atomic_fetch_add(&s->num_matches, 1) + 1;
+
+		if(match > s->max_matches){
+			return;
+		}
+		if(match == s->max_matches){
+			cancel_search(s);
+		}
+	}
+	self->stats.matches++;
+
+	mfind_match m = {
+		.dir_path = dir_path,
+		.name = name,
+		.dir_fd = dir_fd,
+		.type = type,
+		.thread = self->id
+	};
+
+	if(!s->on_match(&m, s->match_arg)){
+		cancel_search(s);
+	}
+}
+
+/**
+ * uring_engine_new() - Creates the io_uring state of a worker. The ring has
+ * room for depth directory opens and depth stat requests.
+ *
+ * @param depth The number of directories to keep in flight.
+ * @returns The new state or NULL if io_uring can not be used.
+ */
+static uring_engine *uring_engine_new(unsigned depth){
+	uring_engine *e = calloc(1, sizeof(*e));
+	if(e == NULL){
+		perror("calloc");
+		return NULL;
+	}
+
+	e->depth = depth;
+	e->ring = uring_new(2 * depth);
+	e->slots = calloc(depth, sizeof(*e->slots));
+	e->free_slots = calloc(depth, sizeof(*e->free_slots));
+	e->ready = calloc(depth, sizeof(*e->ready));
+	e->stat_bufs = calloc(depth, sizeof(*e->stat_bufs));
+	e->stat_results = calloc(depth, sizeof(*e->stat_results));
+	e->stat_names = calloc(depth, sizeof(*e->stat_names));
+
+	if((e->ring == NULL) || (e->slots == NULL) ||
+			(e->free_slots == NULL) || (e->ready == NULL) ||
+			(e->stat_bufs == NULL) || (e->stat_results == NULL) ||
+			(e->stat_names == NULL)){
+		uring_engine_kill(e);
+		return NULL;
+	}
+
+	for(unsigned i = 0; i < depth; i++){
+		e->free_slots[e->num_free++] = i;
+	}
+
+	return e;
+}
+
+/**
+ * uring_engine_kill() - Removes the io_uring state of a worker. Nothing may be
+ * in flight.
+ *
+ * @param e The state which to remove, may be NULL.
+ */
+static void uring_engine_kill(uring_engine *e){
+	if(e == NULL){
+		return;
+	}
+
+	if(e->ring != NULL){
+		uring_kill(e->ring);
+	}
+	if(e->slots != NULL){
+		for(unsigned i = 0; i < e->depth; i++){
+			free(e->slots[i].path);
+		}
+	}
+	free(e->slots);
+	free(e->free_slots);
+	free(e->ready);
+	free(e->stat_bufs);
+	free(e->stat_results);
+	free(e->stat_names);
+	free(e);
+}
+
+/**
+ * search_with_uring() - The search loop of a worker using io_uring. The
+ * worker keeps its ring filled with directories being opened, then reads one
+ * opened directory at a time while the other opens are in flight. When there
+ * is nothing in flight and nothing to take, the worker sleeps like in
+ * search_through_list().
+ *
+ * @param self The worker running the search.
+ */
+static void search_with_uring(worker *self){
+	mfind_search *s = self->search;
+	uring_engine *e = self->engine;
+	dir_node *dir;
+
+	for(;;){
+		if(search_is_cancelled(s)){
+			drop_uring_dirs(self);
+			break;
+		}
+
+		while((e->num_free > 0) && !worker_is_parked(self) &&
+				((dir = get_dir_from_list(self)) != NULL)){
+			unsigned i = e->free_slots[e->num_free - 1];
+			uring_slot *slot = &e->slots[i];
+
+			//A path too long to open at once is opened by steps right away
+			if((dir_node_path(dir, &slot->path, &slot->path_size) == NULL) ||
+					(strlen(slot->path) >= PATH_MAX) ||
+					!uring_prep_openat(e->ring, AT_FDCWD, slot->path,
+					O_RDONLY | O_DIRECTORY | O_CLOEXEC, (uint64_t)i << 1)){
+				check_directory(self, dir);
+				finish_dir(self, dir);
+				continue;
+			}
+			slot->dir = dir;
+			e->num_free--;
+			e->opens_in_flight++;
+		}
+
+		if((e->opens_in_flight == 0) && (e->num_ready == 0)){
+			if(worker_is_parked(self)){
+				park_worker(self);
+			}
+			if(!wait_for_work(self)){
+				break;
+			}
+			continue;
+		}
+
+		//Only block when there is nothing to read yet
+		if(uring_submit_and_wait(e->ring, (e->num_ready == 0) ? 1 : 0) < 0){
+			perror("io_uring_enter");
+			exit(EXIT_FAILURE);
+		}
+		reap_completions(self);
+
+		if(e->num_ready > 0){
+			unsigned i = e->ready[--e->num_ready];
+			uring_slot *slot = &e->slots[i];
+
+			if((slot->fd < 0) && open_needs_steps(s, -slot->fd)){
+				slot->fd = open_dir_by_steps(slot->dir);
+				if(slot->fd < 0){
+					slot->fd = -errno;
+				}
+			}
+			if(slot->fd < 0){
+				errno = -slot->fd;
+				report_dir_error(s, slot->path);
+			}
+			else{
+				read_directory(self, slot->fd, slot->dir, slot->path);
+			}
+
+			finish_dir(self, slot->dir);
+			e->free_slots[e->num_free++] = i;
+		}
+	}
+}
+
+/**
+ * drop_uring_dirs() - Waits for the opens a worker has in flight when the
+ * search is stopped early, so nothing is in flight when the ring is removed,
+ * and closes and releases the directories opened without reading them.
+ *
+ * @param self The worker using io_uring.
+ */
+static void drop_uring_dirs(worker *self){
+	uring_engine *e = self->engine;
+
+	while(e->opens_in_flight > 0){
+		if(uring_submit_and_wait(e->ring, 1) < 0){
+			perror("io_uring_enter");
+			exit(EXIT_FAILURE);
+		}
+		reap_completions(self);
+	}
+
+	while(e->num_ready > 0){
+		uring_slot *slot = &e->slots[e->ready[--e->num_ready]];
+
+		if(slot->fd >= 0){
+			close(slot->fd);
+		}
+		dir_node_release(slot->dir);
+	}
+}
+
+/**
+ * reap_completions() - Takes all the results from the worker's ring. Opened
+ * directories are put among the ready ones and stat results are stored for
+ * flush_stats(). The two are told apart by the lowest bit of the user data,
+ * the rest of which is the index of the slot or the stat.
+ *
+ * @param self The worker owning the ring.
+ */
+static void reap_completions(worker *self){
+	uring_engine *e = self->engine;
+	uring_completion c;
+
+	while(uring_next_completion(e->ring, &c)){
+		if(c.user_data & 1){ //A stat of an entry
+			e->stat_results[c.user_data >> 1] = c.res;
+			e->stats_in_flight--;
+		}
+		else{ //An opened directory
+			e->slots[c.user_data >> 1].fd = c.res;
+			e->ready[e->num_ready++] = (unsigned)(c.user_data >> 1);
+			e->opens_in_flight--;
+		}
+	}
+}
+
+/**
+ * defer_stat() - Sends a statx request for a file whose type the directory
+ * entry did not tell. The file is checked in flush_stats() when the batch is
+ * full or the whole directory has been read.
+ *
+ * @param self The worker checking the file.
+ * @param dir_fd An open file descriptor of the directory holding the file.
+ * @param dir The directory holding the file.
+ * @param dir_path The path to the directory holding the file.
+ * @param name The name of the file in the directory.
+ */
+static void defer_stat(worker *self, int dir_fd, dir_node *dir,
+		const char *dir_path, const char *name){
+	mfind_search *s = self->search;
+	uring_engine *e = self->engine;
+
+	if(e->num_stats == e->depth){
+		flush_stats(self, dir_fd, dir, dir_path);
+	}
+
+	unsigned i = e->num_stats;
+	size_t name_len = strlen(name);
+
+	if((name_len > NAME_MAX) || !uring_prep_statx(e->ring, dir_fd,
+			memcpy(e->stat_names[i], name, name_len + 1), s->stat_flags,
+			s->file_stat_mask, &e->stat_bufs[i],
+			((uint64_t)i << 1) | 1)){
+		//Can not defer, check it right away
+		struct statx file_info;
+
+		if(stat_search_file(self, dir_fd, name, s->file_stat_mask,
+				&file_info) < 0){
+			fprintf(stderr, "%s/%s: %s\n", dir_path, name, strerror(errno));
+			if(self->cache_writer != NULL){
+				dir_cache_writer_cancel(self->cache_writer);
+			}
+			return;
+		}
+		check_file_of_type(self, dir_fd, dir, dir_path, name,
+				type_from_mode(file_info.stx_mode), &file_info);
+		return;
+	}
+
+	self->stats.stat_calls++;
+	e->num_stats++;
+	e->stats_in_flight++;
+}
+
+/**
+ * flush_stats() - Waits for all the deferred statx requests of the directory
+ * and checks their files.
+ *
+ * @param self The worker checking the directory.
+ * @param dir_fd An open file descriptor of the directory.
+ * @param dir The directory holding the files.
+ * @param dir_path The path to the directory holding the files.
+ */
+static void flush_stats(worker *self, int dir_fd, dir_node *dir,
+		const char *dir_path){
+	mfind_search *s = self->search;
+	uring_engine *e = self->engine;
+
+	while(e->stats_in_flight > 0){
+		if(uring_submit_and_wait(e->ring, 1) < 0){
+			perror("io_uring_enter");
+			exit(EXIT_FAILURE);
+		}
+		reap_completions(self);
+	}
+
+	for(unsigned i = 0; i < e->num_stats; i++){
+		//A followed link pointing nowhere is taken as the link itself
+		if((e->stat_results[i] < 0) && (s->visited != NULL) &&
+				is_broken_link(e->stat_results[i])){
+			e->stat_results[i] = stat_file(self, dir_fd, e->stat_names[i],
+					AT_SYMLINK_NOFOLLOW, s->file_stat_mask,
+					&e->stat_bufs[i]) < 0 ? -errno : 0;
+		}
+		if(e->stat_results[i] < 0){
+			fprintf(stderr, "%s/%s: %s\n", dir_path, e->stat_names[i],
+					strerror(-e->stat_results[i]));
+			if(self->cache_writer != NULL){
+				dir_cache_writer_cancel(self->cache_writer);
+			}
+			continue;
+		}
+
+		self->entry_ino = (ino_t)e->stat_bufs[i].stx_ino;
+		check_file_of_type(self, dir_fd, dir, dir_path, e->stat_names[i],
+				type_from_mode(e->stat_bufs[i].stx_mode), &e->stat_bufs[i]);
+	}
+
+	e->num_stats = 0;
+}
+
+/**
+ * search_through_index() - Searches the index given with -d, each worker
+ * taking one block at a time. With -fresh the directories of the index are
+ * first checked for changes, which takes a pass of its own since the files of
+ * a block may be in directories of any block. Then the files in unchanged
+ * directories are taken from the index, while each changed directory is
+ * queued to be read again, and the workers go on with the normal search.
+ *
+ * @param self The worker.
+ */
+static void search_through_index(worker *self){
+	mfind_search *s = self->search;
+
+	if(s->index_fresh){
+		check_index_dirs(self);
+		pthread_barrier_wait(&s->index_barrier);
+	}
+
+	search_index_blocks(self);
+
+	if(s->index_fresh){
+		pthread_barrier_wait(&s->index_barrier);
+		queue_changed_dirs(self);
+		//No directory may be finished before all are queued
+		pthread_barrier_wait(&s->index_barrier);
+	}
+
+	//Nothing was queued, so finish_dir() will not end the search
+	if((self->id == 0) && (atomic_load(&s->num_changed_dirs) == 0)){
+		finish_search(s);
+	}
+}
+
+/**
+ * check_index_dirs() - Checks the directories of the blocks of the index the
+ * worker takes, for the -fresh check.
+ *
+ * @param self The worker.
+ */
+static void check_index_dirs(worker *self){
+	mfind_search *s = self->search;
+	size_t num_blocks = path_index_num_blocks(s->search_index);
+	size_t block;
+	index_cursor c;
+	index_entry entry;
+
+	memset(&c, 0, sizeof(c));
+	while((block = atomic_fetch_add(&s->next_block_to_check, 1)) < num_blocks){
+		index_cursor_start(&c, s->search_index, block);
+		while(index_cursor_next(&c, &entry)){
+			if(entry.dir != PATH_INDEX_NO_DIR){
+				check_index_dir(self, &entry);
+			}
+		}
+	}
+	index_cursor_free(&c);
+}
+
+/**
+ * check_index_dir() - Checks if a directory of the index has changed. Adding
+ * or removing a file changes the modification time of the directory holding
+ * it, so a directory with the same time still holds what the index says.
+ * A start directory given as a link is always read again, since the time of
+ * the link is not that of the directory.
+ *
+ * @param self The worker.
+ * @param entry The directory.
+ */
+static void check_index_dir(worker *self, const index_entry *entry){
+	mfind_search *s = self->search;
+	struct statx info;
+	unsigned char state = INDEX_DIR_CHANGED;
+
+	if((stat_file(self, AT_FDCWD, entry->path, 0, STATX_TYPE | STATX_MTIME,
+			&info) < 0) ||
+			!S_ISDIR(info.stx_mode)){
+		state = INDEX_DIR_GONE;
+	}
+	else if((entry->type == 'd') &&
+			(info.stx_mtime.tv_sec == entry->mtime.tv_sec) &&
+			(info.stx_mtime.tv_nsec == entry->mtime.tv_nsec)){
+		state = INDEX_DIR_FRESH;
+	}
+	s->index_dir_states[entry->dir] = state;
+
+	if(state != INDEX_DIR_CHANGED){
+		return;
+	}
+
+	if(self->num_changed == self->max_changed){
+		self->max_changed = (self->max_changed > 0) ?
+				self->max_changed * 2 : 64;
+		self->changed = realloc(self->changed,
+				self->max_changed * sizeof(*self->changed));
+		if(self->changed == NULL){
+			perror("realloc");
+			exit(EXIT_FAILURE);
+		}
+	}
+	self->changed[self->num_changed].dir = dir_node_new(self->paths, NULL,
+			entry->path);
+	self->changed[self->num_changed].id = entry->dir;
+	self->num_changed++;
+	atomic_fetch_add(&s->num_changed_dirs, 1);
+}
+
+/**
+ * search_index_blocks() - Checks the files of the blocks of the index the
+ * worker takes. When the expression may prune, whether a file is searched
+ * depends on the directories before it, so one worker searches all the
+ * blocks in order and skips the files below each pruned directory.
+ *
+ * @param self The worker.
+ */
+static void search_index_blocks(worker *self){
+	mfind_search *s = self->search;
+	size_t num_blocks = path_index_num_blocks(s->search_index);
+	bool may_prune = expr_may_prune(s->search_expr);
+	char *pruned = NULL; //The path of the last pruned directory
+	size_t pruned_len = 0;
+	size_t block;
+	index_cursor c;
+	index_entry entry;
+
+	if(may_prune && (self->id != 0)){
+		return;
+	}
+
+	memset(&c, 0, sizeof(c));
+	while(!search_is_cancelled(s) &&
+			((block = atomic_fetch_add(&s->next_block_to_search, 1)) <
+			num_blocks)){
+		index_cursor_start(&c, s->search_index, block);
+		while(index_cursor_next(&c, &entry)){
+			if((pruned != NULL) && (entry.path_len > pruned_len) &&
+					(entry.path[pruned_len] == '/') &&
+					(memcmp(entry.path, pruned, pruned_len) == 0)){
+				if(s->index_fresh && (entry.dir != PATH_INDEX_NO_DIR)){
+					s->index_dir_states[entry.dir] = INDEX_DIR_PRUNED;
+				}
+				continue;
+			}
+
+			if(check_index_entry(self, &entry)){
+				free(pruned);
+				pruned = strdup(entry.path);
+				if(pruned == NULL){
+					perror("strdup");
+					exit(EXIT_FAILURE);
+				}
+				pruned_len = entry.path_len;
+				if(s->index_fresh){
+					s->index_dir_states[entry.dir] = INDEX_DIR_PRUNED;
+				}
+			}
+		}
+	}
+	index_cursor_free(&c);
+	free(pruned);
+}
+
+/**
+ * check_index_entry() - Hands out a file of the index if it matches the
+ * expression. With -fresh it is only handed out if the directory holding it is
+ * unchanged, since a changed directory is read again. A directory is still
+ * checked if it exists, to know if it is pruned.
+ *
+ * @param self The worker.
+ * @param entry The file.
+ * @returns true if the file is a directory which was pruned, else false.
+ */
+static bool check_index_entry(worker *self, const index_entry *entry){
+	mfind_search *s = self->search;
+	bool current = true;
+
+	if(s->index_fresh){
+		size_t dir = (entry->parent != PATH_INDEX_NO_DIR) ? entry->parent :
+				entry->dir;
+		unsigned char state = s->index_dir_states[dir];
+
+		current = (state == INDEX_DIR_FRESH) ||
+				((entry->parent == PATH_INDEX_NO_DIR) &&
+				(state != INDEX_DIR_GONE));
+		if(!current && ((entry->dir == PATH_INDEX_NO_DIR) ||
+				!expr_may_prune(s->search_expr) ||
+				(s->index_dir_states[entry->dir] == INDEX_DIR_GONE))){
+			return false;
+		}
+	}
+
+	expr_file file = {.name = entry->name, .type = entry->type};
+
+	if(matches_index_entry(self, entry, &file) && current &&
+			matches_content(self, AT_FDCWD, NULL, entry->path, entry->type)){
+		report_match(self, AT_FDCWD, NULL, entry->path, entry->type);
+	}
+
+	return file.prune && (entry->dir != PATH_INDEX_NO_DIR);
+}
+
+/**
+ * matches_index_entry() - Checks a file of the index against the expression.
+ * The modification time is taken from the index, unless the expression needs
+ * more or -fresh was given, in which case the file itself is examined.
+ *
+ * @param self The worker.
+ * @param entry The file.
+ * @param file The file to check, whose prune field is set if a -prune was
+ * run.
+ * @returns true if the file matches, else false.
+ */
+static bool matches_index_entry(worker *self, const index_entry *entry,
+		expr_file *file){
+	mfind_search *s = self->search;
+	struct statx info;
+	enum expr_result result = expr_run(s->search_expr, file);
+
+	if(result != EXPR_NEED_INFO){
+		return result == EXPR_TRUE;
+	}
+
+	if(!s->index_fresh &&
+			((expr_stat_mask(s->search_expr) & ~STATX_MTIME) == 0)){
+		info.stx_mask = STATX_TYPE | STATX_MTIME;
+		info.stx_mtime = entry->mtime;
+	}
+	else{
+		if(stat_file(self, AT_FDCWD, entry->path, AT_SYMLINK_NOFOLLOW,
+				expr_stat_mask(s->search_expr), &info) < 0){
+			perror(entry->path);
+			return false;
+		}
+	}
+	file->info = &info;
+	result = expr_run(s->search_expr, file);
+	file->info = NULL;
+
+	return result == EXPR_TRUE;
+}
+
+/**
+ * queue_changed_dirs() - Queues the changed directories the worker found
+ * with -fresh, to be read again, unless they have been pruned.
+ *
+ * @param self The worker.
+ */
+static void queue_changed_dirs(worker *self){
+	mfind_search *s = self->search;
+
+	for(size_t i = 0; i < self->num_changed; i++){
+		changed_dir *c = &self->changed[i];
+
+		if(s->index_dir_states[c->id] == INDEX_DIR_CHANGED){
+			add_dir_to_list(self, c->dir);
+		}
+		else{
+			dir_node_release(c->dir);
+			atomic_fetch_sub(&s->num_changed_dirs, 1);
+		}
+	}
+	self->num_changed = 0;
+}
+
+/**
+ * is_indexed_dir() - Checks if a directory found while reading a changed
+ * directory is in the index searched with -fresh.
+ *
+ * @param s The search.
+ * @param dir_path The path of the directory holding the directory.
+ * @param name The name of the directory.
+ * @returns true if the directory is in the index, else false.
+ */
+static bool is_indexed_dir(mfind_search *s, const char *dir_path,
+		const char *name){
+	return (s->search_index != NULL) &&
+			path_index_has_dir(s->search_index, dir_path, name);
+}
+
+/**
+ * write_index() - Writes the files found by all the workers as the index
+ * given with -D.
+ *
+ * @param s The search.
+ */
+static void write_index(mfind_search *s){
+	index_builder *builders[s->num_workers];
+
+	for(int i = 0; i < s->num_workers; i++){
+		builders[i] = s->workers[i].index;
+	}
+
+	if(path_index_write(s->index_to_write, builders, s->num_workers) < 0){
+		perror(s->index_to_write);
+		count_error(s);
+	}
+}
+
+/**
+ * type_from_dirent() - Translates the type of a directory entry to the type
+ * letters used by the program.
+ *
+ * @param d_type The d_type field of a directory entry.
+ * @returns 'f' for file, 'd' for directory, 'l' for link, '?' for any other
+ * type or '\0' if the file system did not tell the type.
+ */
+static char type_from_dirent(unsigned char d_type){
+	switch(d_type){
+		case DT_DIR:
+			return 'd';
+		case DT_REG:
+			return 'f';
+		case DT_LNK:
+			return 'l';
+		case DT_UNKNOWN:
+			return '\0';
+		default:
+			return '?';
+	}
+}
+
+/**
+ * type_from_mode() - Translates the file mode from a stat call to the type
+ * letters used by the program.
+ *
+ * @param mode The st_mode field of a stat struct.
+ * @returns 'f' for file, 'd' for directory, 'l' for link or '?' for any other
+ * type.
+ */
+static char type_from_mode(mode_t mode){
+	if(S_ISDIR(mode)){
+		return 'd';
+	}
+	if(S_ISREG(mode)){
+		return 'f';
+	}
+	if(S_ISLNK(mode)){
+		return 'l';
+	}
+
+	return '?';
+}
+
+/**
+ * wait_for_work() - Puts the calling worker to sleep until a directory can be
+ * taken from one of the deques or the search is done.
+ *
+ * The worker is counted as idle before it checks the deques a last time, and
+ * add_dir_to_list() checks for idle workers after pushing. Both sides have a
+ * full fence in between, so either the worker sees the new directory or the
+ * pusher sees the idle worker and signals it under the lock.
+ *
+ * @param self The worker, whose time idle is counted.
+ * @returns true if there may be work to take, false if the search is done.
+ */
+static bool wait_for_work(worker *self){
+	mfind_search *s = self->search;
+	uint64_t start = stats_clock(&self->stats);
+	bool done;
+
+	pthread_mutex_lock(&s->idle_lock);
+	atomic_fetch_add(&s->idle_workers, 1);
+	atomic_thread_fence(memory_order_seq_cst);
+
+	while(!s->search_done && (atomic_load(&s->pending_dirs) > 0) &&
+			!work_is_available(s)){
+		pthread_cond_wait(&s->idle_cond, &s->idle_lock);
+	}
+
+	atomic_fetch_sub(&s->idle_workers, 1);
+	done = s->search_done || (atomic_load(&s->pending_dirs) == 0);
+	pthread_mutex_unlock(&s->idle_lock);
+
+	self->stats.idle_ns += stats_since(start);
+
+	return !done;
+}
+
+/**
+ * work_is_available() - Checks if any of the deques has a directory queued, or
+ * a batch of entries has been handed out.
+ *
+ * @param s The search.
+ * @returns true if a directory may be taken, else false.
+ */
+static bool work_is_available(mfind_search *s){
+	if((s->entry_batches != NULL) && !batch_queue_is_empty(s->entry_batches)){
+		return true;
+	}
+
+	for(int i = 0; i < s->num_workers; i++){
+		if(!deque_is_empty(s->workers[i].dirs_to_check)){
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * wake_idle_worker() - Wakes one sleeping worker, if there is any, after a
+ * directory has been queued. The lock is only taken when a worker sleeps.
+ *
+ * @param s The search.
+ */
+static void wake_idle_worker(mfind_search *s){
+	atomic_thread_fence(memory_order_seq_cst);
+
+	if(atomic_load(&s->idle_workers) > 0){
+		pthread_mutex_lock(&s->idle_lock);
+		pthread_cond_signal(&s->idle_cond);
+		pthread_mutex_unlock(&s->idle_lock);
+	}
+}
+
+/**
+ * finish_search() - Marks the search as done and wakes all sleeping workers so
+ * they can return.
+ *
+ * @param s The search.
+ */
+static void finish_search(mfind_search *s){
+	pthread_mutex_lock(&s->idle_lock);
+	s->search_done = true;
+	pthread_cond_broadcast(&s->idle_cond);
+	pthread_cond_broadcast(&s->pool_cond);
+	pthread_mutex_unlock(&s->idle_lock);
+}
+
+/**
+ * auto_pool_max_threads() - Sets up -p auto. As many workers as there are
+ * processors search at first, and up to the number returned may.
+ *
+ * @param s The search.
+ * @returns The number of workers to create.
+ */
+static int auto_pool_max_threads(mfind_search *s){
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int max_threads;
+
+	s->num_cpus = ((cpus < 1) || (cpus > POOL_MAX_THREADS)) ? 1 : (int)cpus;
+	max_threads = POOL_THREADS_PER_CPU * s->num_cpus;
+	if(max_threads < POOL_MIN_MAX_THREADS){
+		max_threads = POOL_MIN_MAX_THREADS;
+	}
+	if(max_threads > POOL_MAX_THREADS){
+		max_threads = POOL_MAX_THREADS;
+	}
+
+	s->pool_is_auto = true;
+	atomic_store(&s->active_workers, s->num_cpus);
+
+	return max_threads;
+}
+
+/**
+ * watch_search() - The watcher of the search, run by a thread of its own
+ * until the search is done. Every WATCH_INTERVAL_MS it takes a look at the
+ * search, which is added to the timeline with -stats and used to resize the
+ * pool with -p auto.
+ *
+ * @param arg Not used.
+ * @returns NULL.
+ */
+static void *watch_search(void *arg){
+	pool_sample last;
+	pool_sample now;
+	struct timespec wake_time;
+	mfind_search *s = arg;
+
+	take_pool_sample(s, &last);
+
+	pthread_mutex_lock(&s->idle_lock);
+	while(!s->search_done){
+		clock_gettime(CLOCK_REALTIME, &wake_time);
+		wake_time.tv_nsec += WATCH_INTERVAL_MS * 1000000L;
+		if(wake_time.tv_nsec >= 1000000000L){
+			wake_time.tv_sec++;
+			wake_time.tv_nsec -= 1000000000L;
+		}
+		pthread_cond_timedwait(&s->pool_cond, &s->idle_lock, &wake_time);
+		if(s->search_done){
+			break;
+		}
+		pthread_mutex_unlock(&s->idle_lock);
+
+		take_pool_sample(s, &now);
+		if(s->search_timeline != NULL){
+			stats_sample sample = {
+				.time = now.wall - s->search_start,
+				.pending = atomic_load(&s->pending_dirs),
+				.dirs = now.dirs
+			};
+			stats_timeline_add(s->search_timeline, &sample);
+		}
+		if(s->pool_is_auto){
+			adapt_pool(s, &last, &now);
+		}
+		last = now;
+
+		pthread_mutex_lock(&s->idle_lock);
+	}
+	pthread_mutex_unlock(&s->idle_lock);
+
+	return NULL;
+}
+
+/**
+ * adapt_pool() - Resizes the pool of -p auto. From the two last looks at the
+ * search it measures how many directories were checked per second, how busy
+ * the searching workers kept the processors and how many directories are
+ * queued, and resizes the pool with next_pool_size(). Workers are never
+ * created or ended while searching: those beyond the pool size park
+ * themselves once they are done with their directory, and are woken when the
+ * pool grows again. Only called by the watcher.
+ *
+ * @param s The search.
+ * @param last The look before.
+ * @param now The look just taken.
+ */
+static void adapt_pool(mfind_search *s, const pool_sample *last,
+		const pool_sample *now){
+	int active = atomic_load(&s->active_workers);
+	int running = (active < s->num_cpus) ? active : s->num_cpus;
+	double wall = now->wall - last->wall;
+	double rate = (double)(now->dirs - last->dirs) / wall;
+	double busy = (now->cpu - last->cpu) / (running * wall);
+	long queued = atomic_load(&s->pending_dirs) - active;
+
+	int size = next_pool_size(s, active, rate, busy, queued);
+
+	if(size != active){
+		pthread_mutex_lock(&s->idle_lock);
+		atomic_store(&s->active_workers, size);
+		pthread_cond_broadcast(&s->pool_cond);
+		pthread_mutex_unlock(&s->idle_lock);
+	}
+}
+
+/**
+ * next_pool_size() - Decides the size of the pool of -p auto by climbing
+ * towards the most directories checked per second. When the workers mostly
+ * wait in system calls, like on a cold network file system, and there is work
+ * queued for more of them, the pool grows by half. When they keep the
+ * processors busy, like on a warm page cache, one more thread only adds
+ * contention, so the pool shrinks by one. A change is kept only if the
+ * throughput after it shows it helped, else it is undone and the pool is
+ * left alone for a while. Only called by the watcher.
+ *
+ * @param s The search.
+ * @param active The number of workers searching.
+ * @param rate The directories checked per second since the last look.
+ * @param busy The processor time used per processor which the workers could
+ * use, from 0 to 1.
+ * @param queued The number of directories queued and not being checked.
+ * @returns The new number of workers searching.
+ */
+static int next_pool_size(mfind_search *s, int active, double rate,
+		double busy, long queued){
+	int change = 0;
+
+	if(s->last_change != 0){
+		//A grown pool must do clearly better, a shrunk one about as well
+		if(((s->last_change > 0) && (rate < s->last_rate * 1.1)) ||
+				((s->last_change < 0) && (rate < s->last_rate * 0.9))){
+			change = -s->last_change;
+			s->cooldown = POOL_COOLDOWN;
+		}
+		s->last_change = 0;
+	}
+	else if(s->cooldown > 0){
+		s->cooldown--;
+	}
+	else if((busy < 0.8) && (queued > active) && (active < s->num_workers)){
+		change = (active / 2 > 0) ? active / 2 : 1;
+		if(active + change > s->num_workers){
+			change = s->num_workers - active;
+		}
+		s->last_change = change;
+	}
+	else if((busy > 0.95) && (active > 1)){
+		change = -1;
+		s->last_change = change;
+	}
+
+	s->last_rate = rate;
+
+	return active + change;
+}
+
+/**
+ * take_pool_sample() - Measures the search for the watcher. The processor
+ * time is that of the whole process, other searches running at once
+ * included.
+ *
+ * @param s The search.
+ * @param sample Where to put the measurements.
+ */
+static void take_pool_sample(mfind_search *s, pool_sample *sample){
+	struct rusage usage;
+
+	sample->wall = monotonic_seconds();
+
+	sample->cpu = 0.0;
+	if(getrusage(RUSAGE_SELF, &usage) == 0){
+		sample->cpu = (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+				(double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) /
+				1e6;
+	}
+
+	sample->dirs = 0;
+	for(int i = 0; i < s->num_workers; i++){
+		sample->dirs += atomic_load_explicit(&s->workers[i].progress,
+				memory_order_relaxed);
+	}
+}
+
+/**
+ * worker_is_parked() - Checks if a worker is beyond the size of the pool.
+ *
+ * @param self The worker.
+ * @returns true if the worker should stop taking directories, else false.
+ */
+static bool worker_is_parked(const worker *self){
+	mfind_search *s = self->search;
+
+	return self->id >= atomic_load_explicit(&s->active_workers,
+			memory_order_relaxed);
+}
+
+/**
+ * park_worker() - Puts a worker beyond the size of the pool to sleep until the
+ * pool grows to hold it or the search is done. A sleeping worker is woken
+ * first, since the directories left in the parked worker's deque must be
+ * stolen by the others.
+ *
+ * @param self The worker.
+ */
+static void park_worker(worker *self){
+	mfind_search *s = self->search;
+
+	wake_idle_worker(s);
+
+	pthread_mutex_lock(&s->idle_lock);
+	while(!s->search_done && worker_is_parked(self)){
+		pthread_cond_wait(&s->pool_cond, &s->idle_lock);
+	}
+	pthread_mutex_unlock(&s->idle_lock);
+}
+
+/**
+ * cancel_search() - Stops the search early. The workers stop reading the
+ * directories they are in at the next entry, and those left in the deques are
+ * never taken. They are freed along with the arenas, without being walked.
+ *
+ * @param s The search.
+ */
+static void cancel_search(mfind_search *s){
+	atomic_store(&s->search_cancelled, true);
+	finish_search(s);
+}
+
+/**
+ * search_is_cancelled() - Checks if the search has been stopped early. Cheap
+ * enough to be called for every entry read.
+ *
+ * @param s The search.
+ * @returns true if cancel_search() has been called, else false.
+ */
+static bool search_is_cancelled(const mfind_search *s){
+	return atomic_load_explicit(&s->search_cancelled, memory_order_relaxed);
+}
+
+/**
+ * initialize_workers() - Creates the workers and the deque each of them uses
+ * for storing jobs.
+ *
+ * @param s The search.
+ * @param num_of_threads The number of threads searching.
+ */
+static void initialize_workers(mfind_search *s, int num_of_threads){
+	s->workers = calloc(num_of_threads, sizeof(*s->workers));
+	if(s->workers == NULL){
+		perror("calloc");
+		exit(EXIT_FAILURE);
+	}
+
+	for(int i = 0; i < num_of_threads; i++){
+		s->workers[i].search = s;
+		s->workers[i].dirs_to_check = deque_new();
+		s->workers[i].paths = path_arena_new();
+		s->workers[i].reader = dir_reader_new(s->dir_buffer_size);
+		if(s->uring_depth > 0){
+			//Falls back to the normal system calls if this fails
+			s->workers[i].engine = uring_engine_new(s->uring_depth);
+		}
+		if(s->index_to_write != NULL){
+			s->workers[i].index = index_builder_new();
+		}
+		if(s->search_cache != NULL){
+			s->workers[i].cache_writer = dir_cache_writer_new(s->search_cache);
+		}
+		if(s->search_content != NULL){
+			s->workers[i].scanner = content_scanner_new(s->search_content);
+		}
+		if(s->stats_wanted){
+			s->workers[i].stats.timed = true;
+			dir_reader_set_stats(s->workers[i].reader, &s->workers[i].stats);
+		}
+		s->workers[i].id = i;
+		s->num_workers++;
+	}
+
+	if(!s->pool_is_auto){
+		atomic_store(&s->active_workers, num_of_threads);
+	}
+
+	if(s->stats_wanted){
+		s->search_timeline = stats_timeline_new();
+	}
+
+	if(s->search_index != NULL){
+		pthread_barrier_init(&s->index_barrier, NULL, num_of_threads);
+	}
+
+	if((num_of_threads > 1) && (s->uring_depth == 0) &&
+			(s->search_cache == NULL) && (s->index_to_write == NULL)){
+		s->entry_batches = batch_queue_new();
+	}
+}
+
+/**
+ * check_input_arguments() - Checks all the start directories given by the
+ * user. Must be called before the search is started.
+ *
+ * @param self The worker which gets the start directories.
+ */
+static void check_input_arguments(worker *self){
+	mfind_search *s = self->search;
+
+	for(int i = 0; (i < s->num_start_dirs) && !search_is_cancelled(s); i++){
+		check_input_argument(self, s->start_dirs[i]);
+	}
+}
+
+/**
+ * check_input_argument() - Checks if the program is searching for the given
+ * start directory itself and adds it to the deque. The path should be to a
+ * directory, however symbolic links will also be added to the deque.
+ *
+ * @param self The worker which gets the start directory.
+ * @param arg Path to a directory or symbolic link.
+ */
+static void check_input_argument(worker *self, char *arg){
+	mfind_search *s = self->search;
+	struct statx file_info;
+
+	if (stat_search_file(self, AT_FDCWD, arg, s->file_stat_mask,
+			&file_info) < 0) {
+		perror(arg);
+		return;
+	}
+
+	//basename() may modify its argument
+	char *arg_copy = strdup(arg);
+	if(arg_copy == NULL){
+		perror("strdup");
+		return;
+	}
+
+	//The file has been examined with all the fields the expression needs
+	expr_file file = {
+		.name = basename(arg_copy),
+		.type = type_from_mode(file_info.stx_mode),
+		.info = &file_info
+	};
+
+	if(self->index != NULL){
+		index_builder_add(self->index, NULL, arg, file.type,
+				file_info.stx_mtime);
+	}
+	else if((s->min_depth == 0) &&
+			(expr_run(s->search_expr, &file) == EXPR_TRUE) &&
+			matches_content(self, AT_FDCWD, NULL, arg, file.type)){
+		report_match(self, AT_FDCWD, NULL, arg, file.type);
+	}
+
+	if(((file.type == 'd') || (file.type == 'l')) && !file.prune &&
+			(s->max_depth > 0)){
+		add_dir_to_list(self, dir_node_new(self->paths, NULL, arg));
+	}
+
+	free(arg_copy);
+}
+
+/**
+ * stat_file() - Examines a file with statx(), counting the call and timing it
+ * with -stats.
+ *
+ * @param self The worker examining the file.
+ * @param dir_fd An open file descriptor of the directory holding the file, or
+ * AT_FDCWD.
+ * @param name The name of the file, or its path with AT_FDCWD.
+ * @param flags The flags of statx().
+ * @param mask The fields wanted.
+ * @param info Where to put what was found.
+ * @returns 0 on success, -1 on failure with errno set.
+ */
+static int stat_file(worker *self, int dir_fd, const char *name, int flags,
+		unsigned int mask, struct statx *info){
+	uint64_t start = stats_clock(&self->stats);
+	int ret = statx(dir_fd, name, flags, mask, info);
+
+	latency_add(&self->stats.stat_latency, start);
+	self->stats.stat_calls++;
+
+	return ret;
+}
+
+/**
+ * stat_search_file() - Examines a file found by the search. When links are
+ * followed the file a link points to is examined, or the link itself if it
+ * points to no file.
+ *
+ * @param self The worker examining the file.
+ * @param dir_fd An open file descriptor of the directory holding the file, or
+ * AT_FDCWD.
+ * @param name The name of the file, or its path with AT_FDCWD.
+ * @param mask The fields wanted.
+ * @param info Where to put what was found.
+ * @returns 0 on success, -1 on failure with errno set.
+ */
+static int stat_search_file(worker *self, int dir_fd, const char *name,
+		unsigned int mask, struct statx *info){
+	mfind_search *s = self->search;
+	int ret = stat_file(self, dir_fd, name, s->stat_flags, mask, info);
+
+	if((ret < 0) && (s->visited != NULL) && is_broken_link(-errno)){
+		ret = stat_file(self, dir_fd, name, AT_SYMLINK_NOFOLLOW, mask, info);
+	}
+
+	return ret;
+}
+
+/**
+ * is_broken_link() - Tells if an error from examining a file through a link
+ * may be because the link points to no file, or to itself.
+ *
+ * @param err The error, as a negative errno.
+ * @returns true if it may be, else false.
+ */
+static bool is_broken_link(int err){
+	return (err == -ENOENT) || (err == -ELOOP);
+}
+
+/**
+ * first_visit() - Adds a directory to those read by the search, when links
+ * are followed. The same directory may be reached by many paths, through
+ * links and bind mounts, and through loops any number of times, but only the
+ * first to reach it reads it.
+ *
+ * @param self The worker about to read the directory.
+ * @param dir_fd An open file descriptor of the directory.
+ * @param dir_path The path to the directory.
+ * @returns true if the directory has not been read before, else false.
+ */
+static bool first_visit(worker *self, int dir_fd, const char *dir_path){
+	mfind_search *s = self->search;
+	struct statx dir_info;
+
+	if(stat_file(self, dir_fd, "", AT_EMPTY_PATH, STATX_INO,
+			&dir_info) < 0){
+		//Rather read it twice than not at all
+		perror(dir_path);
+		return true;
+	}
+
+	return visited_set_add(s->visited,
+			makedev(dir_info.stx_dev_major, dir_info.stx_dev_minor),
+			(ino_t)dir_info.stx_ino);
+}
+
+/**
+ * monotonic_seconds() - Reads the monotonic clock.
+ *
+ * @returns The time in seconds.
+ */
+static double monotonic_seconds(void){
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * count_error() - Increases the error count of the search with one. Is thread
+ * safe since the count is atomic.
+ *
+ * @param s The search.
+ */
+static void count_error(mfind_search *s){
+	atomic_fetch_add(&s->err_count, 1);
+}
+
+/**
+ * remove_leftover_dirs_from_list() - Frees the directories still in the deques
+ * and the deques themselves, and the batches of entries still queued.
+ *
+ * @param s The search.
+ */
+static void remove_leftover_dirs_from_list(mfind_search *s){
+	entry_batch *batch;
+
+	//A stopped search may have left batches, holding directories open
+	while((s->entry_batches != NULL) &&
+			((batch = batch_queue_pop(s->entry_batches)) != NULL)){
+		release_shared_dir(entry_batch_owner(batch));
+		entry_batch_kill(batch);
+	}
+	batch_queue_kill(s->entry_batches);
+	s->entry_batches = NULL;
+
+	//A stopped search may have left any number, whose arenas' chunks are only
+	//freed once all their nodes are
+	for(int i = 0; i < s->num_workers; i++){
+		dir_node *dir;
+
+		//Stealing is safe from any thread
+		while((dir = deque_steal(s->workers[i].dirs_to_check)) != NULL){
+			dir_node_release(dir);
+		}
+	}
+
+	//A node may come from any worker's arena, so all must be freed first
+	for(int i = 0; i < s->num_workers; i++){
+		path_arena_kill(s->workers[i].paths);
+		free(s->workers[i].path_buf);
+		deque_kill(s->workers[i].dirs_to_check);
+		dir_reader_kill(s->workers[i].reader);
+		uring_engine_kill(s->workers[i].engine);
+		index_builder_kill(s->workers[i].index);
+		content_scanner_kill(s->workers[i].scanner);
+		free(s->workers[i].changed);
+	}
+
+	free(s->workers);
+	s->workers = NULL;
+	s->num_workers = 0;
+}
+
+/**
+ * add_dir_to_list() - Adds the given directory to the worker's own deque. No
+ * lock is needed since only the owner pushes to a deque. A sleeping worker is
+ * woken to steal it.
+ *
+ * @param self The worker which found the directory.
+ * @param dir A directory node allocated from the worker's arena, which is
+ * released by the worker checking it.
+ */
+static void add_dir_to_list(worker *self, dir_node *dir){
+	mfind_search *s = self->search;
+	long pending = atomic_fetch_add(&s->pending_dirs, 1) + 1;
+
+	if(pending > self->stats.peak_pending){
+		self->stats.peak_pending = pending;
+	}
+	deque_push(self->dirs_to_check, dir);
+	wake_idle_worker(s);
+}
+
+/**
+ * add_child_to_list() - Adds a subdirectory of the directory being read to the
+ * worker's deque. With -order inode it is held back until the directory has
+ * been read, along with the inode number of the entry being checked.
+ *
+ * @param self The worker reading the directory.
+ * @param dir A directory node allocated from the worker's arena.
+ */
+static void add_child_to_list(worker *self, dir_node *dir){
+	mfind_search *s = self->search;
+
+	if(s->search_order != MFIND_ORDER_INODE){
+		add_dir_to_list(self, dir);
+		return;
+	}
+
+	if(self->num_children == self->max_children){
+		size_t max = (self->max_children == 0) ? 64 : 2 * self->max_children;
+		queued_child *children = realloc(self->children,
+				max * sizeof(*children));
+		if(children == NULL){
+			perror("realloc");
+			exit(EXIT_FAILURE);
+		}
+		self->children = children;
+		self->max_children = max;
+	}
+
+	self->children[self->num_children].dir = dir;
+	self->children[self->num_children].ino = self->entry_ino;
+	self->num_children++;
+}
+
+/**
+ * queue_children() - Adds the subdirectories held back by add_child_to_list()
+ * to the worker's deque, with the lowest inode number last so it is popped
+ * first. File systems mostly place inodes in the order of their numbers, so
+ * the subdirectories are then read in the order they are on the disk.
+ *
+ * @param self The worker which has read the directory.
+ */
+static void queue_children(worker *self){
+	qsort(self->children, self->num_children, sizeof(*self->children),
+			compare_children);
+
+	for(size_t i = 0; i < self->num_children; i++){
+		add_dir_to_list(self, self->children[i].dir);
+	}
+	self->num_children = 0;
+}
+
+/**
+ * compare_children() - Orders held back subdirectories by falling inode
+ * numbers, for qsort().
+ *
+ * @param a The first queued_child.
+ * @param b The second queued_child.
+ * @returns A negative number if a comes first, positive if b does, else 0.
+ */
+static int compare_children(const void *a, const void *b){
+	ino_t a_ino = ((const queued_child *)a)->ino;
+	ino_t b_ino = ((const queued_child *)b)->ino;
+
+	return (a_ino < b_ino) - (a_ino > b_ino);
+}
+
+/**
+ * get_dir_from_list() - Gets the directory found last from the worker's own
+ * deque, or the one found first with -order bfs, which the owner takes from
+ * the top of its deque like a thief. If that deque is empty the oldest
+ * directory of another worker's deque is stolen, starting with the next
+ * worker so the thieves spread out.
+ *
+ * @param self The worker asking for a directory.
+ * @returns A directory or NULL if all the deques are empty.
+ */
+static dir_node *get_dir_from_list(worker *self){
+	mfind_search *s = self->search;
+	dir_node *dir = (s->search_order == MFIND_ORDER_BFS) ?
+			deque_steal(self->dirs_to_check) :
+			deque_pop(self->dirs_to_check);
+
+	for(int i = 1; (dir == NULL) && (i < s->num_workers); i++){
+		worker *victim = &s->workers[(self->id + i) % s->num_workers];
+		dir = deque_steal(victim->dirs_to_check);
+		if(dir != NULL){
+			self->stats.steals++;
+		}
+	}
+
+	return dir;
+}
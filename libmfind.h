@@ -0,0 +1,183 @@
+#ifndef __LIBMFIND_H_
+#define __LIBMFIND_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "dir_cache.h"
+#include "expr.h"
+#include "path_index.h"
+
+/*
+ * The search engine of mfind as a library. A search is a context holding all
+ * the state of one search, so any number of searches may run at once in one
+ * process. Every file matching is handed to a callback, or taken one at a
+ * time from an iterator, with its name, the directory holding it and its
+ * type, unformatted. The threads of a search either are its own, or are
+ * borrowed from a pool which searches running at the same time share: a
+ * search takes the threads of the pool which are free when it starts, and
+ * searches with the ones it got until it is done.
+ *
+ * Errors on the files searched are written to stderr and counted, and a
+ * failure to allocate memory ends the process, like in the rest of mfind.
+ * struct statx needs _GNU_SOURCE.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The largest io_uring depth which may be asked for.
+#define MFIND_MAX_URING_DEPTH 1024
+
+// The pool type.
+typedef struct mfind_pool mfind_pool;
+
+// The search type.
+typedef struct mfind_search mfind_search;
+
+// The iterator type.
+typedef struct mfind_iter mfind_iter;
+
+// The orders the directories can be searched in.
+enum mfind_order{
+	MFIND_ORDER_DFS, //The directory found last first, keeping few queued
+	MFIND_ORDER_BFS, //The directory found first first, level by level
+	MFIND_ORDER_INODE //As DFS, but the subdirectories by their inode numbers
+};
+
+// What to search for and how. Set up with mfind_options_init().
+typedef struct mfind_options{
+	expr *expr; //Compiled, taken over by the search
+	const char *const *start_dirs; //Copied, none with an index
+	int num_start_dirs;
+	int threads; //The threads searching, 1 or more
+	bool auto_threads; //Adapt the threads searching, threads is ignored
+	enum mfind_order order;
+	unsigned int min_depth;
+	unsigned int max_depth;
+	unsigned long max_matches; //0 for no limit
+	const char *grep; //The text the files must hold, or NULL
+	off_t grep_max_size; //0 for no limit
+	size_t dir_buffer_size; //0 to read directories with readdir()
+	unsigned uring_depth; //0 to not use io_uring
+	path_index *index; //Searched instead of the trees, taken over, or NULL
+	bool index_fresh; //Read the changed directories of the index again
+	const char *index_to_write; //The file of an index of the trees, or NULL
+	dir_cache *cache; //Taken over, or NULL
+	bool follow_links; //Search the files links point to, each directory once
+	bool stats; //Time the system calls and sample the queue
+}mfind_options;
+
+// A file which matched.
+typedef struct mfind_match{
+	const char *dir_path; //The directory holding the file, or NULL
+	const char *name; //The name in the directory, or the path if no dir_path
+	int dir_fd; //An open descriptor of the directory, or AT_FDCWD
+	char type; //'f' for file, 'd' for directory, 'l' for link, '?' else
+	int thread; //The thread of the search which found it
+}mfind_match;
+
+/*
+ * The callback getting the files which match. It is called by all the
+ * threads of the search at once, but by each thread for one file at a time.
+ * The match is only valid during the call. Returns false to stop the search.
+ */
+typedef bool (*mfind_match_fn)(const mfind_match *m, void *arg);
+
+/**
+ * mfind_options_init() - Sets the options to their defaults: one thread, in
+ * depth first order, without any limits. The expression and the start
+ * directories must still be given.
+ * @o: The options.
+ */
+void mfind_options_init(mfind_options *o);
+
+/**
+ * mfind_pool_new() - Create a new pool and start its threads, which wait
+ * until a search borrows them.
+ * @num_threads: The number of threads, 1 or more.
+ * Returns: A pointer to the new pool.
+ */
+mfind_pool *mfind_pool_new(int num_threads);
+
+/**
+ * mfind_pool_kill() - Ends the threads of the pool and removes it. No search
+ * may be running with it.
+ * @p: The pool which to remove, or NULL.
+ */
+void mfind_pool_kill(mfind_pool *p);
+
+/**
+ * mfind_search_new() - Create a new search. The threads searching are the
+ * thread running it and threads - 1 more, which are borrowed from the pool if
+ * one is given, else started for the search.
+ * @o: The options, taken over or copied, so they may be removed afterwards.
+ * @pool: The pool to borrow threads from, or NULL.
+ * @error: Set to a message if the options are invalid.
+ * Returns: A pointer to the new search, or NULL if the options are invalid.
+ * The expression, index and cache are then not taken over.
+ */
+mfind_search *mfind_search_new(const mfind_options *o, mfind_pool *pool,
+		const char **error);
+
+/**
+ * mfind_search_threads() - Gives the most threads the search may use.
+ * @s: The search.
+ * Returns: The number of threads, which the thread of a match is below.
+ */
+int mfind_search_threads(const mfind_search *s);
+
+/**
+ * mfind_search_run() - Runs the search, in the calling thread and those of
+ * the search, and returns when it is done. With an index to write it is
+ * written at the end. A search can only be run once.
+ * @s: The search.
+ * @fn: The callback getting the files which match.
+ * @arg: Given to the callback.
+ * Returns: The number of errors.
+ */
+unsigned int mfind_search_run(mfind_search *s, mfind_match_fn fn, void *arg);
+
+/**
+ * mfind_search_print_stats() - Writes the statistics of a search which has
+ * been run.
+ * @s: The search.
+ * @out: Where to write them.
+ * @json: true for one JSON object, false for a table for people to read.
+ */
+void mfind_search_print_stats(const mfind_search *s, FILE *out, bool json);
+
+/**
+ * mfind_search_kill() - Removes the search, which may not be running.
+ * @s: The search which to remove, or NULL.
+ */
+void mfind_search_kill(mfind_search *s);
+
+/**
+ * mfind_iter_new() - Starts running a search in a thread of its own, for its
+ * files to be taken one at a time. The search should not be touched until
+ * the iterator is removed.
+ * @s: The search, which has not been run.
+ * Returns: A pointer to the new iterator.
+ */
+mfind_iter *mfind_iter_new(mfind_search *s);
+
+/**
+ * mfind_iter_next() - Takes the next file which matched, waiting for it if
+ * the search is still running. The match has the whole path in name, with
+ * dir_fd AT_FDCWD, and is valid until the next call.
+ * @it: The iterator.
+ * @m: Filled in with the file.
+ * Returns: true if a file was given, false when the search is done.
+ */
+bool mfind_iter_next(mfind_iter *it, mfind_match *m);
+
+/**
+ * mfind_iter_kill() - Stops the search if it is still running, waits for it
+ * and removes the iterator. The search can then be removed.
+ * @it: The iterator.
+ * Returns: The number of errors of the search.
+ */
+unsigned int mfind_iter_kill(mfind_iter *it);
+
+#endif //__LIBMFIND_H_
@@ -0,0 +1,385 @@
+/*
+ * make_tree.c
+ *
+ * Generates a synthetic directory tree of a given shape for benchmarking
+ * mfind, so the same tree can be made again on any machine:
+ *
+ *   wide      Many directories right below the root, each with some files.
+ *   deep      A few chains of directories nested deep, with files at each
+ *             level.
+ *   small     Trees branching out in many small directories.
+ *   giant     One directory holding a huge number of files.
+ *   symlinks  Directories of files where every other entry is a symbolic
+ *             link, to a file, a directory, nothing or a directory above.
+ *
+ * The names and contents only depend on the shape and the scale, which
+ * multiplies the number of entries. Every 64th file holds the text
+ * "mfind bench needle", for -grep. A tree which was completely made before
+ * is left as it is.
+ *
+ * Usage: make_tree [-s scale] shape directory
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// The file marking a tree as complete, written last.
+#define COMPLETE_MARK ".make_tree_complete"
+
+// The text written to some of the files.
+#define NEEDLE "mfind bench needle\n"
+
+// Every how many files the text is written to.
+#define NEEDLE_EVERY 64
+
+// The extensions given to the files, in turn.
+static const char *const extensions[] = {".c", ".h", ".txt", ".o", ".md"};
+
+// A shape, made below the root at a scale.
+typedef struct shape{
+	const char *name;
+	void (*make)(const char *root, unsigned long scale);
+}shape;
+
+// The number of files made so far, for the names and the needles.
+static unsigned long files_made = 0;
+
+int main(int argc, char *argv[]);
+void make_dir(const char *path);
+void make_files(const char *dir, unsigned long count);
+void make_link(const char *target, const char *path);
+void make_wide(const char *root, unsigned long scale);
+void make_deep(const char *root, unsigned long scale);
+void make_small(const char *root, unsigned long scale);
+void make_small_dir(const char *dir, int depth);
+void make_giant(const char *root, unsigned long scale);
+void make_symlinks(const char *root, unsigned long scale);
+void join_path(char *path, const char *dir, const char *name);
+unsigned long parse_scale(const char *arg);
+
+// The shapes which can be made.
+static const shape shapes[] = {
+	{"wide", make_wide},
+	{"deep", make_deep},
+	{"small", make_small},
+	{"giant", make_giant},
+	{"symlinks", make_symlinks}
+};
+
+int main(int argc, char *argv[]){
+	unsigned long scale = 1;
+	char mark[PATH_MAX];
+	int opt;
+
+	while((opt = getopt(argc, argv, "s:")) != -1){
+		switch(opt){
+			case 's':
+				scale = parse_scale(optarg);
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-s scale] shape directory\n",
+						argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if(argc - optind != 2){
+		fprintf(stderr, "Usage: %s [-s scale] shape directory\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const char *name = argv[optind];
+	const char *root = argv[optind + 1];
+	const shape *chosen = NULL;
+
+	for(size_t i = 0; i < sizeof(shapes) / sizeof(*shapes); i++){
+		if(strcmp(name, shapes[i].name) == 0){
+			chosen = &shapes[i];
+		}
+	}
+	if(chosen == NULL){
+		fprintf(stderr, "Invalid shape, got: %s\n", name);
+		return EXIT_FAILURE;
+	}
+
+	join_path(mark, root, COMPLETE_MARK);
+	if(access(mark, F_OK) == 0){
+		return EXIT_SUCCESS;
+	}
+
+	make_dir(root);
+	chosen->make(root, scale);
+
+	int fd = open(mark, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0){
+		perror(mark);
+		return EXIT_FAILURE;
+	}
+	close(fd);
+
+	return EXIT_SUCCESS;
+}
+
+/**
+ * make_dir() - Creates a directory, if it does not exist. Exits on failure.
+ *
+ * @param path The path of the directory.
+ */
+void make_dir(const char *path){
+	if((mkdir(path, 0755) < 0) && (errno != EEXIST)){
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+}
+
+/**
+ * make_files() - Creates files in a directory, named after how many files
+ * were made before them. Exits on failure.
+ *
+ * @param dir The path of the directory.
+ * @param count The number of files.
+ */
+void make_files(const char *dir, unsigned long count){
+	char name[32];
+	char path[PATH_MAX];
+
+	for(unsigned long i = 0; i < count; i++){
+		snprintf(name, sizeof(name), "f%07lu%s", files_made,
+				extensions[files_made % (sizeof(extensions) /
+				sizeof(*extensions))]);
+		join_path(path, dir, name);
+
+		int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(fd < 0){
+			perror(path);
+			exit(EXIT_FAILURE);
+		}
+		if(files_made % NEEDLE_EVERY == 0){
+			if(write(fd, NEEDLE, strlen(NEEDLE)) < 0){
+				perror(path);
+				exit(EXIT_FAILURE);
+			}
+		}
+		close(fd);
+
+		files_made++;
+	}
+}
+
+/**
+ * make_link() - Creates a symbolic link, replacing any file in its place.
+ * Exits on failure.
+ *
+ * @param target What the link points to.
+ * @param path The path of the link.
+ */
+void make_link(const char *target, const char *path){
+	unlink(path);
+	if(symlink(target, path) < 0){
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+}
+
+/**
+ * make_wide() - Makes 2000 * scale directories below the root, each with 50
+ * files.
+ *
+ * @param root The path of the root.
+ * @param scale The scale.
+ */
+void make_wide(const char *root, unsigned long scale){
+	char name[32];
+	char path[PATH_MAX];
+
+	for(unsigned long i = 0; i < 2000 * scale; i++){
+		snprintf(name, sizeof(name), "d%06lu", i);
+		join_path(path, root, name);
+		make_dir(path);
+		make_files(path, 50);
+	}
+}
+
+/**
+ * make_deep() - Makes 4 * scale chains of directories 400 levels deep, with
+ * 20 files at each level.
+ *
+ * @param root The path of the root.
+ * @param scale The scale.
+ */
+void make_deep(const char *root, unsigned long scale){
+	char name[32];
+	char path[PATH_MAX];
+
+	for(unsigned long i = 0; i < 4 * scale; i++){
+		snprintf(name, sizeof(name), "chain%lu", i);
+		join_path(path, root, name);
+		make_dir(path);
+
+		for(int level = 0; level < 400; level++){
+			make_files(path, 20);
+			join_path(path, path, "d");
+			make_dir(path);
+		}
+	}
+}
+
+/**
+ * make_small() - Makes scale trees below the root, each 5 levels of small
+ * directories deep.
+ *
+ * @param root The path of the root.
+ * @param scale The scale.
+ */
+void make_small(const char *root, unsigned long scale){
+	char name[32];
+	char path[PATH_MAX];
+
+	for(unsigned long i = 0; i < scale; i++){
+		snprintf(name, sizeof(name), "t%lu", i);
+		join_path(path, root, name);
+		make_dir(path);
+		make_small_dir(path, 5);
+	}
+}
+
+/**
+ * make_small_dir() - Fills a directory with 3 files and 8 directories, which
+ * are filled the same way down to a depth.
+ *
+ * @param dir The path of the directory.
+ * @param depth The levels of directories left to make below the directory.
+ */
+void make_small_dir(const char *dir, int depth){
+	char name[32];
+	char path[PATH_MAX];
+
+	make_files(dir, 3);
+	if(depth == 0){
+		return;
+	}
+
+	for(int i = 0; i < 8; i++){
+		snprintf(name, sizeof(name), "s%d", i);
+		join_path(path, dir, name);
+		make_dir(path);
+		make_small_dir(path, depth - 1);
+	}
+}
+
+/**
+ * make_giant() - Makes one directory below the root with 200000 * scale
+ * files.
+ *
+ * @param root The path of the root.
+ * @param scale The scale.
+ */
+void make_giant(const char *root, unsigned long scale){
+	char path[PATH_MAX];
+
+	join_path(path, root, "giant");
+	make_dir(path);
+	make_files(path, 200000 * scale);
+}
+
+/**
+ * make_symlinks() - Makes 1000 * scale directories below the root, each
+ * with 20 files and 20 symbolic links: to a file in the directory, to the
+ * next directory, to nothing and to the root, which makes a loop.
+ *
+ * @param root The path of the root.
+ * @param scale The scale.
+ */
+void make_symlinks(const char *root, unsigned long scale){
+	unsigned long num_dirs = 1000 * scale;
+	char name[32];
+	char dir[PATH_MAX];
+	char path[PATH_MAX];
+	char target[64];
+
+	for(unsigned long i = 0; i < num_dirs; i++){
+		unsigned long first = files_made;
+
+		snprintf(name, sizeof(name), "d%06lu", i);
+		join_path(dir, root, name);
+		make_dir(dir);
+		make_files(dir, 20);
+
+		for(int j = 0; j < 20; j++){
+			switch(j % 4){
+				case 0:
+					snprintf(target, sizeof(target), "f%07lu%s", first + j,
+							extensions[(first + j) % (sizeof(extensions) /
+							sizeof(*extensions))]);
+					break;
+				case 1:
+					snprintf(target, sizeof(target), "../d%06lu",
+							(i + 1) % num_dirs);
+					break;
+				case 2:
+					snprintf(target, sizeof(target), "missing%d", j);
+					break;
+				default:
+					snprintf(target, sizeof(target), "..");
+					break;
+			}
+			snprintf(name, sizeof(name), "l%02d", j);
+			join_path(path, dir, name);
+			make_link(target, path);
+		}
+	}
+}
+
+/**
+ * join_path() - Joins a directory and a name into a path. Exits if the path
+ * is too long.
+ *
+ * @param path Where to put the path, PATH_MAX bytes. May be the directory.
+ * @param dir The directory.
+ * @param name The name.
+ */
+void join_path(char *path, const char *dir, const char *name){
+	size_t dir_len = strlen(dir);
+	size_t name_len = strlen(name);
+
+	if(dir_len + name_len + 2 > PATH_MAX){
+		fprintf(stderr, "Too long path below %s\n", dir);
+		exit(EXIT_FAILURE);
+	}
+
+	if(path != dir){
+		memcpy(path, dir, dir_len);
+	}
+	path[dir_len] = '/';
+	memcpy(path + dir_len + 1, name, name_len + 1);
+}
+
+/**
+ * parse_scale() - Parses the argument of -s. Exits if it is not a positive
+ * number.
+ *
+ * @param arg The argument.
+ * @returns The scale.
+ */
+unsigned long parse_scale(const char *arg){
+	char *end;
+
+	errno = 0;
+	unsigned long scale = strtoul(arg, &end, 10);
+	if((errno != 0) || (end == arg) || (*end != '\0') || (scale < 1) ||
+			(scale > 1000)){
+		fprintf(stderr, "Invalid scale, got: %s\n", arg);
+		exit(EXIT_FAILURE);
+	}
+
+	return scale;
+}
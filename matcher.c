@@ -0,0 +1,560 @@
+#include "matcher.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A file name pattern, compiled once into the cheapest way of matching it.
+ * The patterns are globs like those of find -name: '*' matches any string,
+ * '?' any character, "[...]" any character of a set, with ranges, classes
+ * like "[:digit:]" and '!' or '^' to negate the set, and '\' takes the next
+ * character literally. Unlike fnmatch() a leading '.' is matched as any other
+ * character, as find does. A pattern without '?' or sets is matched by
+ * comparing its literal parts, searching for the middle ones with memchr(),
+ * and other patterns first check that the longest literal part is found in
+ * the name. Matching may be done by any number of threads at once.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// How a pattern is matched.
+enum matcher_kind{
+	MATCH_LITERAL, //No wildcards, the name must equal the pattern
+	MATCH_SEGMENTS, //Only '*', the literal parts are searched for in order
+	MATCH_GLOB //Anything else
+};
+
+// One element of a compiled glob.
+enum elem_kind{
+	ELEM_CHAR,
+	ELEM_ANY,
+	ELEM_SET,
+	ELEM_STAR
+};
+
+struct elem{
+	enum elem_kind kind;
+	unsigned char c; //The character of ELEM_CHAR
+	size_t set; //The index of the set of ELEM_SET
+};
+
+// A set of characters, one bit per byte value.
+struct char_set{
+	uint64_t bits[4];
+};
+
+// A literal part of the pattern.
+struct segment{
+	const char *text;
+	size_t len;
+};
+
+// The matcher type.
+struct matcher{
+	enum matcher_kind kind;
+	bool ignore_case;
+	size_t min_len; //No shorter name can match
+	char *text; //The literal characters of the pattern, in order
+	struct segment prefix; //Before the first '*'
+	struct segment suffix; //After the last '*'
+	struct segment *middles; //Between the others
+	size_t num_middles;
+	struct segment core; //The longest literal part of a glob
+	struct elem *elems;
+	size_t num_elems;
+	struct char_set *sets;
+	size_t num_sets;
+};
+
+// The character classes which may be used in a set.
+static const struct{
+	const char *name;
+	int (*is_member)(int c);
+}char_classes[] = {
+	{"alnum", isalnum}, {"alpha", isalpha}, {"blank", isblank},
+	{"cntrl", iscntrl}, {"digit", isdigit}, {"graph", isgraph},
+	{"lower", islower}, {"print", isprint}, {"punct", ispunct},
+	{"space", isspace}, {"upper", isupper}, {"xdigit", isxdigit}
+};
+
+/**
+ * xcalloc() - calloc() which exits the program on failure.
+ * @n: The number of members.
+ * @size: The size of each member.
+ * Returns: A pointer to the zeroed memory.
+ */
+static void *xcalloc(size_t n, size_t size){
+	void *p = calloc((n > 0) ? n : 1, size);
+	if(p == NULL){
+		perror("matcher.c");
+		exit(errno);
+	}
+
+	return p;
+}
+
+/**
+ * set_add() - Adds a character to a set.
+ * @s: The set.
+ * @c: The character.
+ */
+static void set_add(struct char_set *s, unsigned char c){
+	s->bits[c >> 6] |= (uint64_t)1 << (c & 63);
+}
+
+/**
+ * set_has() - Checks if a character is in a set.
+ * @s: The set.
+ * @c: The character.
+ * Returns: true if the character is in the set.
+ */
+static bool set_has(const struct char_set *s, unsigned char c){
+	return (s->bits[c >> 6] >> (c & 63)) & 1;
+}
+
+/**
+ * parse_class() - Parses a class like "[:digit:]" inside a set.
+ * @p: Points at the '[' starting the class.
+ * @s: The set which to add the members of the class to.
+ * Returns: A pointer past the class, or NULL if p does not start a class.
+ */
+static const char *parse_class(const char *p, struct char_set *s){
+	if(p[1] != ':'){
+		return NULL;
+	}
+
+	const char *end = strstr(p + 2, ":]");
+	if(end == NULL){
+		return NULL;
+	}
+
+	size_t len = (size_t)(end - (p + 2));
+	for(size_t i = 0; i < sizeof(char_classes) / sizeof(char_classes[0]);
+			i++){
+		if((strlen(char_classes[i].name) == len) &&
+				(strncmp(char_classes[i].name, p + 2, len) == 0)){
+			for(int c = 0; c < 256; c++){
+				if(char_classes[i].is_member(c)){
+					set_add(s, (unsigned char)c);
+				}
+			}
+		}
+	}
+
+	//An unknown class has no members
+	return end + 2;
+}
+
+/**
+ * parse_set() - Parses a set like "[a-z_]" into a bitmap.
+ * @p: Points at the '[' starting the set.
+ * @s: The set which to fill in.
+ * @ignore_case: If true, the lower case of every upper case letter is added.
+ * Returns: A pointer past the set, or NULL if it has no closing ']'.
+ */
+static const char *parse_set(const char *p, struct char_set *s,
+		bool ignore_case){
+	bool negate = false;
+
+	p++;
+	if((*p == '!') || (*p == '^')){
+		negate = true;
+		p++;
+	}
+
+	//A ']' first in the set is a member
+	bool first = true;
+	while(first || (*p != ']')){
+		first = false;
+
+		if(*p == '\0'){
+			return NULL;
+		}
+
+		if(*p == '['){
+			const char *after = parse_class(p, s);
+			if(after != NULL){
+				p = after;
+				continue;
+			}
+		}
+
+		if((*p == '\\') && (p[1] != '\0')){
+			p++;
+		}
+		unsigned char low = (unsigned char)*p++;
+		unsigned char high = low;
+
+		if((p[0] == '-') && (p[1] != ']') && (p[1] != '\0')){
+			p++;
+			if((*p == '\\') && (p[1] != '\0')){
+				p++;
+			}
+			high = (unsigned char)*p++;
+		}
+
+		for(unsigned c = low; c <= high; c++){
+			set_add(s, (unsigned char)c);
+		}
+	}
+
+	if(ignore_case){
+		for(int c = 'A'; c <= 'Z'; c++){
+			if(set_has(s, (unsigned char)c)){
+				set_add(s, (unsigned char)tolower(c));
+			}
+		}
+	}
+
+	if(negate){
+		for(int i = 0; i < 4; i++){
+			s->bits[i] = ~s->bits[i];
+		}
+	}
+
+	return p + 1;
+}
+
+/**
+ * compile_elems() - Parses the pattern into elements. Runs of '*' become a
+ * single star.
+ * @m: The matcher which to fill in the elements and sets of.
+ * @pattern: The pattern.
+ */
+static void compile_elems(matcher *m, const char *pattern){
+	size_t pattern_len = strlen(pattern);
+
+	m->elems = xcalloc(pattern_len, sizeof(*m->elems));
+	m->sets = xcalloc(pattern_len, sizeof(*m->sets));
+
+	const char *p = pattern;
+	while(*p != '\0'){
+		struct elem *e = &m->elems[m->num_elems];
+
+		if(*p == '*'){
+			p++;
+			if((m->num_elems > 0) && (e[-1].kind == ELEM_STAR)){
+				continue;
+			}
+			e->kind = ELEM_STAR;
+		}
+		else if(*p == '?'){
+			p++;
+			e->kind = ELEM_ANY;
+		}
+		else{
+			const char *after = NULL;
+			if(*p == '['){
+				after = parse_set(p, &m->sets[m->num_sets], m->ignore_case);
+			}
+
+			if(after != NULL){
+				p = after;
+				e->kind = ELEM_SET;
+				e->set = m->num_sets++;
+			}
+			else{
+				//A '[' without a closing ']' is an ordinary character
+				memset(&m->sets[m->num_sets], 0, sizeof(m->sets[0]));
+				if((*p == '\\') && (p[1] != '\0')){
+					p++;
+				}
+				e->kind = ELEM_CHAR;
+				e->c = (unsigned char)*p++;
+				if(m->ignore_case){
+					e->c = (unsigned char)tolower(e->c);
+				}
+			}
+		}
+
+		m->num_elems++;
+	}
+}
+
+/**
+ * compile_literals() - Copies the literal characters of the elements into one
+ * string and finds the literal parts of the pattern: the prefix, suffix and
+ * middle parts of a pattern with only '*' and the longest part of a glob.
+ * @m: The matcher.
+ */
+static void compile_literals(matcher *m){
+	m->text = xcalloc(m->num_elems + 1, 1);
+	m->middles = xcalloc(m->num_elems, sizeof(*m->middles));
+
+	bool only_stars = true;
+	size_t num_stars = 0;
+	size_t len = 0;
+	struct segment run = {m->text, 0};
+
+	for(size_t i = 0; i <= m->num_elems; i++){
+		if((i < m->num_elems) && (m->elems[i].kind == ELEM_CHAR)){
+			m->text[len++] = (char)m->elems[i].c;
+			run.len++;
+			continue;
+		}
+
+		//A run of literal characters ends here
+		if(run.len > m->core.len){
+			m->core = run;
+		}
+		if(num_stars == 0){
+			m->prefix = run;
+		}
+		else if(i == m->num_elems){
+			m->suffix = run;
+		}
+		else if(run.len > 0){
+			m->middles[m->num_middles++] = run;
+		}
+
+		if(i < m->num_elems){
+			if(m->elems[i].kind == ELEM_STAR){
+				num_stars++;
+			}
+			else{
+				only_stars = false;
+				m->min_len++;
+			}
+		}
+		run.text = m->text + len;
+		run.len = 0;
+	}
+
+	m->min_len += len;
+
+	if(!only_stars){
+		m->kind = MATCH_GLOB;
+	}
+	else if(num_stars == 0){
+		m->kind = MATCH_LITERAL;
+	}
+	else{
+		m->kind = MATCH_SEGMENTS;
+	}
+}
+
+/**
+ * find_literal() - Finds a string in a name, looking for its first character
+ * with memchr() and comparing the rest where it is found.
+ * @hay: Where to search.
+ * @hay_len: The length of hay.
+ * @s: The string which to find.
+ * Returns: A pointer to the first place s is found in hay, or NULL.
+ */
+static const char *find_literal(const char *hay, size_t hay_len,
+		const struct segment *s){
+	if(s->len == 0){
+		return hay;
+	}
+	if(hay_len < s->len){
+		return NULL;
+	}
+
+	const char *p = hay;
+	const char *last = hay + hay_len - s->len;
+	while((p = memchr(p, s->text[0], (size_t)(last - p) + 1)) != NULL){
+		if(memcmp(p + 1, s->text + 1, s->len - 1) == 0){
+			return p;
+		}
+		if(p++ == last){
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * match_segments() - Matches a name against a pattern with only '*'. The
+ * prefix and suffix are compared in place and the middle parts are searched
+ * for in order, each taking the first place it is found.
+ * @m: The matcher.
+ * @name: The name.
+ * @len: The length of the name.
+ * Returns: true if the name matches.
+ */
+static bool match_segments(const matcher *m, const char *name, size_t len){
+	if((memcmp(name, m->prefix.text, m->prefix.len) != 0) ||
+			(memcmp(name + len - m->suffix.len, m->suffix.text,
+			m->suffix.len) != 0)){
+		return false;
+	}
+
+	const char *p = name + m->prefix.len;
+	const char *end = name + len - m->suffix.len;
+	for(size_t i = 0; i < m->num_middles; i++){
+		p = find_literal(p, (size_t)(end - p), &m->middles[i]);
+		if(p == NULL){
+			return false;
+		}
+		p += m->middles[i].len;
+	}
+
+	return true;
+}
+
+/**
+ * match_glob() - Matches a name against the elements of the pattern. On a
+ * mismatch the last '*' takes one more character and matching continues after
+ * it, which is enough since an earlier '*' never needs to take more.
+ * @m: The matcher.
+ * @name: The name.
+ * @len: The length of the name.
+ * Returns: true if the name matches.
+ */
+static bool match_glob(const matcher *m, const char *name, size_t len){
+	if(find_literal(name, len, &m->core) == NULL){
+		return false;
+	}
+
+	size_t n = 0;
+	size_t e = 0;
+	size_t star_e = SIZE_MAX;
+	size_t star_n = 0;
+
+	while(n < len){
+		if(e < m->num_elems){
+			const struct elem *el = &m->elems[e];
+			unsigned char c = (unsigned char)name[n];
+
+			if(el->kind == ELEM_STAR){
+				star_e = e++;
+				star_n = n;
+				continue;
+			}
+			if((el->kind == ELEM_ANY) ||
+					((el->kind == ELEM_CHAR) && (el->c == c)) ||
+					((el->kind == ELEM_SET) &&
+					set_has(&m->sets[el->set], c))){
+				e++;
+				n++;
+				continue;
+			}
+		}
+
+		if(star_e == SIZE_MAX){
+			return false;
+		}
+		e = star_e + 1;
+		n = ++star_n;
+	}
+
+	while((e < m->num_elems) && (m->elems[e].kind == ELEM_STAR)){
+		e++;
+	}
+
+	return e == m->num_elems;
+}
+
+/**
+ * matcher_new() - Compiles a pattern. A '[' without a closing ']' and a '\'
+ * at the end of the pattern are taken literally, so all patterns are valid.
+ * @pattern: The pattern.
+ * @ignore_case: If true, letters match regardless of their case.
+ * Returns: A pointer to the new matcher.
+ */
+matcher *matcher_new(const char *pattern, bool ignore_case){
+	matcher *m = xcalloc(1, sizeof(*m));
+
+	m->ignore_case = ignore_case;
+	compile_elems(m, pattern);
+	compile_literals(m);
+
+	return m;
+}
+
+/**
+ * matcher_match() - Checks if a name matches the pattern.
+ * @m: The matcher.
+ * @name: The name, without any directory.
+ * Returns: true if the whole name matches, else false.
+ */
+bool matcher_match(const matcher *m, const char *name){
+	size_t len = strlen(name);
+
+	if((len < m->min_len) ||
+			((m->kind == MATCH_LITERAL) && (len != m->min_len))){
+		return false;
+	}
+
+	//The pattern is in lower case already, so only the name is folded
+	char folded_buf[NAME_MAX + 1];
+	char *folded = NULL;
+	if(m->ignore_case){
+		folded = (len < sizeof(folded_buf)) ? folded_buf : malloc(len + 1);
+		if(folded == NULL){
+			return false;
+		}
+		for(size_t i = 0; i < len; i++){
+			folded[i] = (char)tolower((unsigned char)name[i]);
+		}
+		folded[len] = '\0';
+		name = folded;
+	}
+
+	bool match;
+	switch(m->kind){
+		case MATCH_LITERAL:
+			match = (memcmp(name, m->text, len) == 0);
+			break;
+		case MATCH_SEGMENTS:
+			match = match_segments(m, name, len);
+			break;
+		case MATCH_GLOB:
+		default:
+			match = match_glob(m, name, len);
+			break;
+	}
+
+	if((folded != NULL) && (folded != folded_buf)){
+		free(folded);
+	}
+
+	return match;
+}
+
+/**
+ * matcher_literal() - Gives the pattern as a plain string if it has no
+ * wildcards. With ignore_case the string is in lower case.
+ * @m: The matcher.
+ * @len: Where to put the length of the string.
+ * Returns: The string, not null terminated, or NULL if the pattern has
+ * wildcards.
+ */
+const char *matcher_literal(const matcher *m, size_t *len){
+	if(m->kind != MATCH_LITERAL){
+		return NULL;
+	}
+
+	*len = m->min_len;
+	return m->text;
+}
+
+/**
+ * matcher_core() - Gives the longest literal part of the pattern, which every
+ * matching name contains. With ignore_case it is in lower case.
+ * @m: The matcher.
+ * @len: Where to put the length of the part, 0 if the pattern has none.
+ * Returns: The part, not null terminated.
+ */
+const char *matcher_core(const matcher *m, size_t *len){
+	*len = m->core.len;
+	return m->core.text;
+}
+
+/**
+ * matcher_kill() - Removes the matcher.
+ * @m: The matcher which to remove.
+ */
+void matcher_kill(matcher *m){
+	free(m->text);
+	free(m->middles);
+	free(m->elems);
+	free(m->sets);
+	free(m);
+}
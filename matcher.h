@@ -0,0 +1,66 @@
+#ifndef __MATCHER_H_
+#define __MATCHER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * A file name pattern, compiled once into the cheapest way of matching it.
+ * The patterns are globs like those of find -name: '*' matches any string,
+ * '?' any character, "[...]" any character of a set, with ranges, classes
+ * like "[:digit:]" and '!' or '^' to negate the set, and '\' takes the next
+ * character literally. Unlike fnmatch() a leading '.' is matched as any other
+ * character, as find does. A pattern without '?' or sets is matched by
+ * comparing its literal parts, searching for the middle ones with memchr(),
+ * and other patterns first check that the longest literal part is found in
+ * the name. Matching may be done by any number of threads at once.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The matcher type.
+typedef struct matcher matcher;
+
+/**
+ * matcher_new() - Compiles a pattern. A '[' without a closing ']' and a '\'
+ * at the end of the pattern are taken literally, so all patterns are valid.
+ * @pattern: The pattern.
+ * @ignore_case: If true, letters match regardless of their case.
+ * Returns: A pointer to the new matcher.
+ */
+matcher *matcher_new(const char *pattern, bool ignore_case);
+
+/**
+ * matcher_match() - Checks if a name matches the pattern.
+ * @m: The matcher.
+ * @name: The name, without any directory.
+ * Returns: true if the whole name matches, else false.
+ */
+bool matcher_match(const matcher *m, const char *name);
+
+/**
+ * matcher_literal() - Gives the pattern as a plain string if it has no
+ * wildcards. With ignore_case the string is in lower case.
+ * @m: The matcher.
+ * @len: Where to put the length of the string.
+ * Returns: The string, not null terminated, or NULL if the pattern has
+ * wildcards.
+ */
+const char *matcher_literal(const matcher *m, size_t *len);
+
+/**
+ * matcher_core() - Gives the longest literal part of the pattern, which every
+ * matching name contains. With ignore_case it is in lower case.
+ * @m: The matcher.
+ * @len: Where to put the length of the part, 0 if the pattern has none.
+ * Returns: The part, not null terminated.
+ */
+const char *matcher_core(const matcher *m, size_t *len);
+
+/**
+ * matcher_kill() - Removes the matcher.
+ * @m: The matcher which to remove.
+ */
+void matcher_kill(matcher *m);
+
+#endif //__MATCHER_H_
@@ -0,0 +1,434 @@
+/* For statx() */
+#define _GNU_SOURCE
+
+#include "meta_filter.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <limits.h>
+#include <pwd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Tests on the metadata of a file, like the -size, -mtime, -newer, -user,
+ * -group and -perm tests of find. The tests are compiled once into a list,
+ * which a file must pass all of, and the statx() fields they need are
+ * gathered into one mask. That way a file is only examined with statx() when
+ * its name and type already match, and only the needed fields are asked for.
+ * Once all tests are added the filter is only read, so any number of threads
+ * may use it at once. struct statx needs _GNU_SOURCE.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The seconds of a day, for -mtime.
+#define SECONDS_PER_DAY 86400
+
+// What a test looks at.
+enum test_kind{
+	TEST_SIZE,
+	TEST_MTIME,
+	TEST_NEWER,
+	TEST_UID,
+	TEST_GID,
+	TEST_PERM
+};
+
+// How a test compares.
+enum test_cmp{
+	CMP_LESS,
+	CMP_EQUAL,
+	CMP_MORE,
+	CMP_ALL_BITS,
+	CMP_ANY_BITS
+};
+
+struct test{
+	enum test_kind kind;
+	enum test_cmp cmp;
+	int64_t value;
+	uint64_t unit; //The bytes of a -size unit
+	struct statx_timestamp time; //The time of -newer
+};
+
+// The filter type.
+struct meta_filter{
+	struct test *tests;
+	size_t num_tests;
+	size_t max_tests;
+	unsigned int mask;
+	int64_t now;
+};
+
+/**
+ * meta_filter_new() - Create a new filter without tests, which every file
+ * passes. The time of the -mtime tests is counted from now.
+ * Returns: A pointer to the new filter.
+ */
+meta_filter *meta_filter_new(void){
+	meta_filter *f = calloc(1, sizeof(*f));
+	if(f == NULL){
+		perror("meta_filter.c");
+		exit(errno);
+	}
+
+	f->now = (int64_t)time(NULL);
+
+	return f;
+}
+
+/**
+ * parse_number() - Parses a number with an optional '+' or '-' in front.
+ * @arg: The argument.
+ * @cmp: Where to put the comparison the sign gives.
+ * @end: Where to put a pointer past the number.
+ * Returns: The number, or -1 if there is none.
+ */
+static int64_t parse_number(const char *arg, enum test_cmp *cmp,
+		const char **end){
+	*cmp = CMP_EQUAL;
+	if(*arg == '+'){
+		*cmp = CMP_MORE;
+		arg++;
+	}
+	else if(*arg == '-'){
+		*cmp = CMP_LESS;
+		arg++;
+	}
+
+	if(!isdigit((unsigned char)*arg)){
+		return -1;
+	}
+
+	char *number_end;
+	errno = 0;
+	long long value = strtoll(arg, &number_end, 10);
+	if(errno != 0){
+		return -1;
+	}
+	*end = number_end;
+
+	return (int64_t)value;
+}
+
+/**
+ * parse_size() - Parses the argument of -size.
+ * @t: The test which to fill in.
+ * @arg: The argument.
+ * Returns: NULL on success, or a description of the error.
+ */
+static const char *parse_size(struct test *t, const char *arg){
+	const char *end;
+
+	t->value = parse_number(arg, &t->cmp, &end);
+	if(t->value < 0){
+		return "invalid size";
+	}
+
+	switch(*end){
+		case '\0':
+		case 'b':
+			t->unit = 512;
+			break;
+		case 'c':
+			t->unit = 1;
+			break;
+		case 'w':
+			t->unit = 2;
+			break;
+		case 'k':
+			t->unit = 1024;
+			break;
+		case 'M':
+			t->unit = 1024 * 1024;
+			break;
+		case 'G':
+			t->unit = 1024 * 1024 * 1024;
+			break;
+		default:
+			return "invalid size unit";
+	}
+	if((*end != '\0') && (end[1] != '\0')){
+		return "invalid size unit";
+	}
+
+	return NULL;
+}
+
+/**
+ * parse_id() - Parses a user or group given as a name or a number.
+ * @t: The test which to fill in.
+ * @arg: The argument.
+ * @is_user: true for a user, false for a group.
+ * Returns: NULL on success, or a description of the error.
+ */
+static const char *parse_id(struct test *t, const char *arg, bool is_user){
+	if(is_user){
+		struct passwd *pw = getpwnam(arg);
+		if(pw != NULL){
+			t->value = pw->pw_uid;
+			return NULL;
+		}
+	}
+	else{
+		struct group *gr = getgrnam(arg);
+		if(gr != NULL){
+			t->value = gr->gr_gid;
+			return NULL;
+		}
+	}
+
+	char *end;
+	errno = 0;
+	unsigned long id = strtoul(arg, &end, 10);
+	if((errno != 0) || (end == arg) || (*end != '\0') || (id > UINT_MAX) ||
+			!isdigit((unsigned char)*arg)){
+		return is_user ? "no such user" : "no such group";
+	}
+	t->value = (int64_t)id;
+
+	return NULL;
+}
+
+/**
+ * parse_perm() - Parses the argument of -perm, an octal mode.
+ * @t: The test which to fill in.
+ * @arg: The argument.
+ * Returns: NULL on success, or a description of the error.
+ */
+static const char *parse_perm(struct test *t, const char *arg){
+	t->cmp = CMP_EQUAL;
+	if(*arg == '-'){
+		t->cmp = CMP_ALL_BITS;
+		arg++;
+	}
+	else if(*arg == '/'){
+		t->cmp = CMP_ANY_BITS;
+		arg++;
+	}
+
+	char *end;
+	errno = 0;
+	unsigned long mode = strtoul(arg, &end, 8);
+	if((errno != 0) || (end == arg) || (*end != '\0') || (mode > 07777) ||
+			!isdigit((unsigned char)*arg)){
+		return "invalid mode, only octal modes are supported";
+	}
+	t->value = (int64_t)mode;
+
+	return NULL;
+}
+
+/**
+ * add_test() - Appends a test to the list of a filter.
+ * @f: The filter.
+ * @t: The test, which is copied.
+ */
+static void add_test(meta_filter *f, const struct test *t){
+	if(f->num_tests == f->max_tests){
+		f->max_tests = (f->max_tests > 0) ? f->max_tests * 2 : 4;
+		f->tests = realloc(f->tests, f->max_tests * sizeof(*f->tests));
+		if(f->tests == NULL){
+			perror("meta_filter.c");
+			exit(errno);
+		}
+	}
+	f->tests[f->num_tests++] = *t;
+}
+
+/**
+ * meta_filter_add() - Parses a test and adds it to the filter. The tests are:
+ *   size [+-]N[cwbkMG]  Size rounded up to units, 512 bytes if none given.
+ *   mtime [+-]N         Modified N whole days ago.
+ *   newer FILE          Modified after FILE was.
+ *   user NAME           Owned by the user, a name or a number.
+ *   group NAME          Owned by the group, a name or a number.
+ *   perm [-/]MODE       Octal permission bits are MODE exactly, with '-' all
+ *                       of MODE are set and with '/' any of MODE is set.
+ * A '+' means more than N and '-' less than N.
+ * @f: The filter.
+ * @test: The name of the test, without the '-'.
+ * @arg: The argument of the test.
+ * Returns: NULL on success, or a description of the error.
+ */
+const char *meta_filter_add(meta_filter *f, const char *test, const char *arg){
+	struct test t;
+	const char *error = NULL;
+	const char *end;
+
+	memset(&t, 0, sizeof(t));
+
+	if(strcmp(test, "size") == 0){
+		t.kind = TEST_SIZE;
+		error = parse_size(&t, arg);
+		f->mask |= STATX_SIZE;
+	}
+	else if(strcmp(test, "mtime") == 0){
+		t.kind = TEST_MTIME;
+		t.value = parse_number(arg, &t.cmp, &end);
+		if((t.value < 0) || (*end != '\0')){
+			error = "invalid number of days";
+		}
+		f->mask |= STATX_MTIME;
+	}
+	else if(strcmp(test, "newer") == 0){
+		struct statx st;
+		t.kind = TEST_NEWER;
+		if(statx(AT_FDCWD, arg, AT_SYMLINK_NOFOLLOW, STATX_MTIME, &st) < 0){
+			error = strerror(errno);
+		}
+		else{
+			t.time = st.stx_mtime;
+		}
+		f->mask |= STATX_MTIME;
+	}
+	else if((strcmp(test, "user") == 0) || (strcmp(test, "group") == 0)){
+		bool is_user = (test[0] == 'u');
+		t.kind = is_user ? TEST_UID : TEST_GID;
+		error = parse_id(&t, arg, is_user);
+		f->mask |= is_user ? STATX_UID : STATX_GID;
+	}
+	else if(strcmp(test, "perm") == 0){
+		t.kind = TEST_PERM;
+		error = parse_perm(&t, arg);
+		f->mask |= STATX_MODE;
+	}
+	else{
+		error = "unknown test";
+	}
+
+	if(error != NULL){
+		return error;
+	}
+	add_test(f, &t);
+
+	return NULL;
+}
+
+/**
+ * meta_filter_join() - Adds all the tests of another filter to a filter, so
+ * one statx() result is checked against both at once.
+ * @f: The filter which to add to.
+ * @other: The filter whose tests are added. It is left as it was.
+ */
+void meta_filter_join(meta_filter *f, const meta_filter *other){
+	for(size_t i = 0; i < other->num_tests; i++){
+		add_test(f, &other->tests[i]);
+	}
+	f->mask |= other->mask;
+}
+
+/**
+ * meta_filter_is_empty() - Checks if the filter has any tests.
+ * @f: The filter.
+ * Returns: true if every file passes without being examined.
+ */
+bool meta_filter_is_empty(const meta_filter *f){
+	return f->num_tests == 0;
+}
+
+/**
+ * meta_filter_mask() - Gives the statx() fields the tests need.
+ * @f: The filter.
+ * Returns: The STATX_* mask.
+ */
+unsigned int meta_filter_mask(const meta_filter *f){
+	return f->mask;
+}
+
+/**
+ * compare() - Compares a value of a file with the value of a test.
+ * @cmp: How to compare.
+ * @file_value: The value of the file.
+ * @test_value: The value of the test.
+ * Returns: true if the file passes.
+ */
+static bool compare(enum test_cmp cmp, int64_t file_value,
+		int64_t test_value){
+	switch(cmp){
+		case CMP_LESS:
+			return file_value < test_value;
+		case CMP_MORE:
+			return file_value > test_value;
+		case CMP_ALL_BITS:
+			return (file_value & test_value) == test_value;
+		case CMP_ANY_BITS:
+			return (test_value == 0) || ((file_value & test_value) != 0);
+		case CMP_EQUAL:
+		default:
+			return file_value == test_value;
+	}
+}
+
+/**
+ * meta_filter_match() - Runs the tests on a file.
+ * @f: The filter.
+ * @st: The file, examined with at least the fields of meta_filter_mask().
+ * Returns: true if the file passes all the tests, else false.
+ */
+bool meta_filter_match(const meta_filter *f, const struct statx *st){
+	//A file system may not give every field
+	if((st->stx_mask & f->mask) != f->mask){
+		return false;
+	}
+
+	for(size_t i = 0; i < f->num_tests; i++){
+		const struct test *t = &f->tests[i];
+		bool pass;
+
+		switch(t->kind){
+			case TEST_SIZE:{
+				//Rounded up, so -size -1 (in any unit) is only empty files
+				int64_t units = (int64_t)((st->stx_size + t->unit - 1) /
+						t->unit);
+				pass = compare(t->cmp, units, t->value);
+				break;
+			}
+			case TEST_MTIME:{
+				int64_t age = f->now - st->stx_mtime.tv_sec;
+				int64_t days = age / SECONDS_PER_DAY;
+				if((age < 0) && (age % SECONDS_PER_DAY != 0)){
+					days--; //Round towards the past, like find
+				}
+				pass = compare(t->cmp, days, t->value);
+				break;
+			}
+			case TEST_NEWER:
+				pass = (st->stx_mtime.tv_sec > t->time.tv_sec) ||
+						((st->stx_mtime.tv_sec == t->time.tv_sec) &&
+						(st->stx_mtime.tv_nsec > t->time.tv_nsec));
+				break;
+			case TEST_UID:
+				pass = (st->stx_uid == (uint64_t)t->value);
+				break;
+			case TEST_GID:
+				pass = (st->stx_gid == (uint64_t)t->value);
+				break;
+			case TEST_PERM:
+			default:
+				pass = compare(t->cmp, st->stx_mode & 07777, t->value);
+				break;
+		}
+
+		if(!pass){
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * meta_filter_kill() - Removes the filter.
+ * @f: The filter which to remove.
+ */
+void meta_filter_kill(meta_filter *f){
+	free(f->tests);
+	free(f);
+}
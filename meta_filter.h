@@ -0,0 +1,82 @@
+#ifndef __META_FILTER_H_
+#define __META_FILTER_H_
+
+#include <stdbool.h>
+#include <sys/stat.h>
+
+/*
+ * Tests on the metadata of a file, like the -size, -mtime, -newer, -user,
+ * -group and -perm tests of find. The tests are compiled once into a list,
+ * which a file must pass all of, and the statx() fields they need are
+ * gathered into one mask. That way a file is only examined with statx() when
+ * its name and type already match, and only the needed fields are asked for.
+ * Once all tests are added the filter is only read, so any number of threads
+ * may use it at once. struct statx needs _GNU_SOURCE.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The filter type.
+typedef struct meta_filter meta_filter;
+
+/**
+ * meta_filter_new() - Create a new filter without tests, which every file
+ * passes. The time of the -mtime tests is counted from now.
+ * Returns: A pointer to the new filter.
+ */
+meta_filter *meta_filter_new(void);
+
+/**
+ * meta_filter_add() - Parses a test and adds it to the filter. The tests are:
+ *   size [+-]N[cwbkMG]  Size rounded up to units, 512 bytes if none given.
+ *   mtime [+-]N         Modified N whole days ago.
+ *   newer FILE          Modified after FILE was.
+ *   user NAME           Owned by the user, a name or a number.
+ *   group NAME          Owned by the group, a name or a number.
+ *   perm [-/]MODE       Octal permission bits are MODE exactly, with '-' all
+ *                       of MODE are set and with '/' any of MODE is set.
+ * A '+' means more than N and '-' less than N.
+ * @f: The filter.
+ * @test: The name of the test, without the '-'.
+ * @arg: The argument of the test.
+ * Returns: NULL on success, or a description of the error.
+ */
+const char *meta_filter_add(meta_filter *f, const char *test, const char *arg);
+
+/**
+ * meta_filter_join() - Adds all the tests of another filter to a filter, so
+ * one statx() result is checked against both at once.
+ * @f: The filter which to add to.
+ * @other: The filter whose tests are added. It is left as it was.
+ */
+void meta_filter_join(meta_filter *f, const meta_filter *other);
+
+/**
+ * meta_filter_is_empty() - Checks if the filter has any tests.
+ * @f: The filter.
+ * Returns: true if every file passes without being examined.
+ */
+bool meta_filter_is_empty(const meta_filter *f);
+
+/**
+ * meta_filter_mask() - Gives the statx() fields the tests need.
+ * @f: The filter.
+ * Returns: The STATX_* mask.
+ */
+unsigned int meta_filter_mask(const meta_filter *f);
+
+/**
+ * meta_filter_match() - Runs the tests on a file.
+ * @f: The filter.
+ * @st: The file, examined with at least the fields of meta_filter_mask().
+ * Returns: true if the file passes all the tests, else false.
+ */
+bool meta_filter_match(const meta_filter *f, const struct statx *st);
+
+/**
+ * meta_filter_kill() - Removes the filter.
+ * @f: The filter which to remove.
+ */
+void meta_filter_kill(meta_filter *f);
+
+#endif //__META_FILTER_H_
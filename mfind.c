@@ -1,353 +1,223 @@
 /*
  * mfind.c Is an implementation of the Linux command ''find'' but simplified.
- * This program will search for the given name in the given start directory. A
- * file type can be given as an input, which will cause the program to only
- * search for this file type. The current supported types are symbolic links,
- * regular files and directories.
+ * This program will search for the given name in the given start directory. The
+ * name may be a pattern like those of find -name, such as "*.log", and with -i
+ * the case of letters is ignored. Many names can be searched for at once, given
+ * with -n or in a file with -f, which are all matched in one pass, as are
+ * regular expressions given with -regex. A file type can be given as an input,
+ * which will cause the program to only search for this file type. The current
+ * supported types are symbolic links, regular files and directories. The
+ * files found can be further limited by an expression like that of find,
+ * with the tests -name, -type, -size, -mtime, -newer, -user, -group, -perm
+ * and -prune joined by -not, -and, -or and parentheses. With -D an index of
+ * the whole trees is written, which later searches can use with -d instead
+ * of reading the trees again, checking for changes with -fresh. With -c the
+ * entries of every directory read are kept in a cache, and a directory which
+ * has not changed since is not read again by a later search using the cache.
+ * The order the directories are searched in is chosen with -order. The
+ * search can be kept within -mindepth and -maxdepth levels below the start
+ * directories, and be stopped at the first match with -quit or after N with
+ * -count N. With -p auto the number of threads searching is adapted to how
+ * the search goes. The entries of a huge directory are checked by all the
+ * threads, not only by the one reading it. With -grep only the regular files
+ * holding a text are printed, up to a size given with -grepmax. With -stats
+ * the statistics of the search are reported on stderr, or as JSON in a file.
+ * With -L symbolic links are followed, and a directory reached through many
+ * paths, or through a loop, is searched only once.
+ * The search itself is done by libmfind, see libmfind.h, and this program
+ * parses the arguments and prints the paths of the files found.
  *
  *  Created on: 16 October 2018
  *      Author: Bram Coenen (tfy15bcn)
  */
 
+/* For statx() */
+#define _GNU_SOURCE
+
 /*Own includes*/
-#include "list.h"
+#include "content_scan.h"
+#include "dir_cache.h"
+#include "dir_reader.h"
+#include "expr.h"
+#include "libmfind.h"
+#include "name_set.h"
+#include "out_buffer.h"
+#include "path_index.h"
+#include "regex_dfa.h"
 
 /*Standard C includes */
-#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <string.h>
 #include <errno.h>
 #include <limits.h>
-#include <semaphore.h>
-#include <sys/sysmacros.h>
-#include <dirent.h>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <libgen.h>
-#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 /* Function prototypes */
-int parse_arguments(int argc, char **argv);
-void remove_leftover_dirs_from_list(void);
+void parse_arguments(int argc, char **argv);
 void clean_up_and_exit(int exit_code);
-void thread_and_start_search(int num_of_threads);
-void initialize_list(void);
-void *search_through_list(void *not_used __attribute__((unused)));
-char *get_dir_from_list(void);
-void check_directory(char *dir);
-void check_file(char *file_path);
-void add_dir_to_list(char *dir);
+void initialize_outputs(void);
+bool print_match(const mfind_match *m, void *arg);
+void flush_outputs(void);
+enum mfind_order parse_dir_order(const char *arg);
+size_t parse_buffer_size(char *arg);
+void read_names_file(const char *file_name);
+void add_regex(const char *pattern);
+unsigned parse_uring_depth(char *arg);
 void inc_global_err_count(void);
-void initialize_sem_active_threads(int threads);
-void initialize_sem_err_count(void);
-void add_argument_to_list_if_sym_link(char *arg);
-void check_input_argument(char *arg);
-
-/* Global list */
-list *dirs_to_check;
-
-/* The type to check for. 'f' for file, 'd' for directory and 'l' for link.
- * Set once, and only read afterwards. Default 'a' is for all types.*/
-char search_for_type = 'a';
-
-/* The filename which will be searched for. */
-char *search_for_name;
-
-/*The gobal error count */
-unsigned int err_count = 0;
-
-/* The global semaphores for shared resource protection */
-sem_t sem_list;
-sem_t sem_err;
-sem_t sem_active_threads;
-
-/**
- * main() - The main function of the program which calls on the initialization
- * function for the list, semaphores,... Then the search is started and
- * afterwards all the semaphores and the list are destroyed. The global error
- * count is passed as an exitcode.
- *
- * @param argc The number of arguments given to the program.
- * @param argv An array of strings which are passed to the program.
- * @return It never returns...
- */
-int main(int argc, char **argv){
-
-	initialize_list();
-
-	initialize_sem_err_count();
-
-	int num_of_threads = parse_arguments(argc, argv);
+unsigned int parse_depth(const char *option, char *arg);
+unsigned long parse_count(char *arg);
+off_t parse_grep_max(char *arg);
+void report_stats(void);
 
-	initialize_sem_active_threads(num_of_threads);
+/* What to search for and how, filled in from the arguments. The expression,
+ * index and cache are taken over by the search once it is created. */
+mfind_options search_options;
 
-	thread_and_start_search(num_of_threads);
+/* The search, NULL until it has been created. */
+mfind_search *search;
 
-	clean_up_and_exit(err_count);
-}
-
-/**
- * thread_and_start_search() - Creates the number of desired threads and starts
- * the search. Only if more than 1 thread is requested will additional threads
- * be created.
- *
- * @param num_of_threads The number of threads requested by the user.
- */
-void thread_and_start_search(int num_of_threads){
-	if(num_of_threads > 1){
-
-		pthread_t thread_id[num_of_threads-1];
-
-		for(int i = 0 ; i < num_of_threads-1; i++){
-			if(pthread_create(&thread_id[i], NULL, search_through_list, NULL)){
-				perror("pthread");
-			}
-		}
-
-		search_through_list(NULL);
+/* The start directories given by the user. */
+char **start_dirs;
 
-		for(int i = 0 ; i < num_of_threads-1; i++){
-			if(pthread_join(thread_id[i], NULL)){
-				perror("pthread");
-			}
-		}
-
-	}
-	else {
-		search_through_list(NULL);
-	}
-
-}
-
-/**
- * search_through_list() - This function starts the search through the list. As
- * long as the list in not empty, new threads will loop through this list. If
- * the list is empty and there are no active threads, the function will return.
- *
- * This function is the start for the threads and this requires the function to
- * take in a void * and return a void *. These are not used, however could be
- * used to take in the name the program is searching for and for example return
- * the amount of errors encountered.
- *
- * @param not_used Ignored
- * @return Pointer to NULL.
- */
-void *search_through_list(void *not_used __attribute__((unused))){
-
-	char *dir;
-	unsigned long opened_dirs = 0;
-	int active_threads = 0;
-
-	do{
-		while((dir = get_dir_from_list()) != NULL){
-			//Release semaphore to show thread is active
-			if(sem_post(&sem_active_threads) < 0){
-				fprintf(stderr, "Could not release semaphore! " \
-						"Exiting to prevent dead-lock!");
-				clean_up_and_exit(EXIT_FAILURE);
-			}
-
-
-			check_directory(dir);
-			opened_dirs++;
-			free(dir);
-
-			if(sem_wait(&sem_active_threads) < 0){ //Take semaphore
-				fprintf(stderr, "Could not take semaphore!");
-				clean_up_and_exit(EXIT_FAILURE);
-			}
-		}
-
-		//Get sem value to see if thread should end
-		if(sem_getvalue(&sem_active_threads, &active_threads) != 0){
-			perror("sem_getvalue");
-			fprintf(stderr, "Thread could not get sem value. Killing thread!");
-			active_threads = 0;
-		}
-	}while(active_threads);
-
-	fprintf(stdout, "Thread: %lu Reads: %lu\n", pthread_self(), opened_dirs);
-	return NULL;
-}
-
-/**
- * check_directory() - Check if the given directory contains a file with the
- * name we are searching for. All the files in the directory are checked, but
- * "." and ".." are ignored. If the
- *
- * @param dir_path The path to the directory which should be opened.
- */
-void check_directory(char *dir_path){
-	struct dirent *dir_pointer;
-	char file_path[PATH_MAX];
-
-	DIR *dir_stream = opendir(dir_path);
-
-	if (dir_stream == NULL) {
-		if(errno != EACCES){ //FIXME: labres does not count this as an error...
-			inc_global_err_count();
-		}
-		perror(dir_path);
-
-		return;
-	}
-
-	while ((dir_pointer = readdir(dir_stream)) != NULL) {
-
-		if((strcmp(dir_pointer->d_name,".") == 0) ||
-				(strcmp(dir_pointer->d_name, "..") == 0)){
-			continue;
-		}
-
-		strcpy(file_path, dir_path);
-		strcat(file_path, "/");
-		strcat(file_path, dir_pointer->d_name);
-
-		check_file(file_path);
-	}
-
-	if(closedir(dir_stream) < 0){
-		perror(dir_path);
-	}
+/* The type to check for, option -t. 'f' for file, 'd' for directory and 'l'
+ * for link. Default 'a' is for all types.*/
+char search_for_type = 'a';
 
-}
+/* The filenames which will be searched for, patterns like those of find
+ * -name. A file is printed if any of them match. Handed over to the
+ * expression when the arguments are parsed. */
+name_set *search_for_names;
 
-/**
- * check_file() - Checks if the given file path goes to a file with the name
- * the program is searching for. This also depends on which type of file the
- * program is searching for. The file path is printed if the file matches what
- * the program is searching for.
- *
- * If the path points to a directory, this directory will be added to the list.
- *
- * @param file_path The path to the file which should be checked.
- */
-void check_file(char *file_path){
-	struct stat file_info;
+/* If the case of letters is ignored when matching names, option -i. */
+bool ignore_case = false;
 
-	if (lstat(file_path, &file_info) < 0) {
-		perror(file_path);
-		return;
-	}
+/* The character written after each found path, '\0' with option -0. */
+char output_terminator = '\n';
 
-	if (S_ISDIR(file_info.st_mode)) { //Check if dir
-		if(((search_for_type == 'd')||(search_for_type == 'a')) &&
-				(strcmp(basename(file_path),search_for_name) == 0)){
-			fprintf(stdout, "%s\n", file_path);
-		}
+/* The file the statistics are written to as JSON, option -stats=FILE. NULL
+ * when they are written to stderr as a table. */
+const char *stats_file;
 
-		add_dir_to_list(file_path);
+/* The output buffer of each thread of the search, by its number. Only used
+ * by that thread while searching. */
+out_buffer **outputs;
+int num_outputs = 0;
 
-	}
-	if(S_ISREG(file_info.st_mode)){ //Check if file
-		if(((search_for_type == 'f')||(search_for_type == 'a')) &&
-				(strcmp(basename(file_path),search_for_name) == 0)){
-			fprintf(stdout, "%s\n", file_path);
-		}
-	}
-	if(S_ISLNK(file_info.st_mode)){ //Check if symlink
-		if(((search_for_type == 'l')||(search_for_type == 'a')) &&
-				(strcmp(basename(file_path),search_for_name) == 0)){
-			fprintf(stdout, "%s\n", file_path);
-		}
-	}
-	/* else{
-		Something else we don't care about
-	}*/
-}
+/* The errors of writing the output and the statistics. Those of the search
+ * are counted by the search. */
+atomic_uint err_count = 0;
 
 /**
- * initialize_sem_active_threads() - Initialize the semaphore which can be used
- * to examine how many threads in the program are actively searching through a
- * directory. The semaphore shall be initialized to the number of threads the
- * user has requested.
+ * main() - The main function of the program which parses the arguments and
+ * creates the search. Then the search is run, printing the paths found, and
+ * afterwards the search is removed. The error count is passed as an
+ * exitcode.
  *
- * @param threads The number which to initialize the semaphore with.
+ * @param argc The number of arguments given to the program.
+ * @param argv An array of strings which are passed to the program.
+ * @return It never returns...
  */
-void initialize_sem_active_threads(int threads){
-	//Create semaphore for the list.
-
-	if(sem_init(&sem_active_threads, 0, threads) < 0){
-		perror("semaphore");
-
-		if(sem_destroy(&sem_list) < 0){
-			perror("Semaphore");
-		}
-
-		if(sem_destroy(&sem_err) < 0){
-			perror("Semaphore");
-		}
+int main(int argc, char **argv){
+	const char *error;
+	unsigned int search_errors;
 
-		list_kill(dirs_to_check);
-		exit(EXIT_FAILURE);
-	}
+	parse_arguments(argc, argv);
 
-	//Take the active thread count down
-	for(int i = 0 ; i < threads ; i++){
-		if(sem_wait(&sem_active_threads) < 0){ //take semaphore
-			fprintf(stderr, "Could not take semaphore! Exiting to prevent " \
-					"further errors!");
-			clean_up_and_exit(EXIT_FAILURE);
-		}
+	search = mfind_search_new(&search_options, NULL, &error);
+	if(search == NULL){
+		fprintf(stderr, "%s!\n", error);
+		clean_up_and_exit(EXIT_FAILURE);
 	}
-}
-
-/**
- * initialize_sem_err_count() - Initialize the semaphore protecting the error
- * count to the value of 1. Because only one thread is allow to increment the
- * variable at a time.
- */
-void initialize_sem_err_count(void){
-	if(sem_init(&sem_err, 0, 1) < 0){
-		perror("semaphore");
 
-		if(sem_destroy(&sem_list) < 0){
-			perror("Semaphore");
-		}
+	initialize_outputs();
+	search_errors = mfind_search_run(search, print_match, NULL);
+	flush_outputs();
 
-		list_kill(dirs_to_check);
-		exit(EXIT_FAILURE);
+	if(search_options.stats){
+		report_stats();
 	}
-}
 
-/**
- * initialize_list() - Creates the list used for storing jobs
- * and initializes the semaphore needed for adding and removing from this list.
- */
-void initialize_list(void){
-	//Create list
-	dirs_to_check = list_new();
-	if(dirs_to_check == NULL){
-		exit(EXIT_FAILURE);
-	}
-
-	if(sem_init(&sem_list, 0, 1) < 0){
-		perror("semaphore");
-		list_kill(dirs_to_check);
-		exit(EXIT_FAILURE);
-	}
+	clean_up_and_exit(search_errors + atomic_load(&err_count));
 }
 
-
-
 /**
  * parse_arguments() - Checks the correct arguments are passed to the program
- * and saves these arguments in the right position.
+ * and saves these arguments in the options of the search.
  *
  * @param argc The number of arguments given to the program.
  * @param argv An array of strings which are passed to the program.
- * @returns The number of threads wanted by the user.
  */
-int parse_arguments(int argc, char **argv){
+void parse_arguments(int argc, char **argv){
 	int c;
 	char *end_pointer;
 	long int ret;
-	int num_threads = 1;
-
 
-	while ((c = getopt (argc, argv, "t:p:")) != -1){
+	//Names given with -n, files of names given with -f and expressions given
+	//with -regex, by their option. They are compiled after all options are
+	//read, since -i may come after them.
+	char *name_args[argc];
+	int name_arg_options[argc];
+	int num_name_args = 0;
+
+	//The arguments which are not options, the start directories and maybe the
+	//name. Those of the expression are taken out.
+	char **positional = calloc(argc, sizeof(*positional));
+	int num_positional = 0;
+	bool expr_has_name = false;
+	bool has_expr = false;
+	bool has_limits = false; //-maxdepth, -mindepth, -quit or -count
+
+	if(positional == NULL){
+		perror("calloc");
+		clean_up_and_exit(EXIT_FAILURE);
+	}
+	start_dirs = positional;
+
+	//Options longer than one letter, given with a single '-' like in find. The
+	//tests and operators of the expression all give 'e'.
+	static const struct option long_options[] = {
+		{"regex", required_argument, NULL, 'r'},
+		{"name", required_argument, NULL, 'e'},
+		{"type", required_argument, NULL, 'e'},
+		{"size", required_argument, NULL, 'e'},
+		{"mtime", required_argument, NULL, 'e'},
+		{"newer", required_argument, NULL, 'e'},
+		{"user", required_argument, NULL, 'e'},
+		{"group", required_argument, NULL, 'e'},
+		{"perm", required_argument, NULL, 'e'},
+		{"prune", no_argument, NULL, 'e'},
+		{"fresh", no_argument, NULL, 'F'},
+		{"order", required_argument, NULL, 'O'},
+		{"maxdepth", required_argument, NULL, 'X'},
+		{"mindepth", required_argument, NULL, 'Y'},
+		{"quit", no_argument, NULL, 'q'},
+		{"count", required_argument, NULL, 'C'},
+		{"grep", required_argument, NULL, 'g'},
+		{"grepmax", required_argument, NULL, 'G'},
+		{"stats", optional_argument, NULL, 'S'},
+		{"not", no_argument, NULL, 'e'},
+		{"and", no_argument, NULL, 'e'},
+		{"a", no_argument, NULL, 'e'},
+		{"or", no_argument, NULL, 'e'},
+		{"o", no_argument, NULL, 'e'},
+		{NULL, 0, NULL, 0}
+	};
+	int option_index;
+	const char *error;
+
+	mfind_options_init(&search_options);
+	search_options.expr = expr_new();
+
+	//The leading '-' keeps the arguments in order, which the expression needs,
+	//and gives those which are not options as 1. The ':' gives a missing
+	//argument as ':', with the errors printed here.
+	while ((c = getopt_long_only(argc, argv, "-:t:p:b:u:0in:f:d:D:c:L", long_options,
+			&option_index)) != -1){
 		switch (c){
 			case 't':
 				if(strcmp(optarg, "f") == 0){
@@ -365,6 +235,14 @@ int parse_arguments(int argc, char **argv){
 				}
 				break;
 			case 'p':
+				//The pool is sized while searching
+				if(strcmp(optarg, "auto") == 0){
+					search_options.auto_threads = true;
+					break;
+				}
+				search_options.auto_threads = false;
+
+				errno = 0;
 				ret = strtol(optarg, &end_pointer, 10);
 
 				//Check return value of strtol().
@@ -378,197 +256,576 @@ int parse_arguments(int argc, char **argv){
 					fprintf(stderr, "No digits were found\n");
 					clean_up_and_exit(EXIT_FAILURE);
 				}
+				else if (*end_pointer != '\0') {
+					fprintf(stderr, "Invalid number of threads, got: %s\n",
+							optarg);
+					clean_up_and_exit(EXIT_FAILURE);
+				}
 
 				//Check if the given strings fit in an int, else it's too big.
-				if((ret > INT_MAX) && (ret < 1)){
+				if((ret > INT_MAX) || (ret < 1)){
 					fprintf(stderr, "Number of threads exceeds int or is " \
 							"negative!\n");
 					clean_up_and_exit(EXIT_FAILURE);
 				}
 
 
-				num_threads = (int)ret;
+				search_options.threads = (int)ret;
 				//printf("Got threads %d\n", num_threads);
 
+				break;
+			case 'b':
+				search_options.dir_buffer_size = parse_buffer_size(optarg);
+				break;
+			case 'u':
+				search_options.uring_depth = parse_uring_depth(optarg);
+				break;
+			case '0':
+				output_terminator = '\0';
+				break;
+			case 'i':
+				ignore_case = true;
+				break;
+			case 'L':
+				search_options.follow_links = true;
+				break;
+			case 'n':
+			case 'f':
+			case 'r':
+				name_args[num_name_args] = optarg;
+				name_arg_options[num_name_args] = c;
+				num_name_args++;
+				break;
+			case 'e':
+				error = expr_add(search_options.expr, long_options[option_index].name,
+						optarg);
+				if(error != NULL){
+					fprintf(stderr, "Invalid -%s %s: %s\n",
+							long_options[option_index].name, optarg, error);
+					clean_up_and_exit(EXIT_FAILURE);
+				}
+				if(strcmp(long_options[option_index].name, "name") == 0){
+					expr_has_name = true;
+				}
+				has_expr = true;
+				break;
+			case 'd':
+				path_index_close(search_options.index);
+				search_options.index = path_index_open(optarg, &error);
+				if(search_options.index == NULL){
+					fprintf(stderr, "Invalid index %s: %s\n", optarg, error);
+					clean_up_and_exit(EXIT_FAILURE);
+				}
+				break;
+			case 'D':
+				search_options.index_to_write = optarg;
+				break;
+			case 'F':
+				search_options.index_fresh = true;
+				break;
+			case 'O':
+				search_options.order = parse_dir_order(optarg);
+				break;
+			case 'X':
+				search_options.max_depth = parse_depth("maxdepth", optarg);
+				has_limits = true;
+				break;
+			case 'Y':
+				search_options.min_depth = parse_depth("mindepth", optarg);
+				has_limits = true;
+				break;
+			case 'q':
+				search_options.max_matches = 1;
+				has_limits = true;
+				break;
+			case 'C':
+				search_options.max_matches = parse_count(optarg);
+				has_limits = true;
+				break;
+			case 'g':
+				if((*optarg == '\0') ||
+						(strlen(optarg) > CONTENT_SCAN_MAX_TEXT)){
+					fprintf(stderr, "Invalid -grep %s: The text must have 1 to "
+							"%d bytes\n", optarg, CONTENT_SCAN_MAX_TEXT);
+					clean_up_and_exit(EXIT_FAILURE);
+				}
+				search_options.grep = optarg;
+				has_expr = true;
+				break;
+			case 'G':
+				search_options.grep_max_size = parse_grep_max(optarg);
+				break;
+			case 'S':
+				search_options.stats = true;
+				stats_file = optarg;
+				break;
+			case 'c':
+				dir_cache_close(search_options.cache);
+				search_options.cache = dir_cache_open(optarg, &error);
+				if(search_options.cache == NULL){
+					fprintf(stderr, "Invalid cache %s: %s\n", optarg, error);
+					clean_up_and_exit(EXIT_FAILURE);
+				}
+				break;
+			case 1:
+				if((strcmp(optarg, "(") == 0) || (strcmp(optarg, ")") == 0) ||
+						(strcmp(optarg, "!") == 0)){
+					expr_add(search_options.expr, optarg, NULL);
+					has_expr = true;
+				}
+				else{
+					positional[num_positional++] = optarg;
+				}
+				break;
+			case ':':
+				//optopt is the value of a long option, not its name
+				fprintf(stderr, "Missing argument to '%s'.\n", argv[optind-1]);
+				clean_up_and_exit(EXIT_FAILURE);
 				break;
 			default:
-				fprintf (stderr, "Unknown option '-%c'.\n", optopt);
+				if(optopt != 0){
+					fprintf (stderr, "Unknown option '-%c'.\n", optopt);
+				}
+				else{
+					fprintf (stderr, "Unknown option '%s'.\n", argv[optind-1]);
+				}
 				clean_up_and_exit(EXIT_FAILURE);
 		}
 	}
 
-	//Get the filname which to search for.
-	search_for_name = argv[argc-1];
+	//Those after "--"
+	while(optind < argc){
+		positional[num_positional++] = argv[optind++];
+	}
 
-	//Get the start directories. Must be at least one.
-	if(optind == argc -1){
-		fprintf(stderr, "At least one start directory must be given!\n");
+	//An index is of whole trees
+	if((search_options.index_to_write != NULL) &&
+			((search_options.index != NULL) ||
+			(num_name_args > 0) || has_expr || has_limits)){
+		fprintf(stderr, "No names, tests, limits or -d may be given with "
+				"-D!\n");
+		clean_up_and_exit(EXIT_FAILURE);
+	}
+	//The files of an index are not read level by level
+	if((search_options.index != NULL) && ((search_options.min_depth > 0) ||
+			(search_options.max_depth != UINT_MAX))){
+		fprintf(stderr, "-maxdepth and -mindepth can not be used with -d!\n");
+		clean_up_and_exit(EXIT_FAILURE);
+	}
+	if(search_options.index_fresh && (search_options.index == NULL)){
+		fprintf(stderr, "-fresh needs an index given with -d!\n");
+		clean_up_and_exit(EXIT_FAILURE);
+	}
+	if(search_options.follow_links && ((search_options.index != NULL) ||
+			(search_options.index_to_write != NULL) ||
+			(search_options.cache != NULL))){
+		fprintf(stderr, "-L can not be used with -d, -D or -c!\n");
+		clean_up_and_exit(EXIT_FAILURE);
+	}
+
+	search_for_names = name_set_new(ignore_case);
+
+	//Get the filenames which to search for. Without -n, -f, -regex or -name it
+	//is the last argument.
+	if((num_name_args == 0) && !expr_has_name && (num_positional > 0) &&
+			(search_options.index_to_write == NULL)){
+		name_set_add(search_for_names, positional[--num_positional]);
+	}
+	for(int i = 0; i < num_name_args; i++){
+		if(name_arg_options[i] == 'f'){
+			read_names_file(name_args[i]);
+		}
+		else if(name_arg_options[i] == 'r'){
+			add_regex(name_args[i]);
+		}
+		else{
+			name_set_add(search_for_names, name_args[i]);
+		}
+	}
+
+	if((name_set_size(search_for_names) == 0) && !expr_has_name &&
+			(search_options.index_to_write == NULL)){
+		fprintf(stderr, "At least one name must be given!\n");
 		clean_up_and_exit(EXIT_FAILURE);
 	}
+
+	//The names are left out when only -name is used
+	name_set *names = NULL;
+	if(name_set_size(search_for_names) > 0){
+		name_set_compile(search_for_names);
+		names = search_for_names;
+	}
 	else{
-		for (int i = optind; i < argc-1; i++){
-			check_input_argument(argv[i]);
+		name_set_kill(search_for_names);
+	}
+	search_for_names = NULL;
+
+	error = expr_compile(search_options.expr, ignore_case, search_for_type, names);
+	if(error != NULL){
+		fprintf(stderr, "Invalid expression: %s\n", error);
+		clean_up_and_exit(EXIT_FAILURE);
+	}
+
+	//The index holds its own start directories
+	if(search_options.index != NULL){
+		if(num_positional > 0){
+			fprintf(stderr, "No start directory may be given with -d!\n");
+			clean_up_and_exit(EXIT_FAILURE);
 		}
+		return;
 	}
 
-	return num_threads;
+	//Get the start directories. Must be at least one.
+	if(num_positional == 0){
+		fprintf(stderr, "At least one start directory must be given!\n");
+		clean_up_and_exit(EXIT_FAILURE);
+	}
+
+	search_options.start_dirs = (const char *const *)start_dirs;
+	search_options.num_start_dirs = num_positional;
 }
 
 /**
- * check_input_argument() - Calls on the function which see if the program is
- * searching for the given file path. The path should be to a directory and
- * should be added to the list by check_file. However symbolic links will also
- * be added to the list by this function.
+ * read_names_file() - Adds the names in a file to the names searched for, one
+ * name per line. Empty lines are skipped.
  *
- * @param arg Path to a directory or symbolic link.
+ * @param file_name The path of the file, or "-" for stdin.
  */
-void check_input_argument(char *arg){
-	check_file(arg);
+void read_names_file(const char *file_name){
+	FILE *file = stdin;
+	if(strcmp(file_name, "-") != 0){
+		file = fopen(file_name, "r");
+		if(file == NULL){
+			perror(file_name);
+			clean_up_and_exit(EXIT_FAILURE);
+		}
+	}
+
+	char *line = NULL;
+	size_t line_size = 0;
+	ssize_t len;
+	while((len = getline(&line, &line_size, file)) != -1){
+		if((len > 0) && (line[len-1] == '\n')){
+			line[--len] = '\0';
+		}
+		if(len > 0){
+			name_set_add(search_for_names, line);
+		}
+	}
 
-	/* Normal directories are added by check_file */
-	add_argument_to_list_if_sym_link(arg);
+	if(ferror(file)){
+		perror(file_name);
+		clean_up_and_exit(EXIT_FAILURE);
+	}
+
+	free(line);
+	if(file != stdin){
+		fclose(file);
+	}
 }
 
 /**
- * add_argument_to_list_if_sym_link() - If the given filpath goes to a symbolic
- * link, this symbolic link will be added to the list of directories to examine.
+ * add_regex() - Compiles a regular expression into a DFA and adds it to the
+ * names searched for. The whole name of a file must match it.
  *
- * @param arg The path to a file which should be added to the list if it is a
- * symbolic link.
+ * @param pattern The expression, see regex_dfa.h.
  */
-void add_argument_to_list_if_sym_link(char *arg){
-	struct stat file_info;
+void add_regex(const char *pattern){
+	const char *error;
+	regex_dfa *re = regex_dfa_new(pattern, ignore_case, &error);
 
-	if (lstat(arg, &file_info) < 0) {
-		perror(arg);
-		return;
+	if(re == NULL){
+		fprintf(stderr, "Invalid regex '%s': %s\n", pattern, error);
+		clean_up_and_exit(EXIT_FAILURE);
 	}
 
-	if(S_ISLNK(file_info.st_mode)){ //Check if symlink
-		add_dir_to_list(arg);
-	}
+	name_set_add_regex(search_for_names, re);
 }
 
 /**
- * clean_up_and_exit() - Destroys the semaphore and frees the list.
+ * parse_buffer_size() - Parses the size of the directory buffer given by the
+ * user. The size is in bytes and may end with 'k' or 'M'. A size of 0 selects
+ * readdir() instead of getdents64.
  *
- * @param exit_code An exit which to exit with.
+ * @param arg The size as given by the user.
+ * @returns The size in bytes.
  */
-void clean_up_and_exit(int exit_code){
-	//Semaphores
-	if(sem_destroy(&sem_list) < 0){
-		perror("Semaphore");
+size_t parse_buffer_size(char *arg){
+	char *end_pointer;
+	unsigned long long size;
+
+	errno = 0;
+	size = strtoull(arg, &end_pointer, 10);
+
+	if((errno != 0) || (end_pointer == arg) || (arg[0] == '-')){
+		fprintf(stderr, "Invalid buffer size, got: %s\n", arg);
+		clean_up_and_exit(EXIT_FAILURE);
 	}
 
-	if(sem_destroy(&sem_err) < 0){
-		perror("Semaphore");
+	if((*end_pointer == 'k') || (*end_pointer == 'K')){
+		size *= 1024;
+		end_pointer++;
+	}
+	else if(*end_pointer == 'M'){
+		size *= 1024 * 1024;
+		end_pointer++;
 	}
 
-	if(sem_destroy(&sem_active_threads) < 0){
-		perror("Semaphore");
+	//getdents64 takes the size as an unsigned int
+	if((*end_pointer != '\0') || (size > INT_MAX) ||
+			((size > 0) && (size < DIR_READER_MIN_BUFFER_SIZE))){
+		fprintf(stderr, "Invalid buffer size, got: %s. Must be 0 or at " \
+				"least %d bytes\n", arg, DIR_READER_MIN_BUFFER_SIZE);
+		clean_up_and_exit(EXIT_FAILURE);
 	}
 
-	//List
-	remove_leftover_dirs_from_list();
-	list_kill(dirs_to_check);
-	exit(exit_code);
+	return (size_t)size;
 }
 
 /**
- * inc_global_err_count() - Increases the global error count with one.
- * Is thread safe due to the use of a semaphore.
+ * parse_uring_depth() - Parses the number of directories each worker should
+ * keep in flight through io_uring. 0 turns the io_uring engine off.
+ *
+ * @param arg The depth as given by the user.
+ * @returns The depth.
  */
-void inc_global_err_count(void){
-	if(sem_wait(&sem_err) < 0){
-			fprintf(stderr, "Could not take semaphore!");
+unsigned parse_uring_depth(char *arg){
+	char *end_pointer;
+	long depth;
+
+	errno = 0;
+	depth = strtol(arg, &end_pointer, 10);
+
+	if((errno != 0) || (end_pointer == arg) || (*end_pointer != '\0') ||
+			(depth < 0) || (depth > MFIND_MAX_URING_DEPTH)){
+		fprintf(stderr, "Invalid io_uring depth, got: %s. Must be 0 to %d\n",
+				arg, MFIND_MAX_URING_DEPTH);
+		clean_up_and_exit(EXIT_FAILURE);
 	}
 
-	err_count++;
+	return (unsigned)depth;
+}
+
+/**
+ * parse_depth() - Parses the number of levels given to -maxdepth or
+ * -mindepth.
+ *
+ * @param option The name of the option, for the error message.
+ * @param arg The number of levels as given by the user.
+ * @returns The number of levels.
+ */
+unsigned int parse_depth(const char *option, char *arg){
+	char *end_pointer;
+	long depth;
+
+	errno = 0;
+	depth = strtol(arg, &end_pointer, 10);
 
-	if(sem_post(&sem_err) < 0){
-		fprintf(stderr, "Could not release semaphore! Could not update " \
-				"error count");
+	if((errno != 0) || (end_pointer == arg) || (*end_pointer != '\0') ||
+			(depth < 0) || (depth >= UINT_MAX)){
+		fprintf(stderr, "Invalid -%s, got: %s. Must be 0 or more\n", option,
+				arg);
+		clean_up_and_exit(EXIT_FAILURE);
 	}
+
+	return (unsigned int)depth;
 }
 
 /**
- * remove_leftover_dirs_from_list() - Frees the directories still in the list.
+ * parse_count() - Parses the number of matches given to -count.
+ *
+ * @param arg The number as given by the user.
+ * @returns The number of matches.
  */
-void remove_leftover_dirs_from_list(void){
-	list_pos first_pos = list_get_first_position(dirs_to_check);
-	list_pos current_pos = \
-	list_get_previous_position(list_get_last_position(dirs_to_check), \
-			dirs_to_check);
+unsigned long parse_count(char *arg){
+	char *end_pointer;
+	unsigned long count;
 
-	while(current_pos != first_pos){
-		char *dir = (char*)list_get_value(current_pos);
-		list_remove_element(current_pos, dirs_to_check);
-		free(dir);
+	errno = 0;
+	count = strtoul(arg, &end_pointer, 10);
 
-		current_pos = list_get_previous_position(current_pos, dirs_to_check);
+	if((errno != 0) || (end_pointer == arg) || (*end_pointer != '\0') ||
+			(count == 0) || (arg[0] == '-')){
+		fprintf(stderr, "Invalid -count, got: %s. Must be 1 or more\n", arg);
+		clean_up_and_exit(EXIT_FAILURE);
 	}
+
+	return count;
 }
 
 /**
- * add_dir_to_list() - Takes the list's semaphore and adds the given directory
- * to the list.
+ * parse_grep_max() - Parses the size of the largest file -grep reads, in
+ * bytes or with a suffix of k, M or G.
  *
- * @param dir A directory to add to the list.
+ * @param arg The size as given by the user.
+ * @returns The size, 0 for no limit.
  */
-void add_dir_to_list(char *dir){
-	if(sem_wait(&sem_list) < 0){ //Take semaphore
-		fprintf(stderr, "Could not take semaphore!");
+off_t parse_grep_max(char *arg){
+	char *end_pointer;
+	unsigned long long size;
+	unsigned long long unit = 1;
+
+	errno = 0;
+	size = strtoull(arg, &end_pointer, 10);
+
+	if((errno != 0) || (end_pointer == arg) || (arg[0] == '-')){
+		fprintf(stderr, "Invalid -grepmax, got: %s\n", arg);
+		clean_up_and_exit(EXIT_FAILURE);
 	}
 
-	char *dir_string = (char*) malloc(strlen(dir) + 1);
-	strcpy(dir_string,dir);
+	if((*end_pointer == 'k') || (*end_pointer == 'K')){
+		unit = 1024;
+		end_pointer++;
+	}
+	else if(*end_pointer == 'M'){
+		unit = 1024 * 1024;
+		end_pointer++;
+	}
+	else if(*end_pointer == 'G'){
+		unit = 1024 * 1024 * 1024;
+		end_pointer++;
+	}
 
-	if(dir_string == NULL){
-		perror("malloc");
+	if((*end_pointer != '\0') || (size > INT64_MAX / unit)){
+		fprintf(stderr, "Invalid -grepmax, got: %s\n", arg);
+		clean_up_and_exit(EXIT_FAILURE);
 	}
-	else{
-		list_append(dir_string, dirs_to_check);
+
+	return (off_t)(size * unit);
+}
+
+/**
+ * parse_dir_order() - Parses the order the directories are searched in.
+ *
+ * @param arg The order as given by the user, "dfs", "bfs" or "inode".
+ * @returns The order.
+ */
+enum mfind_order parse_dir_order(const char *arg){
+	if(strcmp(arg, "dfs") == 0){
+		return MFIND_ORDER_DFS;
+	}
+	if(strcmp(arg, "bfs") == 0){
+		return MFIND_ORDER_BFS;
+	}
+	if(strcmp(arg, "inode") == 0){
+		return MFIND_ORDER_INODE;
 	}
 
-	if(sem_post(&sem_list) < 0){ //Release semaphore
-		fprintf(stderr, "Could not release semaphore! Exiting to prevent " \
-				"dead-lock!");
+	fprintf(stderr, "Invalid order, got: %s. Must be dfs, bfs or inode\n",
+			arg);
+	clean_up_and_exit(EXIT_FAILURE);
+	return MFIND_ORDER_DFS;
+}
+
+/**
+ * initialize_outputs() - Creates the output buffer of each thread of the
+ * search.
+ */
+void initialize_outputs(void){
+	num_outputs = mfind_search_threads(search);
+	outputs = calloc(num_outputs, sizeof(*outputs));
+	if(outputs == NULL){
+		perror("calloc");
 		clean_up_and_exit(EXIT_FAILURE);
 	}
+
+	for(int i = 0; i < num_outputs; i++){
+		outputs[i] = out_buffer_new(STDOUT_FILENO, OUT_BUFFER_DEFAULT_SIZE,
+				output_terminator);
+	}
 }
 
 /**
- * get_dir_from_list() - Takes the list's semaphore and gets the latest
- * directory from the list.
+ * print_match() - Adds the path of a found file to the output buffer of the
+ * thread which found it. The buffer is written to stdout when it is full,
+ * with whole paths only, so the output of the threads is never mixed within
+ * a path.
  *
- * @returns A directory or NULL if the list is empty.
+ * @param m The file found.
+ * @param arg Not used.
+ * @returns true, the search is never stopped from here.
  */
-char *get_dir_from_list(void){
-	char *dir = NULL;
+bool print_match(const mfind_match *m, void *arg){
+	(void)arg;
 
-	if(sem_wait(&sem_list) < 0){
-		fprintf(stderr, "Could not take semaphore!");
+	if(out_buffer_add(outputs[m->thread], m->dir_path, m->name) < 0){
+		perror("write");
+		inc_global_err_count();
 	}
 
-	if(list_is_empty(dirs_to_check)){
-		dir = NULL;
+	return true;
+}
+
+/**
+ * flush_outputs() - Writes everything left in the output buffers to stdout.
+ */
+void flush_outputs(void){
+	for(int i = 0; i < num_outputs; i++){
+		if(out_buffer_flush(outputs[i]) < 0){
+			perror("write");
+			inc_global_err_count();
+		}
 	}
-	else{
-		list_pos first_item_pos = \
-				list_get_next_position(list_get_first_position(dirs_to_check), \
-						dirs_to_check);
+}
 
-		dir = (char *)list_get_value(first_item_pos);
+/**
+ * report_stats() - Reports the statistics of the search, as a table on
+ * stderr or as JSON in the file given with -stats=FILE.
+ */
+void report_stats(void){
+	FILE *out;
 
-		list_remove_element(first_item_pos, dirs_to_check);
+	if(stats_file == NULL){
+		mfind_search_print_stats(search, stderr, false);
+		return;
 	}
 
-	if(sem_post(&sem_list) < 0){
-		fprintf(stderr, "Could not release semaphore! Exiting to prevent " \
-				"dead-lock!");
-		clean_up_and_exit(EXIT_FAILURE);
+	out = fopen(stats_file, "w");
+	if(out == NULL){
+		perror(stats_file);
+		inc_global_err_count();
+		return;
+	}
+	mfind_search_print_stats(search, out, true);
+	if(fclose(out) != 0){
+		perror(stats_file);
+		inc_global_err_count();
 	}
+}
 
-	return dir;
+/**
+ * clean_up_and_exit() - Removes the search, or what the options hold if it
+ * was never created, and the output buffers.
+ *
+ * @param exit_code An exit which to exit with.
+ */
+void clean_up_and_exit(int exit_code){
+	if(search != NULL){
+		mfind_search_kill(search);
+	}
+	else{
+		if(search_options.expr != NULL){
+			expr_kill(search_options.expr);
+		}
+		path_index_close(search_options.index);
+		dir_cache_close(search_options.cache);
+	}
+
+	if(search_for_names != NULL){
+		name_set_kill(search_for_names);
+	}
+	for(int i = 0; i < num_outputs; i++){
+		out_buffer_kill(outputs[i]);
+	}
+	free(outputs);
+	free(start_dirs);
+	exit(exit_code);
 }
 
+/**
+ * inc_global_err_count() - Increases the global error count with one.
+ * Is thread safe since the count is atomic.
+ */
+void inc_global_err_count(void){
+	atomic_fetch_add(&err_count, 1);
+}
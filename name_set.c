@@ -0,0 +1,446 @@
+#include "name_set.h"
+#include "matcher.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A set of file name patterns which a name is matched against in one pass,
+ * matching if any of the patterns match. Patterns without wildcards are kept
+ * in a hash table keyed on the length and first bytes of the name, so they
+ * cost one lookup however many there are. Every other pattern is compiled
+ * into a matcher, and the longest literal part of each is put in one
+ * Aho-Corasick automaton. A single scan of the name with the automaton finds
+ * which of them could match, and only those are run. Patterns without any
+ * literal part are always run. Regular expressions may be added as well, and
+ * are run last. Once compiled the set is only read, so any number of threads
+ * may match against it at once.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// No pattern, state or link.
+#define NONE (-1)
+
+// The name set type.
+struct name_set{
+	bool ignore_case;
+	matcher **patterns;
+	size_t num_patterns;
+	size_t max_patterns;
+	regex_dfa **regexes;
+	size_t num_regexes;
+	size_t max_regexes;
+
+	//Hash table of the patterns without wildcards, holding their index + 1
+	size_t *table;
+	size_t table_mask;
+
+	//Patterns with wildcards but without a literal part
+	size_t *always;
+	size_t num_always;
+
+	//The automaton over the literal parts of the other patterns. The bytes
+	//are first mapped to classes, class 0 being all the bytes found in no
+	//literal part, so a state only needs one transition per class.
+	unsigned char byte_class[256];
+	size_t num_classes;
+	size_t num_states;
+	int *next; //num_states * num_classes transitions
+	int *out; //The first pattern whose literal part ends in the state
+	int *dict; //The nearest state on the fail path with an output
+	int *out_next; //Per pattern, the next one ending in the same state
+};
+
+/**
+ * xcalloc() - calloc() which exits the program on failure.
+ * @n: The number of members.
+ * @size: The size of each member.
+ * Returns: A pointer to the zeroed memory.
+ */
+static void *xcalloc(size_t n, size_t size){
+	void *p = calloc((n > 0) ? n : 1, size);
+	if(p == NULL){
+		perror("name_set.c");
+		exit(errno);
+	}
+
+	return p;
+}
+
+/**
+ * literal_hash() - Hashes a name on its length and its first and last eight
+ * bytes, which is cheap and tells apart nearly all file names.
+ * @name: The name.
+ * @len: The length of the name.
+ * Returns: The hash.
+ */
+static uint64_t literal_hash(const char *name, size_t len){
+	uint64_t head = 0;
+	uint64_t tail = 0;
+	size_t n = (len < 8) ? len : 8;
+
+	memcpy(&head, name, n);
+	memcpy(&tail, name + len - n, n);
+
+	//Mixed so that every input bit reaches the low bits used as the slot
+	uint64_t h = (head ^ (len * 0x9e3779b97f4a7c15ULL)) * 0xff51afd7ed558ccdULL;
+	h ^= tail ^ (h >> 33);
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+
+	return h ^ (h >> 33);
+}
+
+/**
+ * name_set_new() - Create a new and empty set.
+ * @ignore_case: If true, letters match regardless of their case.
+ * Returns: A pointer to the new set.
+ */
+name_set *name_set_new(bool ignore_case){
+	name_set *s = xcalloc(1, sizeof(*s));
+
+	s->ignore_case = ignore_case;
+
+	return s;
+}
+
+/**
+ * name_set_add() - Adds a pattern to the set. Must be called before
+ * name_set_compile().
+ * @s: The set.
+ * @pattern: The pattern, see matcher.h. It is copied.
+ */
+void name_set_add(name_set *s, const char *pattern){
+	if(s->num_patterns == s->max_patterns){
+		size_t max = (s->max_patterns > 0) ? s->max_patterns * 2 : 8;
+		matcher **bigger = realloc(s->patterns, max * sizeof(*bigger));
+		if(bigger == NULL){
+			perror("name_set.c");
+			exit(errno);
+		}
+		s->patterns = bigger;
+		s->max_patterns = max;
+	}
+
+	s->patterns[s->num_patterns++] = matcher_new(pattern, s->ignore_case);
+}
+
+/**
+ * name_set_add_regex() - Adds a compiled regular expression to the set. Must
+ * be called before name_set_compile().
+ * @s: The set.
+ * @re: The regex, which the set takes over.
+ */
+void name_set_add_regex(name_set *s, regex_dfa *re){
+	if(s->num_regexes == s->max_regexes){
+		size_t max = (s->max_regexes > 0) ? s->max_regexes * 2 : 4;
+		regex_dfa **bigger = realloc(s->regexes, max * sizeof(*bigger));
+		if(bigger == NULL){
+			perror("name_set.c");
+			exit(errno);
+		}
+		s->regexes = bigger;
+		s->max_regexes = max;
+	}
+
+	s->regexes[s->num_regexes++] = re;
+}
+
+/**
+ * compile_table() - Puts the patterns without wildcards in the hash table,
+ * which has at least twice as many slots as patterns.
+ * @s: The set.
+ */
+static void compile_table(name_set *s){
+	size_t size = 16;
+	while(size < s->num_patterns * 2){
+		size *= 2;
+	}
+
+	s->table = xcalloc(size, sizeof(*s->table));
+	s->table_mask = size - 1;
+
+	for(size_t i = 0; i < s->num_patterns; i++){
+		size_t len;
+		const char *text = matcher_literal(s->patterns[i], &len);
+		if(text == NULL){
+			continue;
+		}
+
+		size_t slot = literal_hash(text, len) & s->table_mask;
+		while(s->table[slot] != 0){
+			slot = (slot + 1) & s->table_mask;
+		}
+		s->table[slot] = i + 1;
+	}
+}
+
+/**
+ * compile_automaton() - Builds the Aho-Corasick automaton over the literal
+ * parts of the patterns with wildcards. The trie is built first, and then
+ * every missing transition is filled in, in breadth first order, with the
+ * transition of the state's fail state.
+ * @s: The set.
+ */
+static void compile_automaton(name_set *s){
+	size_t max_states = 1;
+
+	s->always = xcalloc(s->num_patterns, sizeof(*s->always));
+	s->out_next = xcalloc(s->num_patterns, sizeof(*s->out_next));
+
+	//Give every byte used in a literal part its own class
+	s->num_classes = 1;
+	for(size_t i = 0; i < s->num_patterns; i++){
+		size_t len;
+		if(matcher_literal(s->patterns[i], &len) != NULL){
+			continue;
+		}
+
+		const char *core = matcher_core(s->patterns[i], &len);
+		if(len == 0){
+			s->always[s->num_always++] = i;
+			continue;
+		}
+
+		max_states += len;
+		for(size_t j = 0; j < len; j++){
+			unsigned char c = (unsigned char)core[j];
+			if(s->byte_class[c] == 0){
+				s->byte_class[c] = (unsigned char)s->num_classes++;
+			}
+		}
+	}
+
+	if(max_states == 1){
+		return;
+	}
+
+	s->next = xcalloc(max_states * s->num_classes, sizeof(*s->next));
+	s->out = xcalloc(max_states, sizeof(*s->out));
+	s->dict = xcalloc(max_states, sizeof(*s->dict));
+	int *fail = xcalloc(max_states, sizeof(*fail));
+	int *queue = xcalloc(max_states, sizeof(*queue));
+
+	for(size_t i = 0; i < max_states * s->num_classes; i++){
+		s->next[i] = NONE;
+	}
+	for(size_t i = 0; i < max_states; i++){
+		s->out[i] = NONE;
+		s->dict[i] = NONE;
+	}
+	s->num_states = 1;
+
+	//The trie
+	for(size_t i = 0; i < s->num_patterns; i++){
+		size_t len;
+		if(matcher_literal(s->patterns[i], &len) != NULL){
+			continue;
+		}
+
+		const char *core = matcher_core(s->patterns[i], &len);
+		if(len == 0){
+			continue;
+		}
+
+		int state = 0;
+		for(size_t j = 0; j < len; j++){
+			int *t = &s->next[state * s->num_classes +
+					s->byte_class[(unsigned char)core[j]]];
+			if(*t == NONE){
+				*t = (int)s->num_states++;
+			}
+			state = *t;
+		}
+		s->out_next[i] = s->out[state];
+		s->out[state] = (int)i;
+	}
+
+	//The fail links, breadth first from the root
+	size_t head = 0;
+	size_t tail = 0;
+	for(size_t c = 0; c < s->num_classes; c++){
+		int *t = &s->next[c];
+		if(*t == NONE){
+			*t = 0;
+		}
+		else{
+			fail[*t] = 0;
+			queue[tail++] = *t;
+		}
+	}
+
+	while(head < tail){
+		int state = queue[head++];
+
+		for(size_t c = 0; c < s->num_classes; c++){
+			int *t = &s->next[state * s->num_classes + c];
+			int fail_next = s->next[fail[state] * s->num_classes + c];
+
+			if(*t == NONE){
+				*t = fail_next;
+				continue;
+			}
+
+			fail[*t] = fail_next;
+			s->dict[*t] = (s->out[fail_next] != NONE) ? fail_next :
+					s->dict[fail_next];
+			queue[tail++] = *t;
+		}
+	}
+
+	free(fail);
+	free(queue);
+}
+
+/**
+ * name_set_compile() - Builds the hash table and the automaton. No pattern
+ * may be added afterwards.
+ * @s: The set.
+ */
+void name_set_compile(name_set *s){
+	compile_table(s);
+	compile_automaton(s);
+}
+
+/**
+ * name_set_size() - Gives the number of patterns in the set.
+ * @s: The set.
+ * Returns: The number of patterns, regular expressions included.
+ */
+size_t name_set_size(const name_set *s){
+	return s->num_patterns + s->num_regexes;
+}
+
+/**
+ * match_literals() - Looks the name up in the hash table.
+ * @s: The set.
+ * @name: The name, folded to lower case with ignore_case.
+ * @len: The length of the name.
+ * Returns: true if a pattern without wildcards equals the name.
+ */
+static bool match_literals(const name_set *s, const char *name, size_t len){
+	size_t slot = literal_hash(name, len) & s->table_mask;
+
+	while(s->table[slot] != 0){
+		size_t text_len;
+		const char *text = matcher_literal(s->patterns[s->table[slot] - 1],
+				&text_len);
+
+		if((text_len == len) && (memcmp(text, name, len) == 0)){
+			return true;
+		}
+		slot = (slot + 1) & s->table_mask;
+	}
+
+	return false;
+}
+
+/**
+ * match_wildcards() - Scans the name with the automaton and runs the pattern
+ * of every literal part found, and the patterns without any.
+ * @s: The set.
+ * @name: The name.
+ * @folded: The name, folded to lower case with ignore_case.
+ * @len: The length of the name.
+ * Returns: true if a pattern with wildcards matches the name.
+ */
+static bool match_wildcards(const name_set *s, const char *name,
+		const char *folded, size_t len){
+	for(size_t i = 0; i < s->num_always; i++){
+		if(matcher_match(s->patterns[s->always[i]], name)){
+			return true;
+		}
+	}
+
+	if(s->next == NULL){
+		return false;
+	}
+
+	int state = 0;
+	for(size_t i = 0; i < len; i++){
+		state = s->next[state * s->num_classes +
+				s->byte_class[(unsigned char)folded[i]]];
+
+		int found = (s->out[state] != NONE) ? state : s->dict[state];
+		for(; found != NONE; found = s->dict[found]){
+			for(int p = s->out[found]; p != NONE; p = s->out_next[p]){
+				if(matcher_match(s->patterns[p], name)){
+					return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+/**
+ * name_set_match() - Checks if a name matches any pattern of the set.
+ * @s: The compiled set.
+ * @name: The name, without any directory.
+ * Returns: true if any pattern matches the whole name, else false.
+ */
+bool name_set_match(const name_set *s, const char *name){
+	if((s->num_patterns == 1) && (s->num_regexes == 0)){
+		return matcher_match(s->patterns[0], name);
+	}
+	if((s->num_patterns == 0) && (s->num_regexes == 1)){
+		return regex_dfa_match(s->regexes[0], name);
+	}
+
+	size_t len = strlen(name);
+
+	char folded_buf[NAME_MAX + 1];
+	char *folded = (char *)name;
+	if(s->ignore_case){
+		folded = (len < sizeof(folded_buf)) ? folded_buf : malloc(len + 1);
+		if(folded == NULL){
+			return false;
+		}
+		for(size_t i = 0; i < len; i++){
+			folded[i] = (char)tolower((unsigned char)name[i]);
+		}
+		folded[len] = '\0';
+	}
+
+	bool match = match_literals(s, folded, len) ||
+			match_wildcards(s, name, folded, len);
+	for(size_t i = 0; !match && (i < s->num_regexes); i++){
+		match = regex_dfa_match(s->regexes[i], name);
+	}
+
+	if((folded != name) && (folded != folded_buf)){
+		free(folded);
+	}
+
+	return match;
+}
+
+/**
+ * name_set_kill() - Removes the set.
+ * @s: The set which to remove.
+ */
+void name_set_kill(name_set *s){
+	for(size_t i = 0; i < s->num_patterns; i++){
+		matcher_kill(s->patterns[i]);
+	}
+	free(s->patterns);
+	for(size_t i = 0; i < s->num_regexes; i++){
+		regex_dfa_kill(s->regexes[i]);
+	}
+	free(s->regexes);
+	free(s->table);
+	free(s->always);
+	free(s->next);
+	free(s->out);
+	free(s->dict);
+	free(s->out_next);
+	free(s);
+}
@@ -0,0 +1,78 @@
+#ifndef __NAME_SET_H_
+#define __NAME_SET_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "regex_dfa.h"
+
+/*
+ * A set of file name patterns which a name is matched against in one pass,
+ * matching if any of the patterns match. Patterns without wildcards are kept
+ * in a hash table keyed on the length and first bytes of the name, so they
+ * cost one lookup however many there are. Every other pattern is compiled
+ * into a matcher, and the longest literal part of each is put in one
+ * Aho-Corasick automaton. A single scan of the name with the automaton finds
+ * which of them could match, and only those are run. Patterns without any
+ * literal part are always run. Regular expressions may be added as well, and
+ * are run last. Once compiled the set is only read, so any number of threads
+ * may match against it at once.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The name set type.
+typedef struct name_set name_set;
+
+/**
+ * name_set_new() - Create a new and empty set.
+ * @ignore_case: If true, letters match regardless of their case.
+ * Returns: A pointer to the new set.
+ */
+name_set *name_set_new(bool ignore_case);
+
+/**
+ * name_set_add() - Adds a pattern to the set. Must be called before
+ * name_set_compile().
+ * @s: The set.
+ * @pattern: The pattern, see matcher.h. It is copied.
+ */
+void name_set_add(name_set *s, const char *pattern);
+
+/**
+ * name_set_add_regex() - Adds a compiled regular expression to the set. Must
+ * be called before name_set_compile().
+ * @s: The set.
+ * @re: The regex, which the set takes over.
+ */
+void name_set_add_regex(name_set *s, regex_dfa *re);
+
+/**
+ * name_set_compile() - Builds the hash table and the automaton. No pattern
+ * may be added afterwards.
+ * @s: The set.
+ */
+void name_set_compile(name_set *s);
+
+/**
+ * name_set_size() - Gives the number of patterns in the set.
+ * @s: The set.
+ * Returns: The number of patterns, regular expressions included.
+ */
+size_t name_set_size(const name_set *s);
+
+/**
+ * name_set_match() - Checks if a name matches any pattern of the set.
+ * @s: The compiled set.
+ * @name: The name, without any directory.
+ * Returns: true if any pattern matches the whole name, else false.
+ */
+bool name_set_match(const name_set *s, const char *name);
+
+/**
+ * name_set_kill() - Removes the set.
+ * @s: The set which to remove.
+ */
+void name_set_kill(name_set *s);
+
+#endif //__NAME_SET_H_
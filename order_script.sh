@@ -0,0 +1,31 @@
+#!/bin/bash
+#order_script
+#Compares the orders of -order by the wall time and the most directories
+#queued at once, for the given start directory and name.
+#Usage: ./order_script.sh start_directory name
+
+if [[ $# -ne 2 ]]; then
+	sed -n '/^#Usage/s/^#//p' "$0" >&2
+	exit 1
+fi
+
+dir=$1
+name=$2
+
+stats=$(mktemp)
+
+for order in dfs bfs inode; do
+	for threads in 1 4; do
+		start=$(date +%s.%N)
+		./mfind -p $threads -order $order -stats="$stats" "$dir" "$name" \
+				> /dev/null 2>&1
+		end=$(date +%s.%N)
+		peak=$(grep -o '"peak_queue": [0-9]*' "$stats" | head -n 1 | \
+				awk '{print $2}')
+		awk -v o=$order -v p=$threads -v q="$peak" -v s=$start -v e=$end \
+				'BEGIN{printf "%-6s -p %d  peak queue %9s  wall %6.2fs\n", \
+				o, p, q, e - s}'
+	done
+done
+
+rm -f "$stats"
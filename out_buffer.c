@@ -0,0 +1,162 @@
+#include "out_buffer.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * A buffer for the output of one thread. Paths are added to the buffer
+ * without any lock, and each ends with a terminator, normally a newline. A
+ * full buffer is written out with a single write() of whole paths only. The
+ * writes of all buffers share one lock, which is only taken once per buffer
+ * written, so the paths of different threads are never mixed within a line
+ * even when write() writes less than it was asked to.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The buffer type.
+struct out_buffer{
+	int fd;
+	char terminator;
+	size_t size;
+	size_t used;
+	char *data;
+};
+
+// Taken around every write, by all the buffers.
+static pthread_mutex_t write_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * write_all() - Writes all the given bytes, taking the write lock so no other
+ * buffer writes in between.
+ * @fd: The file descriptor.
+ * @data: The bytes to write.
+ * @len: The number of bytes.
+ * Returns: 0 on success, -1 on failure with errno set.
+ */
+static int write_all(int fd, const char *data, size_t len){
+	int ret = 0;
+
+	pthread_mutex_lock(&write_lock);
+	while(len > 0){
+		ssize_t n = write(fd, data, len);
+		if(n < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			ret = -1;
+			break;
+		}
+		data += n;
+		len -= (size_t)n;
+	}
+	pthread_mutex_unlock(&write_lock);
+
+	return ret;
+}
+
+/**
+ * out_buffer_new() - Create a new and empty buffer.
+ * @fd: The file descriptor which the buffer is written to.
+ * @size: The size of the buffer.
+ * @terminator: The character written after every path, '\n' or '\0'.
+ * Returns: A pointer to the new buffer.
+ */
+out_buffer *out_buffer_new(int fd, size_t size, char terminator){
+	out_buffer *b = calloc(1, sizeof(*b));
+	if(b == NULL){
+		perror("out_buffer.c");
+		exit(errno);
+	}
+
+	b->data = malloc(size);
+	if(b->data == NULL){
+		perror("out_buffer.c");
+		exit(errno);
+	}
+
+	b->fd = fd;
+	b->size = size;
+	b->terminator = terminator;
+
+	return b;
+}
+
+/**
+ * out_buffer_add() - Adds a path to the buffer, written as dir_path, a slash
+ * and name. If the path does not fit the buffer is written out first.
+ * @b: The buffer.
+ * @dir_path: The path of the directory, or NULL if name is the whole path.
+ * @name: The name of the file in the directory.
+ * Returns: 0 on success, -1 on a write failure with errno set.
+ */
+int out_buffer_add(out_buffer *b, const char *dir_path, const char *name){
+	size_t dir_len = (dir_path != NULL) ? strlen(dir_path) : 0;
+	size_t name_len = strlen(name);
+	size_t len = dir_len + ((dir_path != NULL) ? 1 : 0) + name_len + 1;
+
+	if(b->used + len > b->size){
+		if(out_buffer_flush(b) < 0){
+			return -1;
+		}
+
+		if(len > b->size){ //Too long for any buffer, write it on its own
+			char *path = malloc(len);
+			if(path == NULL){
+				return -1;
+			}
+			if(dir_path != NULL){
+				memcpy(path, dir_path, dir_len);
+				path[dir_len] = '/';
+			}
+			memcpy(path + len - 1 - name_len, name, name_len);
+			path[len - 1] = b->terminator;
+
+			int ret = write_all(b->fd, path, len);
+			free(path);
+
+			return ret;
+		}
+	}
+
+	char *p = b->data + b->used;
+	if(dir_path != NULL){
+		memcpy(p, dir_path, dir_len);
+		p[dir_len] = '/';
+		p += dir_len + 1;
+	}
+	memcpy(p, name, name_len);
+	p[name_len] = b->terminator;
+	b->used += len;
+
+	return 0;
+}
+
+/**
+ * out_buffer_flush() - Writes out everything in the buffer.
+ * @b: The buffer.
+ * Returns: 0 on success, -1 on a write failure with errno set.
+ */
+int out_buffer_flush(out_buffer *b){
+	if(b->used == 0){
+		return 0;
+	}
+
+	int ret = write_all(b->fd, b->data, b->used);
+	b->used = 0;
+
+	return ret;
+}
+
+/**
+ * out_buffer_kill() - Removes the buffer. Anything not flushed is lost.
+ * @b: The buffer which to remove.
+ */
+void out_buffer_kill(out_buffer *b){
+	free(b->data);
+	free(b);
+}
@@ -0,0 +1,55 @@
+#ifndef __OUT_BUFFER_H_
+#define __OUT_BUFFER_H_
+
+#include <stddef.h>
+
+/*
+ * A buffer for the output of one thread. Paths are added to the buffer
+ * without any lock, and each ends with a terminator, normally a newline. A
+ * full buffer is written out with a single write() of whole paths only. The
+ * writes of all buffers share one lock, which is only taken once per buffer
+ * written, so the paths of different threads are never mixed within a line
+ * even when write() writes less than it was asked to.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The default size of a buffer.
+#define OUT_BUFFER_DEFAULT_SIZE (64 * 1024)
+
+// The buffer type.
+typedef struct out_buffer out_buffer;
+
+/**
+ * out_buffer_new() - Create a new and empty buffer.
+ * @fd: The file descriptor which the buffer is written to.
+ * @size: The size of the buffer.
+ * @terminator: The character written after every path, '\n' or '\0'.
+ * Returns: A pointer to the new buffer.
+ */
+out_buffer *out_buffer_new(int fd, size_t size, char terminator);
+
+/**
+ * out_buffer_add() - Adds a path to the buffer, written as dir_path, a slash
+ * and name. If the path does not fit the buffer is written out first.
+ * @b: The buffer.
+ * @dir_path: The path of the directory, or NULL if name is the whole path.
+ * @name: The name of the file in the directory.
+ * Returns: 0 on success, -1 on a write failure with errno set.
+ */
+int out_buffer_add(out_buffer *b, const char *dir_path, const char *name);
+
+/**
+ * out_buffer_flush() - Writes out everything in the buffer.
+ * @b: The buffer.
+ * Returns: 0 on success, -1 on a write failure with errno set.
+ */
+int out_buffer_flush(out_buffer *b);
+
+/**
+ * out_buffer_kill() - Removes the buffer. Anything not flushed is lost.
+ * @b: The buffer which to remove.
+ */
+void out_buffer_kill(out_buffer *b);
+
+#endif //__OUT_BUFFER_H_
@@ -0,0 +1,200 @@
+#include "path_arena.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * An arena for the path strings of queued directories. Each thread owns an
+ * arena and allocates from it without any lock, by bumping a pointer in a
+ * large aligned chunk. A path may be freed by any thread. A chunk counts its
+ * live paths and, when the last one is freed, is handed back in one piece to
+ * the arena which allocated it, to be reused. No memory is given back to the
+ * system before the arena is removed.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The size and alignment of a chunk. Must be a power of two.
+#define CHUNK_SIZE (64 * 1024)
+
+// The alignment of each path.
+#define PATH_ALIGN 8
+
+// The header at the start of every chunk.
+struct chunk{
+	atomic_long live; //Live paths, plus one while it is the current chunk.
+	path_arena *owner;
+	struct chunk *next; //Next chunk waiting to be reused.
+	bool large; //Holds a single path too large for a normal chunk.
+};
+
+// The size of the header, rounded up to the path alignment.
+#define HEADER_SIZE ((sizeof(struct chunk) + PATH_ALIGN - 1) & \
+		~(size_t)(PATH_ALIGN - 1))
+
+// The arena type.
+struct path_arena{
+	struct chunk *current;
+	size_t used; //Bytes used in the current chunk, header included.
+	struct chunk *free_chunks; //Only touched by the owner.
+	_Atomic(struct chunk *) recycled; //Pushed to by any thread.
+};
+
+/**
+ * chunk_new() - Allocates a new chunk aligned to CHUNK_SIZE.
+ * @a: The arena which owns the chunk.
+ * @size: The size of the chunk, a multiple of CHUNK_SIZE.
+ * Returns: A pointer to the new chunk.
+ */
+static struct chunk *chunk_new(path_arena *a, size_t size){
+	struct chunk *c = aligned_alloc(CHUNK_SIZE, size);
+	if(c == NULL){
+		perror("path_arena.c");
+		exit(errno);
+	}
+
+	c->owner = a;
+	c->next = NULL;
+	c->large = (size > CHUNK_SIZE);
+
+	return c;
+}
+
+/**
+ * chunk_release() - Drops one reference to a chunk. When it was the last one,
+ * the chunk is freed if it is large or handed back to its owner otherwise.
+ * @c: The chunk.
+ */
+static void chunk_release(struct chunk *c){
+	if(atomic_fetch_sub_explicit(&c->live, 1, memory_order_acq_rel) != 1){
+		return;
+	}
+
+	if(c->large){
+		free(c);
+		return;
+	}
+
+	path_arena *a = c->owner;
+	struct chunk *head = atomic_load_explicit(&a->recycled,
+			memory_order_relaxed);
+	do{
+		c->next = head;
+	}while(!atomic_compare_exchange_weak_explicit(&a->recycled, &head, c,
+			memory_order_release, memory_order_relaxed));
+}
+
+/**
+ * next_chunk() - Gives the arena a new current chunk, reusing a chunk whose
+ * paths have all been freed when there is one.
+ * @a: The arena.
+ */
+static void next_chunk(path_arena *a){
+	if(a->current != NULL){
+		chunk_release(a->current);
+	}
+
+	if(a->free_chunks == NULL){
+		//Take all the chunks freed by other threads at once
+		a->free_chunks = atomic_exchange_explicit(&a->recycled, NULL,
+				memory_order_acquire);
+	}
+
+	struct chunk *c = a->free_chunks;
+	if(c != NULL){
+		a->free_chunks = c->next;
+	}
+	else{
+		c = chunk_new(a, CHUNK_SIZE);
+	}
+
+	atomic_store_explicit(&c->live, 1, memory_order_relaxed);
+	a->current = c;
+	a->used = HEADER_SIZE;
+}
+
+/**
+ * path_arena_new() - Create a new and empty arena.
+ * Returns: A pointer to the new arena.
+ */
+path_arena *path_arena_new(void){
+	path_arena *a = calloc(1, sizeof(*a));
+	if(a == NULL){
+		perror("path_arena.c");
+		exit(errno);
+	}
+
+	atomic_init(&a->recycled, NULL);
+
+	return a;
+}
+
+/**
+ * path_arena_alloc() - Allocates memory for a path. May only be called by the
+ * owner of the arena. The memory is aligned to at least 8 bytes.
+ * @a: The arena which to allocate from.
+ * @size: The number of bytes needed, including the terminating null byte.
+ * Returns: A pointer to the memory.
+ */
+char *path_arena_alloc(path_arena *a, size_t size){
+	size = (size + PATH_ALIGN - 1) & ~(size_t)(PATH_ALIGN - 1);
+
+	if(size > CHUNK_SIZE - HEADER_SIZE){
+		//The path starts within the first CHUNK_SIZE bytes, so
+		//path_arena_free() still finds the header.
+		size_t total = (HEADER_SIZE + size + CHUNK_SIZE - 1) &
+				~(size_t)(CHUNK_SIZE - 1);
+		struct chunk *c = chunk_new(a, total);
+		atomic_store_explicit(&c->live, 1, memory_order_relaxed);
+
+		return (char *)c + HEADER_SIZE;
+	}
+
+	if((a->current == NULL) || (a->used + size > CHUNK_SIZE)){
+		next_chunk(a);
+	}
+
+	char *path = (char *)a->current + a->used;
+	a->used += size;
+	atomic_fetch_add_explicit(&a->current->live, 1, memory_order_relaxed);
+
+	return path;
+}
+
+/**
+ * path_arena_free() - Frees a path allocated from any arena. May be called by
+ * any thread, as long as the arena has not been removed.
+ * @path: The path to free.
+ */
+void path_arena_free(char *path){
+	chunk_release((struct chunk *)((uintptr_t)path &
+			~(uintptr_t)(CHUNK_SIZE - 1)));
+}
+
+/**
+ * free_chunk_list() - Frees all the chunks of a list.
+ * @c: The first chunk of the list.
+ */
+static void free_chunk_list(struct chunk *c){
+	while(c != NULL){
+		struct chunk *next = c->next;
+		free(c);
+		c = next;
+	}
+}
+
+/**
+ * path_arena_kill() - Removes the arena. All the paths allocated from it must
+ * have been freed.
+ * @a: The arena which to remove.
+ */
+void path_arena_kill(path_arena *a){
+	free(a->current);
+	free_chunk_list(a->free_chunks);
+	free_chunk_list(atomic_load(&a->recycled));
+	free(a);
+}
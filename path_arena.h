@@ -0,0 +1,49 @@
+#ifndef __PATH_ARENA_H_
+#define __PATH_ARENA_H_
+
+#include <stddef.h>
+
+/*
+ * An arena for the path strings of queued directories. Each thread owns an
+ * arena and allocates from it without any lock, by bumping a pointer in a
+ * large aligned chunk. A path may be freed by any thread. A chunk counts its
+ * live paths and, when the last one is freed, is handed back in one piece to
+ * the arena which allocated it, to be reused. No memory is given back to the
+ * system before the arena is removed.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The arena type.
+typedef struct path_arena path_arena;
+
+/**
+ * path_arena_new() - Create a new and empty arena.
+ * Returns: A pointer to the new arena.
+ */
+path_arena *path_arena_new(void);
+
+/**
+ * path_arena_alloc() - Allocates memory for a path. May only be called by the
+ * owner of the arena. The memory is aligned to at least 8 bytes.
+ * @a: The arena which to allocate from.
+ * @size: The number of bytes needed, including the terminating null byte.
+ * Returns: A pointer to the memory.
+ */
+char *path_arena_alloc(path_arena *a, size_t size);
+
+/**
+ * path_arena_free() - Frees a path allocated from any arena. May be called by
+ * any thread, as long as the arena has not been removed.
+ * @path: The path to free.
+ */
+void path_arena_free(char *path);
+
+/**
+ * path_arena_kill() - Removes the arena. All the paths allocated from it must
+ * have been freed.
+ * @a: The arena which to remove.
+ */
+void path_arena_kill(path_arena *a);
+
+#endif //__PATH_ARENA_H_
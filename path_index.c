@@ -0,0 +1,714 @@
+/* For statx() and mkstemp() */
+#define _GNU_SOURCE
+
+#include "path_index.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/*
+ * An index of the files in whole trees, written once by a search and then
+ * searched instead of the trees, like the database of locate. The index holds
+ * the path, type and modification time of every file, sorted so the files
+ * below a directory come right after it. The paths are front coded: each
+ * path only stores what differs from the one before it. The files are split
+ * into blocks which start with a whole path, so the blocks can be read by
+ * many threads at once, straight from the mapped file.
+ *
+ * Every directory has a number, in the order of the index, and every file
+ * holds the number of the directory it is in. The start directories are in
+ * no directory. Once opened the index is only read, so any number of threads
+ * may use it at once. struct statx needs _GNU_SOURCE.
+ *
+ * The file starts with a header, followed by the blocks and then a table
+ * with the offset of each block. A file in a block is stored as:
+ *   varint  bytes shared with the path before, 0 first in a block
+ *   varint  length of the rest of the path
+ *   bytes   the rest of the path
+ *   byte    type
+ *   varint  length of the name
+ *   varint  number of the directory holding it + 1, 0 if none
+ *   varint  seconds of the modification time, zigzag coded
+ *   varint  nanoseconds of the modification time
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The first bytes of an index, which change with the format.
+#define INDEX_MAGIC "MFINDIX1"
+
+// The number of files in a block.
+#define BLOCK_FILES 256
+
+// The size of each chunk of memory holding the files of a builder.
+#define CHUNK_SIZE (1024 * 1024)
+
+struct header{
+	char magic[8];
+	uint64_t num_files;
+	uint64_t num_dirs;
+	uint64_t num_blocks;
+	uint64_t table_offset;
+	uint64_t size;
+};
+
+struct block_info{
+	uint64_t offset;
+	uint64_t first_dir; //The number the first directory of the block gets
+};
+
+// A file collected by a builder.
+struct record{
+	int64_t sec;
+	uint32_t nsec;
+	uint32_t len;
+	char type;
+	char path[];
+};
+
+// The index builder type.
+struct index_builder{
+	char **chunks;
+	size_t num_chunks;
+	char *free_pos;
+	size_t free_left;
+	struct record **records;
+	size_t num_records;
+	size_t max_records;
+};
+
+// The index type.
+struct path_index{
+	const unsigned char *map;
+	size_t size;
+	const struct header *header;
+	const struct block_info *blocks;
+};
+
+/**
+ * xrealloc() - realloc() which exits the program on failure.
+ * @p: The memory to resize, or NULL.
+ * @size: The new size.
+ * Returns: A pointer to the memory.
+ */
+static void *xrealloc(void *p, size_t size){
+	p = realloc(p, size);
+	if(p == NULL){
+		perror("path_index.c");
+		exit(errno);
+	}
+
+	return p;
+}
+
+/**
+ * compare_paths() - Compares two paths byte by byte, but with '/' before
+ * every other byte, so the files below a directory sort right after it.
+ * @a: The first path.
+ * @a_len: The length of the first path.
+ * @b: The second path.
+ * @b_len: The length of the second path.
+ * Returns: Less than, equal to or more than 0 if a is before, the same as or
+ * after b.
+ */
+static int compare_paths(const char *a, size_t a_len, const char *b,
+		size_t b_len){
+	size_t len = (a_len < b_len) ? a_len : b_len;
+
+	for(size_t i = 0; i < len; i++){
+		if(a[i] != b[i]){
+			int ca = (a[i] == '/') ? 0 : (unsigned char)a[i];
+			int cb = (b[i] == '/') ? 0 : (unsigned char)b[i];
+			return ca - cb;
+		}
+	}
+
+	return (a_len > b_len) - (a_len < b_len);
+}
+
+/**
+ * compare_records() - qsort() compare function for pointers to records.
+ * @a: Pointer to the first pointer.
+ * @b: Pointer to the second pointer.
+ * Returns: See compare_paths().
+ */
+static int compare_records(const void *a, const void *b){
+	const struct record *ra = *(struct record * const *)a;
+	const struct record *rb = *(struct record * const *)b;
+
+	return compare_paths(ra->path, ra->len, rb->path, rb->len);
+}
+
+/**
+ * index_builder_new() - Create a new and empty builder.
+ * Returns: A pointer to the new builder.
+ */
+index_builder *index_builder_new(void){
+	index_builder *b = calloc(1, sizeof(*b));
+	if(b == NULL){
+		perror("path_index.c");
+		exit(errno);
+	}
+
+	return b;
+}
+
+/**
+ * index_builder_add() - Adds a file to the builder. May only be called by the
+ * thread owning the builder.
+ * @b: The builder.
+ * @dir_path: The path of the directory holding the file, or NULL if name is
+ * the path of a start directory.
+ * @name: The name of the file.
+ * @type: The type of the file, like in index_entry.
+ * @mtime: The modification time of the file.
+ */
+void index_builder_add(index_builder *b, const char *dir_path,
+		const char *name, char type, struct statx_timestamp mtime){
+	size_t dir_len = (dir_path != NULL) ? strlen(dir_path) + 1 : 0;
+	size_t name_len = strlen(name);
+	size_t size = sizeof(struct record) + dir_len + name_len + 1;
+
+	//Keep the records aligned
+	size = (size + 7) & ~(size_t)7;
+
+	if(size > b->free_left){
+		size_t chunk_size = (size > CHUNK_SIZE) ? size : CHUNK_SIZE;
+
+		b->chunks = xrealloc(b->chunks, (b->num_chunks + 1) *
+				sizeof(*b->chunks));
+		b->chunks[b->num_chunks] = xrealloc(NULL, chunk_size);
+		b->free_pos = b->chunks[b->num_chunks++];
+		b->free_left = chunk_size;
+	}
+
+	struct record *r = (struct record *)b->free_pos;
+	b->free_pos += size;
+	b->free_left -= size;
+
+	r->sec = mtime.tv_sec;
+	r->nsec = mtime.tv_nsec;
+	r->len = (uint32_t)(dir_len + name_len);
+	r->type = type;
+	if(dir_path != NULL){
+		memcpy(r->path, dir_path, dir_len - 1);
+		r->path[dir_len - 1] = '/';
+	}
+	memcpy(r->path + dir_len, name, name_len + 1);
+
+	if(b->num_records == b->max_records){
+		b->max_records = (b->max_records > 0) ? b->max_records * 2 : 1024;
+		b->records = xrealloc(b->records, b->max_records *
+				sizeof(*b->records));
+	}
+	b->records[b->num_records++] = r;
+}
+
+/**
+ * index_builder_kill() - Removes the builder.
+ * @b: The builder which to remove, or NULL.
+ */
+void index_builder_kill(index_builder *b){
+	if(b == NULL){
+		return;
+	}
+
+	for(size_t i = 0; i < b->num_chunks; i++){
+		free(b->chunks[i]);
+	}
+	free(b->chunks);
+	free(b->records);
+	free(b);
+}
+
+/**
+ * put_varint() - Writes a number with 7 bits per byte, the lowest first.
+ * @out: The file.
+ * @value: The number.
+ * Returns: The number of bytes written.
+ */
+static size_t put_varint(FILE *out, uint64_t value){
+	size_t n = 1;
+
+	while(value >= 0x80){
+		putc((int)(value & 0x7f) | 0x80, out);
+		value >>= 7;
+		n++;
+	}
+	putc((int)value, out);
+
+	return n;
+}
+
+/**
+ * is_below() - Checks if a path is below a directory.
+ * @dir: The directory.
+ * @r: The file.
+ * Returns: true if the path of the file starts with that of the directory
+ * followed by a '/'.
+ */
+static bool is_below(const struct record *dir, const struct record *r){
+	return (r->len > dir->len) && (r->path[dir->len] == '/') &&
+			(memcmp(r->path, dir->path, dir->len) == 0);
+}
+
+/**
+ * name_length() - Gives the length of the last part of a path.
+ * @r: The file.
+ * Returns: The number of bytes after the last '/'.
+ */
+static size_t name_length(const struct record *r){
+	const char *slash = memrchr(r->path, '/', r->len);
+
+	return (slash != NULL) ? r->len - (size_t)(slash + 1 - r->path) : r->len;
+}
+
+/**
+ * write_files() - Writes the sorted files in blocks and fills in the header
+ * and the table of blocks.
+ * @out: The file, placed after the header.
+ * @records: The sorted files.
+ * @num_records: The number of files.
+ * @h: The header.
+ * @blocks: Where to put the table, with room for every block.
+ * Returns: 0 on success, -1 on failure.
+ */
+static int write_files(FILE *out, struct record **records, size_t num_records,
+		struct header *h, struct block_info *blocks){
+	//The directories holding the file being written, outermost first
+	struct record **stack = xrealloc(NULL, sizeof(*stack));
+	size_t *stack_dirs = xrealloc(NULL, sizeof(*stack_dirs));
+	size_t stack_len = 0;
+	size_t max_stack = 1;
+	uint64_t offset = sizeof(*h);
+
+	for(size_t i = 0; i < num_records; i++){
+		struct record *r = records[i];
+		struct record *prev = ((i % BLOCK_FILES) != 0) ? records[i-1] : NULL;
+		size_t shared = 0;
+
+		if(prev == NULL){
+			blocks[h->num_blocks].offset = offset;
+			blocks[h->num_blocks].first_dir = h->num_dirs;
+			h->num_blocks++;
+		}
+		else{
+			size_t len = (prev->len < r->len) ? prev->len : r->len;
+			while((shared < len) && (prev->path[shared] == r->path[shared])){
+				shared++;
+			}
+		}
+
+		while((stack_len > 0) && !is_below(stack[stack_len - 1], r)){
+			stack_len--;
+		}
+		uint64_t parent = (stack_len > 0) ? stack_dirs[stack_len - 1] + 1 : 0;
+
+		if((r->type == 'd') || (parent == 0)){
+			if(stack_len == max_stack){
+				max_stack *= 2;
+				stack = xrealloc(stack, max_stack * sizeof(*stack));
+				stack_dirs = xrealloc(stack_dirs, max_stack *
+						sizeof(*stack_dirs));
+			}
+			stack[stack_len] = r;
+			stack_dirs[stack_len++] = h->num_dirs++;
+		}
+
+		offset += put_varint(out, shared);
+		offset += put_varint(out, r->len - shared);
+		offset += fwrite(r->path + shared, 1, r->len - shared, out);
+		offset += (putc(r->type, out) != EOF) ? 1 : 0;
+		offset += put_varint(out, name_length(r));
+		offset += put_varint(out, parent);
+		offset += put_varint(out, ((uint64_t)r->sec << 1) ^
+				(uint64_t)(r->sec >> 63));
+		offset += put_varint(out, r->nsec);
+	}
+
+	free(stack);
+	free(stack_dirs);
+	h->num_files = num_records;
+	h->table_offset = offset;
+
+	return ferror(out) ? -1 : 0;
+}
+
+/**
+ * path_index_write() - Sorts the files of all the builders and writes them
+ * as an index. The file is written under another name and renamed when done,
+ * so a search using the old index is never disturbed.
+ * @file: The path of the index.
+ * @builders: The builders.
+ * @num_builders: The number of builders.
+ * Returns: 0 on success, -1 on failure with errno set.
+ */
+int path_index_write(const char *file, index_builder **builders,
+		int num_builders){
+	size_t num_records = 0;
+
+	for(int i = 0; i < num_builders; i++){
+		num_records += builders[i]->num_records;
+	}
+
+	struct record **records = xrealloc(NULL, (num_records + 1) *
+			sizeof(*records));
+	num_records = 0;
+	for(int i = 0; i < num_builders; i++){
+		memcpy(&records[num_records], builders[i]->records,
+				builders[i]->num_records * sizeof(*records));
+		num_records += builders[i]->num_records;
+	}
+	qsort(records, num_records, sizeof(*records), compare_records);
+
+	size_t max_blocks = (num_records + BLOCK_FILES - 1) / BLOCK_FILES;
+	struct block_info *blocks = xrealloc(NULL, (max_blocks + 1) *
+			sizeof(*blocks));
+	struct header h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, INDEX_MAGIC, sizeof(h.magic));
+
+	char *tmp_name = xrealloc(NULL, strlen(file) + sizeof(".XXXXXX"));
+	sprintf(tmp_name, "%s.XXXXXX", file);
+
+	int fd = mkstemp(tmp_name);
+	FILE *out = (fd >= 0) ? fdopen(fd, "w") : NULL;
+	int ret = -1;
+	int saved_errno;
+
+	if(out == NULL){
+		saved_errno = errno;
+		if(fd >= 0){
+			close(fd);
+			unlink(tmp_name);
+		}
+		free(tmp_name);
+		free(blocks);
+		free(records);
+		errno = saved_errno;
+		return -1;
+	}
+
+	//mkstemp() gives 0600, an index is as readable as any file
+	mode_t mask = umask(0);
+	umask(mask);
+	fchmod(fd, 0666 & ~mask);
+
+	if((fwrite(&h, sizeof(h), 1, out) == 1) &&
+			(write_files(out, records, num_records, &h, blocks) == 0) &&
+			(fwrite(blocks, sizeof(*blocks), h.num_blocks, out) ==
+			h.num_blocks)){
+		h.size = h.table_offset + h.num_blocks * sizeof(*blocks);
+		if((fseek(out, 0, SEEK_SET) == 0) &&
+				(fwrite(&h, sizeof(h), 1, out) == 1) && (fflush(out) == 0)){
+			ret = 0;
+		}
+	}
+	saved_errno = errno;
+
+	if(fclose(out) != 0){
+		saved_errno = errno;
+		ret = -1;
+	}
+	if((ret == 0) && (rename(tmp_name, file) < 0)){
+		saved_errno = errno;
+		ret = -1;
+	}
+	if(ret < 0){
+		unlink(tmp_name);
+	}
+
+	free(tmp_name);
+	free(blocks);
+	free(records);
+	errno = saved_errno;
+
+	return ret;
+}
+
+/**
+ * path_index_open() - Opens an index by mapping it into memory.
+ * @file: The path of the index.
+ * @error: Where to put a description of the error.
+ * Returns: A pointer to the index, or NULL on an error.
+ */
+path_index *path_index_open(const char *file, const char **error){
+	struct stat info;
+	int fd = open(file, O_RDONLY | O_CLOEXEC);
+
+	if((fd < 0) || (fstat(fd, &info) < 0)){
+		*error = strerror(errno);
+		if(fd >= 0){
+			close(fd);
+		}
+		return NULL;
+	}
+
+	size_t size = (size_t)info.st_size;
+	if(size < sizeof(struct header)){
+		*error = "not an index";
+		close(fd);
+		return NULL;
+	}
+
+	void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED){
+		*error = strerror(errno);
+		return NULL;
+	}
+
+	const struct header *h = map;
+	if((memcmp(h->magic, INDEX_MAGIC, sizeof(h->magic)) != 0) ||
+			(h->size != size) || (h->table_offset > size) ||
+			(h->num_blocks != (size - h->table_offset) /
+			sizeof(struct block_info))){
+		*error = "not an index, or written by another version";
+		munmap(map, size);
+		return NULL;
+	}
+
+	path_index *ix = calloc(1, sizeof(*ix));
+	if(ix == NULL){
+		perror("path_index.c");
+		exit(errno);
+	}
+	ix->map = map;
+	ix->size = size;
+	ix->header = h;
+	ix->blocks = (const struct block_info *)(ix->map + h->table_offset);
+
+	return ix;
+}
+
+/**
+ * path_index_num_blocks() - Gives the number of blocks of the index.
+ * @ix: The index.
+ * Returns: The number of blocks.
+ */
+size_t path_index_num_blocks(const path_index *ix){
+	return ix->header->num_blocks;
+}
+
+/**
+ * path_index_num_dirs() - Gives the number of directories of the index.
+ * @ix: The index.
+ * Returns: The number of directories.
+ */
+size_t path_index_num_dirs(const path_index *ix){
+	return ix->header->num_dirs;
+}
+
+/**
+ * get_varint() - Reads a number written by put_varint().
+ * @pos: Where to read, moved past the number.
+ * @end: The end of the bytes which may be read.
+ * @value: Where to put the number.
+ * Returns: true on success, false if the number does not end before end.
+ */
+static bool get_varint(const unsigned char **pos, const unsigned char *end,
+		uint64_t *value){
+	const unsigned char *p = *pos;
+	uint64_t v = 0;
+
+	for(int shift = 0; (p < end) && (shift < 64); shift += 7){
+		v |= (uint64_t)(*p & 0x7f) << shift;
+		if((*p++ & 0x80) == 0){
+			*pos = p;
+			*value = v;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * index_cursor_start() - Places a cursor at the start of a block.
+ * @c: The cursor, zeroed before its first use.
+ * @ix: The index.
+ * @block: The number of the block.
+ */
+void index_cursor_start(index_cursor *c, const path_index *ix, size_t block){
+	uint64_t end = (block + 1 < ix->header->num_blocks) ?
+			ix->blocks[block + 1].offset : ix->header->table_offset;
+	uint64_t start = ix->blocks[block].offset;
+
+	if((start > end) || (end > ix->header->table_offset)){
+		start = end; //A broken index, read nothing
+	}
+
+	c->index = ix;
+	c->pos = ix->map + start;
+	c->end = ix->map + end;
+	c->next_dir = ix->blocks[block].first_dir;
+}
+
+/**
+ * index_cursor_next() - Reads the next file of the block.
+ * @c: The cursor.
+ * @entry: Where to put the file.
+ * Returns: true if a file was read, false at the end of the block.
+ */
+bool index_cursor_next(index_cursor *c, index_entry *entry){
+	uint64_t shared, rest, name_len, parent, sec, nsec;
+
+	if((c->pos >= c->end) || !get_varint(&c->pos, c->end, &shared) ||
+			!get_varint(&c->pos, c->end, &rest) ||
+			(rest > (size_t)(c->end - c->pos)) || (shared > SIZE_MAX / 2)){
+		c->pos = c->end;
+		return false;
+	}
+
+	size_t len = shared + rest;
+	if((c->path == NULL) || (c->path_size < len + 1)){
+		c->path_size = (len + 1 > 2 * c->path_size) ? len + 1 :
+				2 * c->path_size;
+		c->path = xrealloc(c->path, c->path_size);
+	}
+	memcpy(c->path + shared, c->pos, rest);
+	c->path[len] = '\0';
+	c->pos += rest;
+
+	if(c->pos >= c->end){
+		return false;
+	}
+	entry->type = (char)*c->pos++;
+
+	if(!get_varint(&c->pos, c->end, &name_len) ||
+			!get_varint(&c->pos, c->end, &parent) ||
+			!get_varint(&c->pos, c->end, &sec) ||
+			!get_varint(&c->pos, c->end, &nsec) || (name_len > len)){
+		c->pos = c->end;
+		return false;
+	}
+
+	entry->path = c->path;
+	entry->path_len = len;
+	entry->name = c->path + len - name_len;
+	entry->mtime.tv_sec = (int64_t)(sec >> 1) ^ -(int64_t)(sec & 1);
+	entry->mtime.tv_nsec = (uint32_t)nsec;
+	entry->parent = (parent > 0) ? (size_t)(parent - 1) : PATH_INDEX_NO_DIR;
+	entry->dir = PATH_INDEX_NO_DIR;
+	if((entry->type == 'd') || (entry->parent == PATH_INDEX_NO_DIR)){
+		entry->dir = c->next_dir++;
+	}
+
+	//A start directory is named like by basename(), which may modify it
+	if(entry->parent == PATH_INDEX_NO_DIR){
+		free(c->root_name);
+		c->root_name = strdup(c->path);
+		if(c->root_name == NULL){
+			perror("path_index.c");
+			exit(errno);
+		}
+		entry->name = basename(c->root_name);
+	}
+
+	return true;
+}
+
+/**
+ * index_cursor_free() - Frees the path buffer of a cursor.
+ * @c: The cursor.
+ */
+void index_cursor_free(index_cursor *c){
+	free(c->path);
+	free(c->root_name);
+	c->path = NULL;
+	c->path_size = 0;
+	c->root_name = NULL;
+}
+
+/**
+ * block_first_path() - Gives the first path of a block, which is whole.
+ * @ix: The index.
+ * @block: The number of the block.
+ * @len: Where to put the length of the path.
+ * Returns: The path, which is not null terminated, or NULL if it is broken.
+ */
+static const char *block_first_path(const path_index *ix, size_t block,
+		size_t *len){
+	const unsigned char *pos = ix->map + ix->blocks[block].offset;
+	const unsigned char *end = ix->map + ix->header->table_offset;
+	uint64_t shared, rest;
+
+	if((pos >= end) || !get_varint(&pos, end, &shared) ||
+			!get_varint(&pos, end, &rest) || (rest > (size_t)(end - pos))){
+		return NULL;
+	}
+	*len = rest;
+
+	return (const char *)pos;
+}
+
+/**
+ * path_index_has_dir() - Checks if a directory is in the index.
+ * @ix: The index.
+ * @dir_path: The path of the directory holding the directory.
+ * @name: The name of the directory.
+ * Returns: true if the path is in the index as a directory, else false.
+ */
+bool path_index_has_dir(const path_index *ix, const char *dir_path,
+		const char *name){
+	size_t dir_len = strlen(dir_path);
+	size_t len = dir_len + 1 + strlen(name);
+	char *key = xrealloc(NULL, len + 1);
+	bool found = false;
+
+	sprintf(key, "%s/%s", dir_path, name);
+
+	//The last block starting at or before the path
+	size_t low = 0;
+	size_t high = ix->header->num_blocks;
+	while(high - low > 1){
+		size_t mid = low + (high - low) / 2;
+		size_t first_len;
+		const char *first = block_first_path(ix, mid, &first_len);
+
+		if((first != NULL) &&
+				(compare_paths(first, first_len, key, len) <= 0)){
+			low = mid;
+		}
+		else{
+			high = mid;
+		}
+	}
+
+	if(ix->header->num_blocks > 0){
+		index_cursor c;
+		index_entry entry;
+		int cmp = -1;
+
+		memset(&c, 0, sizeof(c));
+		index_cursor_start(&c, ix, low);
+		while((cmp < 0) && index_cursor_next(&c, &entry)){
+			cmp = compare_paths(entry.path, entry.path_len, key, len);
+		}
+		found = (cmp == 0) && (entry.type == 'd');
+		index_cursor_free(&c);
+	}
+
+	free(key);
+
+	return found;
+}
+
+/**
+ * path_index_close() - Unmaps and removes the index.
+ * @ix: The index which to remove, or NULL.
+ */
+void path_index_close(path_index *ix){
+	if(ix == NULL){
+		return;
+	}
+
+	munmap((void *)ix->map, ix->size);
+	free(ix);
+}
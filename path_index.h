@@ -0,0 +1,154 @@
+#ifndef __PATH_INDEX_H_
+#define __PATH_INDEX_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+/*
+ * An index of the files in whole trees, written once by a search and then
+ * searched instead of the trees, like the database of locate. The index holds
+ * the path, type and modification time of every file, sorted so the files
+ * below a directory come right after it. The paths are front coded: each
+ * path only stores what differs from the one before it. The files are split
+ * into blocks which start with a whole path, so the blocks can be read by
+ * many threads at once, straight from the mapped file.
+ *
+ * Every directory has a number, in the order of the index, and every file
+ * holds the number of the directory it is in. The start directories are in
+ * no directory. Once opened the index is only read, so any number of threads
+ * may use it at once. struct statx needs _GNU_SOURCE.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The number of a file which is in no directory.
+#define PATH_INDEX_NO_DIR SIZE_MAX
+
+// The index builder type, which collects the files of one thread.
+typedef struct index_builder index_builder;
+
+// The index type.
+typedef struct path_index path_index;
+
+// A file of the index. The strings are only valid until the next file.
+typedef struct index_entry{
+	const char *path;
+	size_t path_len;
+	const char *name; //The last part of the path
+	char type; //'f' for file, 'd' for directory, 'l' for link, '?' else
+	struct statx_timestamp mtime;
+	size_t dir; //The number of the file if it is a directory, else NO_DIR
+	size_t parent; //The number of the directory holding the file
+}index_entry;
+
+// Where a thread is in a block of the index.
+typedef struct index_cursor{
+	const path_index *index;
+	const unsigned char *pos;
+	const unsigned char *end;
+	size_t next_dir;
+	char *path;
+	size_t path_size;
+	char *root_name; //The name of a start directory
+}index_cursor;
+
+/**
+ * index_builder_new() - Create a new and empty builder.
+ * Returns: A pointer to the new builder.
+ */
+index_builder *index_builder_new(void);
+
+/**
+ * index_builder_add() - Adds a file to the builder. May only be called by the
+ * thread owning the builder.
+ * @b: The builder.
+ * @dir_path: The path of the directory holding the file, or NULL if name is
+ * the path of a start directory.
+ * @name: The name of the file.
+ * @type: The type of the file, like in index_entry.
+ * @mtime: The modification time of the file.
+ */
+void index_builder_add(index_builder *b, const char *dir_path,
+		const char *name, char type, struct statx_timestamp mtime);
+
+/**
+ * index_builder_kill() - Removes the builder.
+ * @b: The builder which to remove, or NULL.
+ */
+void index_builder_kill(index_builder *b);
+
+/**
+ * path_index_write() - Sorts the files of all the builders and writes them
+ * as an index. The file is written under another name and renamed when done,
+ * so a search using the old index is never disturbed.
+ * @file: The path of the index.
+ * @builders: The builders.
+ * @num_builders: The number of builders.
+ * Returns: 0 on success, -1 on failure with errno set.
+ */
+int path_index_write(const char *file, index_builder **builders,
+		int num_builders);
+
+/**
+ * path_index_open() - Opens an index by mapping it into memory.
+ * @file: The path of the index.
+ * @error: Where to put a description of the error.
+ * Returns: A pointer to the index, or NULL on an error.
+ */
+path_index *path_index_open(const char *file, const char **error);
+
+/**
+ * path_index_num_blocks() - Gives the number of blocks of the index.
+ * @ix: The index.
+ * Returns: The number of blocks.
+ */
+size_t path_index_num_blocks(const path_index *ix);
+
+/**
+ * path_index_num_dirs() - Gives the number of directories of the index.
+ * @ix: The index.
+ * Returns: The number of directories.
+ */
+size_t path_index_num_dirs(const path_index *ix);
+
+/**
+ * path_index_has_dir() - Checks if a directory is in the index.
+ * @ix: The index.
+ * @dir_path: The path of the directory holding the directory.
+ * @name: The name of the directory.
+ * Returns: true if the path is in the index as a directory, else false.
+ */
+bool path_index_has_dir(const path_index *ix, const char *dir_path,
+		const char *name);
+
+/**
+ * path_index_close() - Unmaps and removes the index.
+ * @ix: The index which to remove, or NULL.
+ */
+void path_index_close(path_index *ix);
+
+/**
+ * index_cursor_start() - Places a cursor at the start of a block.
+ * @c: The cursor, zeroed before its first use.
+ * @ix: The index.
+ * @block: The number of the block.
+ */
+void index_cursor_start(index_cursor *c, const path_index *ix, size_t block);
+
+/**
+ * index_cursor_next() - Reads the next file of the block.
+ * @c: The cursor.
+ * @entry: Where to put the file.
+ * Returns: true if a file was read, false at the end of the block.
+ */
+bool index_cursor_next(index_cursor *c, index_entry *entry);
+
+/**
+ * index_cursor_free() - Frees the path buffer of a cursor.
+ * @c: The cursor.
+ */
+void index_cursor_free(index_cursor *c);
+
+#endif //__PATH_INDEX_H_
@@ -0,0 +1,1165 @@
+#include "regex_dfa.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A regular expression for file names, compiled once into a DFA so a name is
+ * matched in one pass over its bytes, without any backtracking. The syntax is
+ * that of POSIX extended regular expressions: '.', sets like "[a-z]" with
+ * "[:class:]" and '^' to negate, groups, '|', and the repeats '*', '+', '?'
+ * and "{m,n}". '\' takes the next character literally, and "\d", "\w" and "\s"
+ * are digits, word characters and white space. The expression must match the
+ * whole name, so a '^' at the start and a '$' at the end are allowed but not
+ * needed. Back references are not supported.
+ *
+ * The DFA is built with the Glushkov construction, which gives one NFA state
+ * per character set in the expression and no empty transitions, followed by
+ * the subset construction. Bytes which no set tells apart share a column of
+ * the transition table. A literal string which every match must contain is
+ * searched for with memchr() before the DFA is run. Once compiled the DFA is
+ * only read, so any number of threads may match against it at once.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The largest number of character sets, once repeats are written out.
+#define MAX_POSITIONS 4096
+
+// The largest bound of a "{m,n}" repeat.
+#define MAX_REPEAT 255
+
+// The longest literal string kept for the prefilter.
+#define MAX_LITERAL 64
+
+// The size of the hash table finding DFA states, a power of two.
+#define STATE_TABLE_SIZE 32768
+
+// The state which never accepts, and the state matching starts in.
+#define DEAD_STATE 0
+#define START_STATE 1
+
+// The kinds of nodes in the parsed expression.
+enum node_kind{
+	NODE_EMPTY,
+	NODE_SET,
+	NODE_CAT,
+	NODE_ALT,
+	NODE_STAR,
+	NODE_PLUS,
+	NODE_OPT,
+	NODE_REPEAT
+};
+
+struct node{
+	enum node_kind kind;
+	int left; //The only child of the repeats
+	int right;
+	int min; //The bounds of NODE_REPEAT, max -1 when there is none
+	int max;
+	int set; //The set of NODE_SET
+};
+
+// A set of characters, one bit per byte value.
+struct char_set{
+	uint64_t bits[4];
+};
+
+// The state of the parser.
+struct parser{
+	const char *p;
+	bool ignore_case;
+	const char *error;
+	struct node *nodes;
+	size_t num_nodes;
+	size_t max_nodes;
+	struct char_set *sets;
+	size_t num_sets;
+	size_t max_sets;
+};
+
+// The first, last and nullable of a part of the expression, in the Glushkov
+// construction. Positions are numbered from 1, position 0 being the start.
+struct frag{
+	bool nullable;
+	uint64_t *first;
+	uint64_t *last;
+};
+
+// The state of the Glushkov construction.
+struct glushkov{
+	const struct parser *ps;
+	size_t words; //The size of a position bitset
+	size_t num_positions;
+	int *position_set; //The char set of each position
+	uint64_t **follow; //The positions which may follow each position
+};
+
+// What the prefilter knows about a part of the expression.
+struct literal_info{
+	bool exact; //Only matches str
+	char str[MAX_LITERAL];
+	size_t len;
+	char prefix[MAX_LITERAL]; //Every match starts with this
+	size_t prefix_len;
+	char suffix[MAX_LITERAL]; //Every match ends with this
+	size_t suffix_len;
+	char must[MAX_LITERAL]; //Every match contains this
+	size_t must_len;
+};
+
+// The regex type.
+struct regex_dfa{
+	unsigned char byte_class[256];
+	size_t num_classes;
+	size_t num_states;
+	int *next; //num_states * num_classes transitions
+	bool *accept;
+	char prefix[MAX_LITERAL];
+	size_t prefix_len;
+	char suffix[MAX_LITERAL];
+	size_t suffix_len;
+	char must[MAX_LITERAL];
+	size_t must_len;
+};
+
+// The character classes which may be used in a set.
+static const struct{
+	const char *name;
+	int (*is_member)(int c);
+}char_classes[] = {
+	{"alnum", isalnum}, {"alpha", isalpha}, {"blank", isblank},
+	{"cntrl", iscntrl}, {"digit", isdigit}, {"graph", isgraph},
+	{"lower", islower}, {"print", isprint}, {"punct", ispunct},
+	{"space", isspace}, {"upper", isupper}, {"xdigit", isxdigit}
+};
+
+static int parse_alt(struct parser *ps);
+
+/**
+ * xrealloc() - realloc() which exits the program on failure.
+ * @p: The memory to grow.
+ * @size: The new size.
+ * Returns: A pointer to the memory.
+ */
+static void *xrealloc(void *p, size_t size){
+	p = realloc(p, (size > 0) ? size : 1);
+	if(p == NULL){
+		perror("regex_dfa.c");
+		exit(errno);
+	}
+
+	return p;
+}
+
+/**
+ * xcalloc() - calloc() which exits the program on failure.
+ * @n: The number of members.
+ * @size: The size of each member.
+ * Returns: A pointer to the zeroed memory.
+ */
+static void *xcalloc(size_t n, size_t size){
+	void *p = calloc((n > 0) ? n : 1, size);
+	if(p == NULL){
+		perror("regex_dfa.c");
+		exit(errno);
+	}
+
+	return p;
+}
+
+/**
+ * set_add() - Adds a character to a set.
+ * @s: The set.
+ * @c: The character.
+ */
+static void set_add(struct char_set *s, unsigned char c){
+	s->bits[c >> 6] |= (uint64_t)1 << (c & 63);
+}
+
+/**
+ * set_has() - Checks if a character is in a set.
+ * @s: The set.
+ * @c: The character.
+ * Returns: true if the character is in the set.
+ */
+static bool set_has(const struct char_set *s, unsigned char c){
+	return (s->bits[c >> 6] >> (c & 63)) & 1;
+}
+
+/**
+ * new_node() - Adds a node to the parsed expression.
+ * @ps: The parser.
+ * @kind: The kind of node.
+ * @left: The first child, or -1.
+ * @right: The second child, or -1.
+ * Returns: The index of the node.
+ */
+static int new_node(struct parser *ps, enum node_kind kind, int left,
+		int right){
+	if(ps->num_nodes == ps->max_nodes){
+		ps->max_nodes = (ps->max_nodes > 0) ? ps->max_nodes * 2 : 32;
+		ps->nodes = xrealloc(ps->nodes, ps->max_nodes * sizeof(*ps->nodes));
+	}
+
+	struct node *n = &ps->nodes[ps->num_nodes];
+	memset(n, 0, sizeof(*n));
+	n->kind = kind;
+	n->left = left;
+	n->right = right;
+	n->set = -1;
+
+	return (int)ps->num_nodes++;
+}
+
+/**
+ * new_set_node() - Adds an empty set and a node matching it.
+ * @ps: The parser.
+ * Returns: The index of the node, whose set is ps->sets[node.set].
+ */
+static int new_set_node(struct parser *ps){
+	if(ps->num_sets == ps->max_sets){
+		ps->max_sets = (ps->max_sets > 0) ? ps->max_sets * 2 : 32;
+		ps->sets = xrealloc(ps->sets, ps->max_sets * sizeof(*ps->sets));
+	}
+	memset(&ps->sets[ps->num_sets], 0, sizeof(ps->sets[0]));
+
+	int n = new_node(ps, NODE_SET, -1, -1);
+	ps->nodes[n].set = (int)ps->num_sets++;
+
+	return n;
+}
+
+/**
+ * fold_set() - Adds the other case of every letter in a set.
+ * @s: The set.
+ */
+static void fold_set(struct char_set *s){
+	for(int c = 'a'; c <= 'z'; c++){
+		if(set_has(s, (unsigned char)c) ||
+				set_has(s, (unsigned char)toupper(c))){
+			set_add(s, (unsigned char)c);
+			set_add(s, (unsigned char)toupper(c));
+		}
+	}
+}
+
+/**
+ * add_class() - Adds the members of a character class to a set.
+ * @s: The set.
+ * @is_member: The function telling the members of the class.
+ * @negate: If true, the characters not in the class are added instead.
+ */
+static void add_class(struct char_set *s, int (*is_member)(int c),
+		bool negate){
+	for(int c = 0; c < 256; c++){
+		if((is_member(c) != 0) != negate){
+			set_add(s, (unsigned char)c);
+		}
+	}
+}
+
+/**
+ * is_word() - Tells the word characters of "\w".
+ * @c: The character.
+ * Returns: Non zero for letters, digits and '_'.
+ */
+static int is_word(int c){
+	return isalnum(c) || (c == '_');
+}
+
+/**
+ * parse_bracket() - Parses a set like "[a-z_]". Like in POSIX a '\' inside
+ * the set is an ordinary character.
+ * @ps: The parser, at the '['.
+ * Returns: The index of the node, or -1 on an error.
+ */
+static int parse_bracket(struct parser *ps){
+	int n = new_set_node(ps);
+	struct char_set *s = &ps->sets[ps->nodes[n].set];
+	bool negate = false;
+
+	ps->p++;
+	if(*ps->p == '^'){
+		negate = true;
+		ps->p++;
+	}
+
+	//A ']' first in the set is a member
+	bool first = true;
+	while(first || (*ps->p != ']')){
+		first = false;
+
+		if(*ps->p == '\0'){
+			ps->error = "missing ']'";
+			return -1;
+		}
+
+		if((ps->p[0] == '[') && (ps->p[1] == ':')){
+			const char *end = strstr(ps->p + 2, ":]");
+			size_t len = (end != NULL) ? (size_t)(end - (ps->p + 2)) : 0;
+			bool found = false;
+
+			for(size_t i = 0; (end != NULL) &&
+					(i < sizeof(char_classes) / sizeof(char_classes[0]));
+					i++){
+				if((strlen(char_classes[i].name) == len) &&
+						(strncmp(char_classes[i].name, ps->p + 2, len) == 0)){
+					add_class(s, char_classes[i].is_member, false);
+					found = true;
+				}
+			}
+			if(!found){
+				ps->error = "unknown character class";
+				return -1;
+			}
+			ps->p = end + 2;
+			continue;
+		}
+
+		unsigned char low = (unsigned char)*ps->p++;
+		unsigned char high = low;
+
+		if((ps->p[0] == '-') && (ps->p[1] != ']') && (ps->p[1] != '\0')){
+			high = (unsigned char)ps->p[1];
+			ps->p += 2;
+			if(high < low){
+				ps->error = "invalid range";
+				return -1;
+			}
+		}
+
+		for(unsigned c = low; c <= high; c++){
+			set_add(s, (unsigned char)c);
+		}
+	}
+	ps->p++;
+
+	if(ps->ignore_case){
+		fold_set(s);
+	}
+	if(negate){
+		for(int i = 0; i < 4; i++){
+			s->bits[i] = ~s->bits[i];
+		}
+	}
+
+	return n;
+}
+
+/**
+ * parse_atom() - Parses a group, a set, '.', an escape or a character.
+ * @ps: The parser.
+ * Returns: The index of the node, or -1 on an error.
+ */
+static int parse_atom(struct parser *ps){
+	char c = *ps->p;
+
+	if(c == '('){
+		ps->p++;
+		int n = parse_alt(ps);
+		if(n < 0){
+			return -1;
+		}
+		if(*ps->p != ')'){
+			ps->error = "missing ')'";
+			return -1;
+		}
+		ps->p++;
+		return n;
+	}
+	if(c == '['){
+		return parse_bracket(ps);
+	}
+	if((c == '*') || (c == '+') || (c == '?') || (c == '{')){
+		ps->error = "nothing to repeat";
+		return -1;
+	}
+
+	int n = new_set_node(ps);
+	struct char_set *s = &ps->sets[ps->nodes[n].set];
+	ps->p++;
+
+	if(c == '.'){
+		memset(s->bits, 0xff, sizeof(s->bits));
+		return n;
+	}
+
+	if(c == '\\'){
+		c = *ps->p++;
+		switch(c){
+			case '\0':
+				ps->error = "trailing backslash";
+				return -1;
+			case 'd':
+			case 'D':
+				add_class(s, isdigit, c == 'D');
+				return n;
+			case 'w':
+			case 'W':
+				add_class(s, is_word, c == 'W');
+				return n;
+			case 's':
+			case 'S':
+				add_class(s, isspace, c == 'S');
+				return n;
+			default:
+				break;
+		}
+	}
+
+	set_add(s, (unsigned char)c);
+	if(ps->ignore_case){
+		fold_set(s);
+	}
+
+	return n;
+}
+
+/**
+ * parse_bound() - Parses a number in a "{m,n}" repeat.
+ * @ps: The parser, at the first digit.
+ * Returns: The number, or -1 if there is none or it is too large.
+ */
+static int parse_bound(struct parser *ps){
+	int value = 0;
+
+	if(!isdigit((unsigned char)*ps->p)){
+		return -1;
+	}
+	while(isdigit((unsigned char)*ps->p)){
+		value = value * 10 + (*ps->p++ - '0');
+		if(value > MAX_REPEAT){
+			return -1;
+		}
+	}
+
+	return value;
+}
+
+/**
+ * parse_repeat() - Parses an atom and the repeats following it.
+ * @ps: The parser.
+ * Returns: The index of the node, or -1 on an error.
+ */
+static int parse_repeat(struct parser *ps){
+	int n = parse_atom(ps);
+
+	while(n >= 0){
+		char c = *ps->p;
+
+		if(c == '*'){
+			n = new_node(ps, NODE_STAR, n, -1);
+		}
+		else if(c == '+'){
+			n = new_node(ps, NODE_PLUS, n, -1);
+		}
+		else if(c == '?'){
+			n = new_node(ps, NODE_OPT, n, -1);
+		}
+		else if(c == '{'){
+			ps->p++;
+			int min = parse_bound(ps);
+			int max = min;
+			if((min >= 0) && (*ps->p == ',')){
+				ps->p++;
+				if(*ps->p == '}'){
+					max = -1; //No upper bound
+				}
+				else if((max = parse_bound(ps)) < 0){
+					min = -1;
+				}
+			}
+			if((min < 0) || (*ps->p != '}') || ((max >= 0) && (max < min))){
+				ps->error = "invalid repeat bounds";
+				return -1;
+			}
+			n = new_node(ps, NODE_REPEAT, n, -1);
+			ps->nodes[n].min = min;
+			ps->nodes[n].max = max;
+		}
+		else{
+			break;
+		}
+		ps->p++;
+	}
+
+	return n;
+}
+
+/**
+ * parse_cat() - Parses a branch, the atoms between two '|'. A '^' at its
+ * start and a '$' at its end are skipped, since the whole name is matched.
+ * @ps: The parser.
+ * Returns: The index of the node, or -1 on an error.
+ */
+static int parse_cat(struct parser *ps){
+	int left = -1;
+	bool at_start = true;
+
+	while((*ps->p != '\0') && (*ps->p != '|') && (*ps->p != ')')){
+		if((*ps->p == '^') && at_start){
+			ps->p++;
+			continue;
+		}
+		if((*ps->p == '$') && ((ps->p[1] == '\0') || (ps->p[1] == '|') ||
+				(ps->p[1] == ')'))){
+			ps->p++;
+			continue;
+		}
+		at_start = false;
+
+		int n = parse_repeat(ps);
+		if(n < 0){
+			return -1;
+		}
+		left = (left < 0) ? n : new_node(ps, NODE_CAT, left, n);
+	}
+
+	return (left < 0) ? new_node(ps, NODE_EMPTY, -1, -1) : left;
+}
+
+/**
+ * parse_alt() - Parses branches separated by '|'.
+ * @ps: The parser.
+ * Returns: The index of the node, or -1 on an error.
+ */
+static int parse_alt(struct parser *ps){
+	int left = parse_cat(ps);
+
+	while((left >= 0) && (*ps->p == '|')){
+		ps->p++;
+		int right = parse_cat(ps);
+		if(right < 0){
+			return -1;
+		}
+		left = new_node(ps, NODE_ALT, left, right);
+	}
+
+	return left;
+}
+
+/**
+ * count_positions() - Counts the sets in a part of the expression once its
+ * repeats are written out, stopping early when there are too many.
+ * @ps: The parser.
+ * @n: The node.
+ * Returns: The number of sets, or more than MAX_POSITIONS.
+ */
+static size_t count_positions(const struct parser *ps, int n){
+	const struct node *node = &ps->nodes[n];
+
+	switch(node->kind){
+		case NODE_EMPTY:
+			return 0;
+		case NODE_SET:
+			return 1;
+		case NODE_CAT:
+		case NODE_ALT:
+			return count_positions(ps, node->left) +
+					count_positions(ps, node->right);
+		case NODE_REPEAT:{
+			size_t copies = (node->max >= 0) ? (size_t)node->max :
+					(size_t)node->min + 1;
+			size_t inner = count_positions(ps, node->left);
+			return (inner > MAX_POSITIONS) ? inner : inner * copies;
+		}
+		case NODE_STAR:
+		case NODE_PLUS:
+		case NODE_OPT:
+		default:
+			return count_positions(ps, node->left);
+	}
+}
+
+/**
+ * bits_or() - Adds all the positions of one bitset to another.
+ * @g: The construction.
+ * @to: The bitset which to add to.
+ * @from: The bitset which to add.
+ */
+static void bits_or(const struct glushkov *g, uint64_t *to,
+		const uint64_t *from){
+	for(size_t i = 0; i < g->words; i++){
+		to[i] |= from[i];
+	}
+}
+
+/**
+ * frag_new() - Creates a fragment matching only the empty string.
+ * @g: The construction.
+ * Returns: The fragment.
+ */
+static struct frag frag_new(const struct glushkov *g){
+	struct frag f;
+
+	f.nullable = true;
+	f.first = xcalloc(g->words, sizeof(uint64_t));
+	f.last = xcalloc(g->words, sizeof(uint64_t));
+
+	return f;
+}
+
+/**
+ * frag_kill() - Frees the bitsets of a fragment.
+ * @f: The fragment.
+ */
+static void frag_kill(struct frag f){
+	free(f.first);
+	free(f.last);
+}
+
+/**
+ * frag_loop() - Lets a fragment follow itself, as for '*' and '+'.
+ * @g: The construction.
+ * @f: The fragment.
+ */
+static void frag_loop(struct glushkov *g, struct frag f){
+	for(size_t p = 0; p <= g->num_positions; p++){
+		if((f.last[p >> 6] >> (p & 63)) & 1){
+			bits_or(g, g->follow[p], f.first);
+		}
+	}
+}
+
+/**
+ * frag_cat() - Joins two fragments, one after the other. Both are used up.
+ * @g: The construction.
+ * @a: The first fragment.
+ * @b: The second fragment.
+ * Returns: The joined fragment.
+ */
+static struct frag frag_cat(struct glushkov *g, struct frag a, struct frag b){
+	for(size_t p = 0; p <= g->num_positions; p++){
+		if((a.last[p >> 6] >> (p & 63)) & 1){
+			bits_or(g, g->follow[p], b.first);
+		}
+	}
+
+	if(a.nullable){
+		bits_or(g, a.first, b.first);
+	}
+	if(b.nullable){
+		bits_or(g, b.last, a.last);
+	}
+
+	struct frag f = {a.nullable && b.nullable, a.first, b.last};
+	free(a.last);
+	free(b.first);
+
+	return f;
+}
+
+/**
+ * build() - Numbers the positions of a part of the expression and fills in
+ * which positions may follow which. A repeat is built once for every copy it
+ * is written out to, each copy getting its own positions.
+ * @g: The construction.
+ * @n: The node.
+ * Returns: The fragment of the node.
+ */
+static struct frag build(struct glushkov *g, int n){
+	const struct node *node = &g->ps->nodes[n];
+	struct frag f;
+
+	switch(node->kind){
+		case NODE_SET:{
+			size_t p = ++g->num_positions;
+			g->position_set[p] = node->set;
+			f = frag_new(g);
+			f.nullable = false;
+			f.first[p >> 6] |= (uint64_t)1 << (p & 63);
+			f.last[p >> 6] |= (uint64_t)1 << (p & 63);
+			return f;
+		}
+		case NODE_CAT:{
+			struct frag a = build(g, node->left);
+			return frag_cat(g, a, build(g, node->right));
+		}
+		case NODE_ALT:{
+			struct frag a = build(g, node->left);
+			struct frag b = build(g, node->right);
+			bits_or(g, a.first, b.first);
+			bits_or(g, a.last, b.last);
+			a.nullable = a.nullable || b.nullable;
+			frag_kill(b);
+			return a;
+		}
+		case NODE_STAR:
+		case NODE_PLUS:
+			f = build(g, node->left);
+			frag_loop(g, f);
+			f.nullable = f.nullable || (node->kind == NODE_STAR);
+			return f;
+		case NODE_OPT:
+			f = build(g, node->left);
+			f.nullable = true;
+			return f;
+		case NODE_REPEAT:
+			f = frag_new(g);
+			for(int i = 0; i < node->min; i++){
+				f = frag_cat(g, f, build(g, node->left));
+			}
+			if(node->max < 0){
+				struct frag loop = build(g, node->left);
+				frag_loop(g, loop);
+				loop.nullable = true;
+				f = frag_cat(g, f, loop);
+			}
+			for(int i = node->min; i < node->max; i++){
+				struct frag opt = build(g, node->left);
+				opt.nullable = true;
+				f = frag_cat(g, f, opt);
+			}
+			return f;
+		case NODE_EMPTY:
+		default:
+			return frag_new(g);
+	}
+}
+
+/**
+ * append_literal() - Appends one literal string to another, keeping as much
+ * as fits from the start or from the end.
+ * @to: The string which to append to.
+ * @to_len: The length of to, updated.
+ * @from: The string which to append.
+ * @from_len: The length of from.
+ * @keep_end: If true and the result is too long, its start is dropped,
+ * otherwise its end.
+ */
+static void append_literal(char *to, size_t *to_len, const char *from,
+		size_t from_len, bool keep_end){
+	char joined[2 * MAX_LITERAL];
+
+	memcpy(joined, to, *to_len);
+	memcpy(joined + *to_len, from, from_len);
+	size_t len = *to_len + from_len;
+
+	if(len > MAX_LITERAL){
+		size_t drop = len - MAX_LITERAL;
+		memcpy(to, joined + (keep_end ? drop : 0), MAX_LITERAL);
+		*to_len = MAX_LITERAL;
+	}
+	else{
+		memcpy(to, joined, len);
+		*to_len = len;
+	}
+}
+
+/**
+ * keep_longer() - Replaces the must string of a part by another string if
+ * that is longer.
+ * @info: The part.
+ * @str: The other string.
+ * @len: The length of str.
+ */
+static void keep_longer(struct literal_info *info, const char *str,
+		size_t len){
+	if(len > info->must_len){
+		memcpy(info->must, str, len);
+		info->must_len = len;
+	}
+}
+
+/**
+ * find_literals() - Finds the literal strings which every match of a part of
+ * the expression starts with, ends with and contains.
+ * @ps: The parser.
+ * @n: The node.
+ * @info: Where to put what was found.
+ */
+static void find_literals(const struct parser *ps, int n,
+		struct literal_info *info){
+	const struct node *node = &ps->nodes[n];
+	memset(info, 0, sizeof(*info));
+
+	switch(node->kind){
+		case NODE_EMPTY:
+			info->exact = true;
+			return;
+		case NODE_SET:{
+			const struct char_set *s = &ps->sets[node->set];
+			int members = 0;
+			int member = 0;
+			for(int c = 0; (c < 256) && (members < 2); c++){
+				if(set_has(s, (unsigned char)c)){
+					members++;
+					member = c;
+				}
+			}
+			if(members == 1){
+				info->exact = true;
+				info->str[0] = info->prefix[0] = info->suffix[0] =
+						info->must[0] = (char)member;
+				info->len = info->prefix_len = info->suffix_len =
+						info->must_len = 1;
+			}
+			return;
+		}
+		case NODE_CAT:{
+			struct literal_info a;
+			struct literal_info b;
+			find_literals(ps, node->left, &a);
+			find_literals(ps, node->right, &b);
+
+			info->exact = a.exact && b.exact &&
+					(a.len + b.len <= MAX_LITERAL);
+			if(info->exact){
+				append_literal(info->str, &info->len, a.str, a.len, false);
+				append_literal(info->str, &info->len, b.str, b.len, false);
+			}
+
+			append_literal(info->prefix, &info->prefix_len, a.prefix,
+					a.prefix_len, false);
+			if(a.exact){
+				append_literal(info->prefix, &info->prefix_len, b.prefix,
+						b.prefix_len, false);
+			}
+
+			if(b.exact){
+				append_literal(info->suffix, &info->suffix_len, a.suffix,
+						a.suffix_len, true);
+			}
+			append_literal(info->suffix, &info->suffix_len, b.suffix,
+					b.suffix_len, true);
+
+			char joined[MAX_LITERAL];
+			size_t joined_len = 0;
+			append_literal(joined, &joined_len, a.suffix, a.suffix_len,
+					false);
+			append_literal(joined, &joined_len, b.prefix, b.prefix_len,
+					false);
+			keep_longer(info, a.must, a.must_len);
+			keep_longer(info, b.must, b.must_len);
+			keep_longer(info, joined, joined_len);
+			return;
+		}
+		case NODE_PLUS:
+		case NODE_REPEAT:
+			if((node->kind == NODE_PLUS) || (node->min > 0)){
+				struct literal_info inner;
+				find_literals(ps, node->left, &inner);
+				*info = inner;
+				info->exact = false;
+				info->len = 0;
+			}
+			return;
+		case NODE_ALT:
+		case NODE_STAR:
+		case NODE_OPT:
+		default:
+			//Nothing is known for sure
+			return;
+	}
+}
+
+/**
+ * split_classes() - Gives every group of bytes which no set tells apart its
+ * own class.
+ * @re: The regex which to fill in the classes of.
+ * @g: The construction.
+ */
+static void split_classes(regex_dfa *re, const struct glushkov *g){
+	memset(re->byte_class, 0, sizeof(re->byte_class));
+	re->num_classes = 1;
+
+	for(size_t p = 1; p <= g->num_positions; p++){
+		const struct char_set *s = &g->ps->sets[g->position_set[p]];
+		int split[256][2];
+		size_t num_classes = 0;
+
+		for(int i = 0; i < 256; i++){
+			split[i][0] = split[i][1] = -1;
+		}
+		for(int c = 0; c < 256; c++){
+			int *to = &split[re->byte_class[c]][set_has(s, (unsigned char)c)];
+			if(*to < 0){
+				*to = (int)num_classes++;
+			}
+			re->byte_class[c] = (unsigned char)*to;
+		}
+		re->num_classes = num_classes;
+	}
+}
+
+/**
+ * state_hash() - Hashes a set of positions.
+ * @bits: The set.
+ * @words: The size of the set.
+ * Returns: The hash.
+ */
+static uint64_t state_hash(const uint64_t *bits, size_t words){
+	uint64_t h = 0x9e3779b97f4a7c15ULL;
+
+	for(size_t i = 0; i < words; i++){
+		h = (h ^ bits[i]) * 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+	}
+
+	return h;
+}
+
+/**
+ * build_dfa() - Builds the DFA with the subset construction. A DFA state is
+ * the set of positions which the name read so far may end at.
+ * @re: The regex.
+ * @g: The finished construction.
+ * @root: The fragment of the whole expression.
+ * Returns: NULL on success, or a description of the error.
+ */
+static const char *build_dfa(regex_dfa *re, struct glushkov *g,
+		struct frag root){
+	const char *error = NULL;
+	size_t words = g->words;
+	size_t max_states = 64;
+	uint64_t *states = xcalloc(max_states * words, sizeof(uint64_t));
+	int *table = xcalloc(STATE_TABLE_SIZE, sizeof(int));
+	uint64_t *reachable = xcalloc(words, sizeof(uint64_t));
+	uint64_t *target = xcalloc(words, sizeof(uint64_t));
+
+	split_classes(re, g);
+
+	//The positions which can read each class
+	uint64_t *class_positions = xcalloc(re->num_classes * words,
+			sizeof(uint64_t));
+	for(int c = 0; c < 256; c++){
+		uint64_t *bits = &class_positions[re->byte_class[c] * words];
+		for(size_t p = 1; p <= g->num_positions; p++){
+			if(set_has(&g->ps->sets[g->position_set[p]], (unsigned char)c)){
+				bits[p >> 6] |= (uint64_t)1 << (p & 63);
+			}
+		}
+	}
+
+	bits_or(g, g->follow[0], root.first);
+
+	//The dead state is empty, the start state holds only position 0
+	for(size_t i = 0; i < STATE_TABLE_SIZE; i++){
+		table[i] = -1;
+	}
+	table[state_hash(states, words) & (STATE_TABLE_SIZE - 1)] = DEAD_STATE;
+	states[words] = 1;
+	table[state_hash(&states[words], words) & (STATE_TABLE_SIZE - 1)] =
+			START_STATE;
+	re->num_states = 2;
+
+	size_t max_next = 64;
+	re->next = xcalloc(max_next * re->num_classes, sizeof(*re->next));
+
+	for(size_t s = START_STATE; s < re->num_states; s++){
+		memset(reachable, 0, words * sizeof(uint64_t));
+		for(size_t p = 0; p <= g->num_positions; p++){
+			if((states[s * words + (p >> 6)] >> (p & 63)) & 1){
+				bits_or(g, reachable, g->follow[p]);
+			}
+		}
+
+		for(size_t c = 0; c < re->num_classes; c++){
+			for(size_t i = 0; i < words; i++){
+				target[i] = reachable[i] & class_positions[c * words + i];
+			}
+
+			//Find the state or add it
+			size_t slot = state_hash(target, words) & (STATE_TABLE_SIZE - 1);
+			while((table[slot] >= 0) && (memcmp(&states[table[slot] * words],
+					target, words * sizeof(uint64_t)) != 0)){
+				slot = (slot + 1) & (STATE_TABLE_SIZE - 1);
+			}
+
+			if(table[slot] < 0){
+				if(re->num_states == REGEX_DFA_MAX_STATES){
+					error = "the expression needs too many DFA states";
+					goto out;
+				}
+				if(re->num_states == max_states){
+					max_states *= 2;
+					states = xrealloc(states,
+							max_states * words * sizeof(uint64_t));
+				}
+				memcpy(&states[re->num_states * words], target,
+						words * sizeof(uint64_t));
+				table[slot] = (int)re->num_states++;
+			}
+
+			re->next[s * re->num_classes + c] = table[slot];
+		}
+
+		if(re->num_states > max_next){
+			while(re->num_states > max_next){
+				max_next *= 2;
+			}
+			re->next = xrealloc(re->next,
+					max_next * re->num_classes * sizeof(*re->next));
+			memset(&re->next[(s + 1) * re->num_classes], 0,
+					(max_next - s - 1) * re->num_classes * sizeof(*re->next));
+		}
+	}
+
+	re->accept = xcalloc(re->num_states, sizeof(*re->accept));
+	for(size_t s = START_STATE; s < re->num_states; s++){
+		for(size_t i = 0; i < words; i++){
+			if(states[s * words + i] & root.last[i]){
+				re->accept[s] = true;
+			}
+		}
+	}
+	re->accept[START_STATE] = re->accept[START_STATE] || root.nullable;
+
+out:
+	free(states);
+	free(table);
+	free(reachable);
+	free(target);
+	free(class_positions);
+
+	return error;
+}
+
+/**
+ * regex_dfa_new() - Compiles an expression.
+ * @pattern: The expression.
+ * @ignore_case: If true, letters match regardless of their case.
+ * @error: Where to put a description of the error if the expression is
+ * invalid or too large.
+ * Returns: A pointer to the new regex, or NULL on an error.
+ */
+regex_dfa *regex_dfa_new(const char *pattern, bool ignore_case,
+		const char **error){
+	struct parser ps = {.p = pattern, .ignore_case = ignore_case};
+	regex_dfa *re = NULL;
+
+	int root_node = parse_alt(&ps);
+	if((root_node >= 0) && (*ps.p == ')')){
+		ps.error = "unmatched ')'";
+		root_node = -1;
+	}
+	if((root_node >= 0) &&
+			(count_positions(&ps, root_node) > MAX_POSITIONS)){
+		ps.error = "the expression is too large";
+		root_node = -1;
+	}
+	if(root_node < 0){
+		*error = ps.error;
+		goto out;
+	}
+
+	struct glushkov g = {.ps = &ps};
+	size_t num_positions = count_positions(&ps, root_node);
+	g.words = (num_positions + 1 + 63) / 64;
+	g.position_set = xcalloc(num_positions + 1, sizeof(*g.position_set));
+	g.follow = xcalloc(num_positions + 1, sizeof(*g.follow));
+	for(size_t p = 0; p <= num_positions; p++){
+		g.follow[p] = xcalloc(g.words, sizeof(uint64_t));
+	}
+
+	re = xcalloc(1, sizeof(*re));
+	struct frag root = build(&g, root_node);
+	*error = build_dfa(re, &g, root);
+
+	if(*error == NULL){
+		//The prefilter compares bytes, so it can not ignore case
+		struct literal_info info;
+		find_literals(&ps, root_node, &info);
+		if(!ignore_case){
+			memcpy(re->prefix, info.prefix, info.prefix_len);
+			re->prefix_len = info.prefix_len;
+			memcpy(re->suffix, info.suffix, info.suffix_len);
+			re->suffix_len = info.suffix_len;
+			memcpy(re->must, info.must, info.must_len);
+			re->must_len = info.must_len;
+		}
+	}
+	else{
+		regex_dfa_kill(re);
+		re = NULL;
+	}
+
+	frag_kill(root);
+	for(size_t p = 0; p <= num_positions; p++){
+		free(g.follow[p]);
+	}
+	free(g.follow);
+	free(g.position_set);
+
+out:
+	free(ps.nodes);
+	free(ps.sets);
+
+	return re;
+}
+
+/**
+ * contains_literal() - Checks if a name contains a string, looking for its
+ * first character with memchr() and comparing the rest where it is found.
+ * @name: The name.
+ * @len: The length of the name.
+ * @str: The string.
+ * @str_len: The length of the string, at least 1.
+ * Returns: true if the string is found.
+ */
+static bool contains_literal(const char *name, size_t len, const char *str,
+		size_t str_len){
+	if(len < str_len){
+		return false;
+	}
+
+	const char *p = name;
+	const char *last = name + len - str_len;
+	while((p = memchr(p, str[0], (size_t)(last - p) + 1)) != NULL){
+		if(memcmp(p + 1, str + 1, str_len - 1) == 0){
+			return true;
+		}
+		if(p++ == last){
+			break;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * regex_dfa_match() - Checks if a name matches the expression.
+ * @re: The regex.
+ * @name: The name, without any directory.
+ * Returns: true if the expression matches the whole name, else false.
+ */
+bool regex_dfa_match(const regex_dfa *re, const char *name){
+	size_t len = strlen(name);
+
+	if((len < re->prefix_len) || (len < re->suffix_len) ||
+			(memcmp(name, re->prefix, re->prefix_len) != 0) ||
+			(memcmp(name + len - re->suffix_len, re->suffix,
+			re->suffix_len) != 0)){
+		return false;
+	}
+	if((re->must_len > 0) &&
+			!contains_literal(name, len, re->must, re->must_len)){
+		return false;
+	}
+
+	int state = START_STATE;
+	for(size_t i = 0; i < len; i++){
+		state = re->next[state * re->num_classes +
+				re->byte_class[(unsigned char)name[i]]];
+		if(state == DEAD_STATE){
+			return false;
+		}
+	}
+
+	return re->accept[state];
+}
+
+/**
+ * regex_dfa_kill() - Removes the regex.
+ * @re: The regex which to remove.
+ */
+void regex_dfa_kill(regex_dfa *re){
+	free(re->next);
+	free(re->accept);
+	free(re);
+}
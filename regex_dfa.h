@@ -0,0 +1,57 @@
+#ifndef __REGEX_DFA_H_
+#define __REGEX_DFA_H_
+
+#include <stdbool.h>
+
+/*
+ * A regular expression for file names, compiled once into a DFA so a name is
+ * matched in one pass over its bytes, without any backtracking. The syntax is
+ * that of POSIX extended regular expressions: '.', sets like "[a-z]" with
+ * "[:class:]" and '^' to negate, groups, '|', and the repeats '*', '+', '?'
+ * and "{m,n}". '\' takes the next character literally, and "\d", "\w" and "\s"
+ * are digits, word characters and white space. The expression must match the
+ * whole name, so a '^' at the start and a '$' at the end are allowed but not
+ * needed. Back references are not supported.
+ *
+ * The DFA is built with the Glushkov construction, which gives one NFA state
+ * per character set in the expression and no empty transitions, followed by
+ * the subset construction. Bytes which no set tells apart share a column of
+ * the transition table. A literal string which every match must contain is
+ * searched for with memchr() before the DFA is run. Once compiled the DFA is
+ * only read, so any number of threads may match against it at once.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The largest number of DFA states an expression may need.
+#define REGEX_DFA_MAX_STATES 10000
+
+// The regex type.
+typedef struct regex_dfa regex_dfa;
+
+/**
+ * regex_dfa_new() - Compiles an expression.
+ * @pattern: The expression.
+ * @ignore_case: If true, letters match regardless of their case.
+ * @error: Where to put a description of the error if the expression is
+ * invalid or too large.
+ * Returns: A pointer to the new regex, or NULL on an error.
+ */
+regex_dfa *regex_dfa_new(const char *pattern, bool ignore_case,
+		const char **error);
+
+/**
+ * regex_dfa_match() - Checks if a name matches the expression.
+ * @re: The regex.
+ * @name: The name, without any directory.
+ * Returns: true if the expression matches the whole name, else false.
+ */
+bool regex_dfa_match(const regex_dfa *re, const char *name);
+
+/**
+ * regex_dfa_kill() - Removes the regex.
+ * @re: The regex which to remove.
+ */
+void regex_dfa_kill(regex_dfa *re);
+
+#endif //__REGEX_DFA_H_
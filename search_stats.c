@@ -0,0 +1,394 @@
+#include "search_stats.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
+
+/*
+ * Statistics of a search, kept by each thread for itself without any atomic
+ * or lock, so they are cheap enough to always collect. The latencies of the
+ * system calls are only measured when asked for, with one read of the
+ * monotonic clock before and after each call, into histograms whose buckets
+ * are the powers of two of nanoseconds. A timeline of the search, sampled by
+ * one thread, holds how many directories were queued and had been read over
+ * time. At the end the statistics of all the threads are reported as text or
+ * as JSON, together with the peak memory use of the process.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The most samples of the timeline printed in the table.
+#define PRINTED_SAMPLES 20
+
+// The timeline type.
+struct stats_timeline{
+	stats_sample *samples;
+	size_t num_samples;
+	size_t max_samples;
+};
+
+/**
+ * now_ns() - Reads the monotonic clock.
+ * Returns: The time in ns, never 0.
+ */
+static uint64_t now_ns(void){
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec + 1;
+}
+
+/**
+ * max_rss_kb() - Gives the peak memory use of the process.
+ * Returns: The largest resident set size so far in KiB, or 0 if unknown.
+ */
+static long max_rss_kb(void){
+	struct rusage usage;
+
+	if(getrusage(RUSAGE_SELF, &usage) < 0){
+		return 0;
+	}
+
+	return usage.ru_maxrss;
+}
+
+/**
+ * stats_clock() - Reads the clock before a call which is timed.
+ * @s: The statistics of the thread.
+ * Returns: The time in ns, or 0 if the latencies are not measured.
+ */
+uint64_t stats_clock(const worker_stats *s){
+	return s->timed ? now_ns() : 0;
+}
+
+/**
+ * stats_since() - Gives the time passed since stats_clock().
+ * @start: What stats_clock() returned.
+ * Returns: The time in ns, 0 if start is 0.
+ */
+uint64_t stats_since(uint64_t start){
+	return (start != 0) ? now_ns() - start : 0;
+}
+
+/**
+ * latency_add() - Adds the time passed since stats_clock() to a histogram.
+ * Does nothing if start is 0.
+ * @h: The histogram.
+ * @start: What stats_clock() returned.
+ */
+void latency_add(latency_histogram *h, uint64_t start){
+	if(start == 0){
+		return;
+	}
+
+	uint64_t ns = now_ns() - start;
+	int bucket = (ns > 1) ? 63 - __builtin_clzll(ns) : 0;
+
+	if(bucket >= LATENCY_BUCKETS){
+		bucket = LATENCY_BUCKETS - 1;
+	}
+	h->buckets[bucket]++;
+	h->count++;
+	h->total_ns += ns;
+	if(ns > h->max_ns){
+		h->max_ns = ns;
+	}
+}
+
+/**
+ * add_histogram() - Adds one histogram to another.
+ * @sum: What to add to.
+ * @h: What to add.
+ */
+static void add_histogram(latency_histogram *sum, const latency_histogram *h){
+	sum->count += h->count;
+	sum->total_ns += h->total_ns;
+	if(h->max_ns > sum->max_ns){
+		sum->max_ns = h->max_ns;
+	}
+	for(int i = 0; i < LATENCY_BUCKETS; i++){
+		sum->buckets[i] += h->buckets[i];
+	}
+}
+
+/**
+ * stats_add() - Adds the statistics of one thread to those of another.
+ * @sum: What to add to.
+ * @s: What to add.
+ */
+void stats_add(worker_stats *sum, const worker_stats *s){
+	sum->timed = sum->timed || s->timed;
+	sum->dirs += s->dirs;
+	sum->entries += s->entries;
+	sum->stat_calls += s->stat_calls;
+	sum->avoided_stats += s->avoided_stats;
+	sum->cached_dirs += s->cached_dirs;
+	sum->batches += s->batches;
+	sum->scanned_files += s->scanned_files;
+	sum->matches += s->matches;
+	sum->steals += s->steals;
+	if(s->peak_pending > sum->peak_pending){
+		sum->peak_pending = s->peak_pending;
+	}
+	sum->idle_ns += s->idle_ns;
+	add_histogram(&sum->open_latency, &s->open_latency);
+	add_histogram(&sum->read_latency, &s->read_latency);
+	add_histogram(&sum->stat_latency, &s->stat_latency);
+}
+
+/**
+ * stats_timeline_new() - Create a new and empty timeline.
+ * Returns: A pointer to the new timeline.
+ */
+stats_timeline *stats_timeline_new(void){
+	stats_timeline *t = calloc(1, sizeof(*t));
+	if(t == NULL){
+		perror("search_stats.c");
+		exit(errno);
+	}
+
+	return t;
+}
+
+/**
+ * stats_timeline_add() - Adds a sample to the end of the timeline. Must only
+ * be called by one thread.
+ * @t: The timeline.
+ * @sample: The sample.
+ */
+void stats_timeline_add(stats_timeline *t, const stats_sample *sample){
+	if(t->num_samples == t->max_samples){
+		size_t max = (t->max_samples == 0) ? 256 : 2 * t->max_samples;
+		stats_sample *samples = realloc(t->samples, max * sizeof(*samples));
+		if(samples == NULL){
+			perror("search_stats.c");
+			exit(errno);
+		}
+		t->samples = samples;
+		t->max_samples = max;
+	}
+
+	t->samples[t->num_samples++] = *sample;
+}
+
+/**
+ * stats_timeline_kill() - Removes the timeline.
+ * @t: The timeline which to remove, or NULL.
+ */
+void stats_timeline_kill(stats_timeline *t){
+	if(t == NULL){
+		return;
+	}
+
+	free(t->samples);
+	free(t);
+}
+
+/**
+ * percentile() - Gives a bound of the latency which a part of the calls took
+ * at most, from the bucket holding it.
+ * @h: The histogram.
+ * @part: The part, between 0 and 1.
+ * Returns: The upper bound of the bucket in ns, at most the longest latency.
+ */
+static uint64_t percentile(const latency_histogram *h, double part){
+	unsigned long wanted = (unsigned long)(part * (double)h->count + 0.5);
+	unsigned long seen = 0;
+
+	if(wanted == 0){
+		wanted = 1;
+	}
+	for(int i = 0; i < LATENCY_BUCKETS - 1; i++){
+		seen += h->buckets[i];
+		if(seen >= wanted){
+			uint64_t bound = (uint64_t)2 << i;
+			return (bound < h->max_ns) ? bound : h->max_ns;
+		}
+	}
+
+	return h->max_ns;
+}
+
+/**
+ * print_latency() - Writes a row of the latency table.
+ * @out: Where to write it.
+ * @name: The name of the call.
+ * @h: Its histogram.
+ */
+static void print_latency(FILE *out, const char *name,
+		const latency_histogram *h){
+	if(h->count == 0){
+		fprintf(out, "%-9s %10d\n", name, 0);
+		return;
+	}
+
+	fprintf(out, "%-9s %10lu %10.1f %10.1f %10.1f %10.1f %10.1f\n", name,
+			h->count, (double)h->total_ns / (double)h->count / 1000.0,
+			(double)percentile(h, 0.5) / 1000.0,
+			(double)percentile(h, 0.9) / 1000.0,
+			(double)percentile(h, 0.99) / 1000.0, (double)h->max_ns / 1000.0);
+}
+
+/**
+ * print_worker() - Writes a row of the table of the threads.
+ * @out: Where to write it.
+ * @name: The name of the row.
+ * @s: The statistics of the row.
+ */
+static void print_worker(FILE *out, const char *name, const worker_stats *s){
+	fprintf(out, "%-6s %9lu %10lu %9lu %9lu %8lu %8lu %8lu %8lu %8lu %9.1f "
+			"%6ld\n", name, s->dirs, s->entries, s->stat_calls,
+			s->avoided_stats, s->cached_dirs, s->batches, s->scanned_files,
+			s->matches, s->steals, (double)s->idle_ns / 1e6,
+			s->peak_pending);
+}
+
+/**
+ * stats_print() - Writes the statistics as a table for people to read.
+ * @out: Where to write them.
+ * @workers: The statistics of each thread.
+ * @num_workers: The number of threads.
+ * @t: The timeline, or NULL.
+ * @wall: The seconds the search took.
+ * @visited: The different directories read when links were followed, 0 when
+ * they were not.
+ */
+void stats_print(FILE *out, const worker_stats *const *workers,
+		int num_workers, const stats_timeline *t, double wall, size_t visited){
+	worker_stats sum = {0};
+	char name[16];
+
+	fprintf(out, "%-6s %9s %10s %9s %9s %8s %8s %8s %8s %8s %9s %6s\n",
+			"Thread", "Dirs", "Entries", "Stats", "Avoided", "Cached",
+			"Batches", "Scanned", "Matches", "Steals", "Idle ms", "Peak");
+	for(int i = 0; i < num_workers; i++){
+		snprintf(name, sizeof(name), "%d", i);
+		print_worker(out, name, workers[i]);
+		stats_add(&sum, workers[i]);
+	}
+	print_worker(out, "Total", &sum);
+
+	if(sum.timed){
+		fprintf(out, "\n%-9s %10s %10s %10s %10s %10s %10s\n", "Latency",
+				"Calls", "Mean us", "p50 us", "p90 us", "p99 us", "Max us");
+		print_latency(out, "open", &sum.open_latency);
+		print_latency(out, "getdents", &sum.read_latency);
+		print_latency(out, "statx", &sum.stat_latency);
+	}
+
+	fprintf(out, "\nWall: %.3f s  Entries/s: %.0f  Dirs/s: %.0f  Max RSS: %ld "
+			"KiB\n", wall, (wall > 0) ? (double)sum.entries / wall : 0.0,
+			(wall > 0) ? (double)sum.dirs / wall : 0.0, max_rss_kb());
+	if(visited > 0){
+		fprintf(out, "Different directories: %zu\n", visited);
+	}
+
+	if((t != NULL) && (t->num_samples > 0)){
+		size_t step = (t->num_samples + PRINTED_SAMPLES - 1) / PRINTED_SAMPLES;
+
+		fprintf(out, "Queued over time (s: dirs):");
+		for(size_t i = 0; i < t->num_samples; i += step){
+			fprintf(out, " %.2f: %ld", t->samples[i].time,
+					t->samples[i].pending);
+		}
+		fprintf(out, "\n");
+	}
+}
+
+/**
+ * print_histogram_json() - Writes a histogram as a JSON object.
+ * @out: Where to write it.
+ * @h: The histogram.
+ */
+static void print_histogram_json(FILE *out, const latency_histogram *h){
+	int last = LATENCY_BUCKETS - 1;
+
+	//The empty buckets of the longest latencies are left out
+	while((last >= 0) && (h->buckets[last] == 0)){
+		last--;
+	}
+
+	fprintf(out, "{\"count\": %lu, \"total_ns\": %llu, \"max_ns\": %llu, "
+			"\"p50_ns\": %llu, \"p90_ns\": %llu, \"p99_ns\": %llu, "
+			"\"log2_ns_buckets\": [", h->count,
+			(unsigned long long)h->total_ns, (unsigned long long)h->max_ns,
+			(unsigned long long)percentile(h, 0.5),
+			(unsigned long long)percentile(h, 0.9),
+			(unsigned long long)percentile(h, 0.99));
+	for(int i = 0; i <= last; i++){
+		fprintf(out, "%s%lu", (i > 0) ? ", " : "", h->buckets[i]);
+	}
+	fprintf(out, "]}");
+}
+
+/**
+ * print_worker_json() - Writes the statistics of a thread as a JSON object.
+ * @out: Where to write it.
+ * @s: The statistics.
+ */
+static void print_worker_json(FILE *out, const worker_stats *s){
+	fprintf(out, "{\"dirs\": %lu, \"entries\": %lu, \"stat_calls\": %lu, "
+			"\"avoided_stats\": %lu, \"cached_dirs\": %lu, \"batches\": %lu, "
+			"\"scanned_files\": %lu, \"matches\": %lu, \"steals\": %lu, "
+			"\"idle_ns\": %llu, \"peak_queue\": %ld", s->dirs, s->entries,
+			s->stat_calls, s->avoided_stats, s->cached_dirs, s->batches,
+			s->scanned_files, s->matches, s->steals,
+			(unsigned long long)s->idle_ns, s->peak_pending);
+	if(s->timed){
+		fprintf(out, ", \"open\": ");
+		print_histogram_json(out, &s->open_latency);
+		fprintf(out, ", \"getdents\": ");
+		print_histogram_json(out, &s->read_latency);
+		fprintf(out, ", \"statx\": ");
+		print_histogram_json(out, &s->stat_latency);
+	}
+	fprintf(out, "}");
+}
+
+/**
+ * stats_print_json() - Writes the statistics as one JSON object.
+ * @out: Where to write them.
+ * @workers: The statistics of each thread.
+ * @num_workers: The number of threads.
+ * @t: The timeline, or NULL.
+ * @wall: The seconds the search took.
+ * @visited: The different directories read when links were followed, 0 when
+ * they were not.
+ */
+void stats_print_json(FILE *out, const worker_stats *const *workers,
+		int num_workers, const stats_timeline *t, double wall,
+		size_t visited){
+	worker_stats sum = {0};
+
+	for(int i = 0; i < num_workers; i++){
+		stats_add(&sum, workers[i]);
+	}
+
+	fprintf(out, "{\"wall_seconds\": %.6f, \"entries_per_second\": %.1f, "
+			"\"dirs_per_second\": %.1f, \"threads\": %d, \"max_rss_kb\": %ld,",
+			wall, (wall > 0) ? (double)sum.entries / wall : 0.0,
+			(wall > 0) ? (double)sum.dirs / wall : 0.0, num_workers,
+			max_rss_kb());
+	if(visited > 0){
+		fprintf(out, " \"different_dirs\": %zu,", visited);
+	}
+	fprintf(out, "\n \"total\": ");
+	print_worker_json(out, &sum);
+
+	fprintf(out, ",\n \"workers\": [");
+	for(int i = 0; i < num_workers; i++){
+		fprintf(out, "%s\n  ", (i > 0) ? "," : "");
+		print_worker_json(out, workers[i]);
+	}
+
+	//Each sample is [seconds, queued, dirs read]
+	fprintf(out, "],\n \"timeline\": [");
+	for(size_t i = 0; (t != NULL) && (i < t->num_samples); i++){
+		fprintf(out, "%s[%.3f, %ld, %lu]", (i > 0) ? ", " : "",
+				t->samples[i].time, t->samples[i].pending,
+				t->samples[i].dirs);
+	}
+	fprintf(out, "]}\n");
+}
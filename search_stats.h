@@ -0,0 +1,138 @@
+#ifndef __SEARCH_STATS_H_
+#define __SEARCH_STATS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Statistics of a search, kept by each thread for itself without any atomic
+ * or lock, so they are cheap enough to always collect. The latencies of the
+ * system calls are only measured when asked for, with one read of the
+ * monotonic clock before and after each call, into histograms whose buckets
+ * are the powers of two of nanoseconds. A timeline of the search, sampled by
+ * one thread, holds how many directories were queued and had been read over
+ * time. At the end the statistics of all the threads are reported as text or
+ * as JSON, together with the peak memory use of the process.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The number of buckets of a histogram. Bucket i holds the latencies from
+// 2^i ns up to 2^(i+1) ns, and the last one all longer ones.
+#define LATENCY_BUCKETS 40
+
+// A histogram of latencies.
+typedef struct latency_histogram{
+	unsigned long count;
+	uint64_t total_ns;
+	uint64_t max_ns;
+	unsigned long buckets[LATENCY_BUCKETS];
+}latency_histogram;
+
+// The statistics of one thread.
+typedef struct worker_stats{
+	bool timed; //If the latencies are measured
+	unsigned long dirs; //Read, or taken from the cache
+	unsigned long entries; //Of the directories read
+	unsigned long stat_calls;
+	unsigned long avoided_stats; //Files classified by d_type alone
+	unsigned long cached_dirs; //Not read thanks to the cache
+	unsigned long batches; //Of entries handed out to other threads
+	unsigned long scanned_files; //Read for their contents
+	unsigned long matches;
+	unsigned long steals; //Directories taken from other threads
+	long peak_pending; //The most directories pending after a push
+	uint64_t idle_ns; //Waiting for a directory to be queued
+	latency_histogram open_latency;
+	latency_histogram read_latency;
+	latency_histogram stat_latency;
+}worker_stats;
+
+// A look at the whole search at one time.
+typedef struct stats_sample{
+	double time; //Seconds since the start
+	long pending; //Directories and batches queued or being checked
+	unsigned long dirs; //Read so far
+}stats_sample;
+
+// The timeline type.
+typedef struct stats_timeline stats_timeline;
+
+/**
+ * stats_clock() - Reads the clock before a call which is timed.
+ * @s: The statistics of the thread.
+ * Returns: The time in ns, or 0 if the latencies are not measured.
+ */
+uint64_t stats_clock(const worker_stats *s);
+
+/**
+ * stats_since() - Gives the time passed since stats_clock().
+ * @start: What stats_clock() returned.
+ * Returns: The time in ns, 0 if start is 0.
+ */
+uint64_t stats_since(uint64_t start);
+
+/**
+ * latency_add() - Adds the time passed since stats_clock() to a histogram.
+ * Does nothing if start is 0.
+ * @h: The histogram.
+ * @start: What stats_clock() returned.
+ */
+void latency_add(latency_histogram *h, uint64_t start);
+
+/**
+ * stats_add() - Adds the statistics of one thread to those of another.
+ * @sum: What to add to.
+ * @s: What to add.
+ */
+void stats_add(worker_stats *sum, const worker_stats *s);
+
+/**
+ * stats_timeline_new() - Create a new and empty timeline.
+ * Returns: A pointer to the new timeline.
+ */
+stats_timeline *stats_timeline_new(void);
+
+/**
+ * stats_timeline_add() - Adds a sample to the end of the timeline. Must only
+ * be called by one thread.
+ * @t: The timeline.
+ * @sample: The sample.
+ */
+void stats_timeline_add(stats_timeline *t, const stats_sample *sample);
+
+/**
+ * stats_timeline_kill() - Removes the timeline.
+ * @t: The timeline which to remove, or NULL.
+ */
+void stats_timeline_kill(stats_timeline *t);
+
+/**
+ * stats_print() - Writes the statistics as a table for people to read.
+ * @out: Where to write them.
+ * @workers: The statistics of each thread.
+ * @num_workers: The number of threads.
+ * @t: The timeline, or NULL.
+ * @wall: The seconds the search took.
+ * @visited: The different directories read when links were followed, 0 when
+ * they were not.
+ */
+void stats_print(FILE *out, const worker_stats *const *workers,
+		int num_workers, const stats_timeline *t, double wall, size_t visited);
+
+/**
+ * stats_print_json() - Writes the statistics as one JSON object.
+ * @out: Where to write them.
+ * @workers: The statistics of each thread.
+ * @num_workers: The number of threads.
+ * @t: The timeline, or NULL.
+ * @wall: The seconds the search took.
+ * @visited: The different directories read when links were followed, 0 when
+ * they were not.
+ */
+void stats_print_json(FILE *out, const worker_stats *const *workers,
+		int num_workers, const stats_timeline *t, double wall,
+		size_t visited);
+
+#endif //__SEARCH_STATS_H_
@@ -0,0 +1,76 @@
+#!/bin/bash
+#test_script
+#Checks the behaviour of mfind found wrong before, on a small tree made in a
+#temporary directory. Prints each case which fails and exits with the number
+#of them.
+#Usage: ./test_script.sh
+
+if [[ ! -x ./mfind ]]; then
+	echo "Build mfind first, with make test" >&2
+	exit 1
+fi
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+failed=0
+
+mkdir -p "$dir/tree/sub"
+echo "a needle here" > "$dir/tree/sub/file.txt"
+ln -s sub/file.txt "$dir/tree/link.txt"
+
+#A path longer than PATH_MAX, made one level at a time
+deep=$dir/deep
+mkdir "$deep"
+(
+	cd "$deep" || exit 1
+	for ((i = 0; i < 500; i++)); do
+		mkdir abcdefghij && cd abcdefghij || exit 1
+	done
+	touch target.txt
+)
+deep_target=$deep$(printf '/abcdefghij%.0s' {1..500})/target.txt
+
+#expect_fail description mfind arguments...
+#Checks that mfind exits with a failure and prints nothing on stdout.
+expect_fail() {
+	local what=$1
+	shift
+	if out=$(./mfind "$@" 2> /dev/null) || [[ -n $out ]]; then
+		echo "FAIL: $what" >&2
+		failed=$((failed + 1))
+	fi
+}
+
+#expect_output description expected mfind arguments...
+#Checks that mfind succeeds and prints exactly the expected lines, in any
+#order.
+expect_output() {
+	local what=$1 expected=$2
+	shift 2
+	if ! out=$(./mfind "$@" 2> /dev/null) ||
+			[[ $(sort <<< "$out") != "$expected" ]]; then
+		echo "FAIL: $what" >&2
+		failed=$((failed + 1))
+	fi
+}
+
+#The number of threads
+expect_fail "-p with trailing characters" -p 3x "$dir/tree" file.txt
+expect_fail "-p without digits" -p x "$dir/tree" file.txt
+expect_output "-p with a number" "$dir/tree/sub/file.txt" \
+		-p 3 "$dir/tree" file.txt
+
+#The contents of the files links point to
+expect_output "-grep through a followed link" \
+		"$dir/tree/link.txt"$'\n'"$dir/tree/sub/file.txt" \
+		-L -grep needle "$dir/tree" '*'
+expect_output "-grep does not follow links without -L" \
+		"$dir/tree/sub/file.txt" -grep needle "$dir/tree" '*'
+
+#Directories whose paths are longer than PATH_MAX
+for args in "-p 1" "-p 4" "-p 4 -u 0"; do
+	expect_output "a path longer than PATH_MAX with $args" "$deep_target" \
+			$args "$deep" target.txt
+done
+
+exit $failed
@@ -0,0 +1,329 @@
+#include "uring.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && !defined(MFIND_NO_IO_URING)
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+/*
+ * A minimal io_uring ring, set up with the raw system calls so no library is
+ * needed. A ring may only be used by one thread. Requests are prepared with
+ * uring_prep_openat() and uring_prep_statx(), sent to the kernel with
+ * uring_submit_and_wait() and their results taken with uring_next_completion().
+ * Where io_uring is not available uring_new() fails, and the caller should
+ * fall back to the normal system calls.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+#ifdef HAVE_IO_URING
+
+// The ring type. The pointers point into the rings shared with the kernel.
+struct uring{
+	int fd;
+
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned sq_mask;
+	unsigned sq_entries;
+	unsigned *sq_array;
+	struct io_uring_sqe *sqes;
+	unsigned sq_local_tail; //Prepared but not yet made visible to the kernel.
+	unsigned to_submit;
+
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned cq_mask;
+	struct io_uring_cqe *cqes;
+
+	void *sq_ring;
+	size_t sq_ring_size;
+	void *cq_ring;
+	size_t cq_ring_size;
+	size_t sqes_size;
+};
+
+/**
+ * uring_new() - Create a new ring.
+ * @entries: The number of requests which can be prepared at once.
+ * Returns: A pointer to the new ring or NULL with errno set if io_uring can
+ * not be used.
+ */
+uring *uring_new(unsigned entries){
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+
+	int fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+	if(fd < 0){
+		return NULL;
+	}
+
+	uring *r = calloc(1, sizeof(*r));
+	if(r == NULL){
+		close(fd);
+		return NULL;
+	}
+	r->fd = fd;
+
+	r->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	r->cq_ring_size = p.cq_off.cqes +
+			p.cq_entries * sizeof(struct io_uring_cqe);
+	if(p.features & IORING_FEAT_SINGLE_MMAP){
+		if(r->cq_ring_size > r->sq_ring_size){
+			r->sq_ring_size = r->cq_ring_size;
+		}
+		r->cq_ring_size = r->sq_ring_size;
+	}
+
+	r->sq_ring = mmap(NULL, r->sq_ring_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if(r->sq_ring == MAP_FAILED){
+		goto fail;
+	}
+
+	if(p.features & IORING_FEAT_SINGLE_MMAP){
+		r->cq_ring = r->sq_ring;
+	}
+	else{
+		r->cq_ring = mmap(NULL, r->cq_ring_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if(r->cq_ring == MAP_FAILED){
+			r->cq_ring = NULL;
+			goto fail;
+		}
+	}
+
+	r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if(r->sqes == MAP_FAILED){
+		r->sqes = NULL;
+		goto fail;
+	}
+
+	char *sq = r->sq_ring;
+	r->sq_head = (unsigned *)(sq + p.sq_off.head);
+	r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+	r->sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+	r->sq_entries = p.sq_entries;
+	r->sq_array = (unsigned *)(sq + p.sq_off.array);
+	r->sq_local_tail = *r->sq_tail;
+
+	char *cq = r->cq_ring;
+	r->cq_head = (unsigned *)(cq + p.cq_off.head);
+	r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+	r->cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+	return r;
+
+fail:
+	{
+		int saved_errno = errno;
+		uring_kill(r);
+		errno = saved_errno;
+	}
+
+	return NULL;
+}
+
+/**
+ * get_sqe() - Takes the next free submission entry of the ring and clears it.
+ * @r: The ring.
+ * Returns: The entry or NULL if the ring is full.
+ */
+static struct io_uring_sqe *get_sqe(uring *r){
+	unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+
+	if(r->sq_local_tail - head >= r->sq_entries){
+		return NULL;
+	}
+
+	unsigned index = r->sq_local_tail & r->sq_mask;
+	struct io_uring_sqe *sqe = &r->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	r->sq_array[index] = index;
+	r->sq_local_tail++;
+	r->to_submit++;
+
+	return sqe;
+}
+
+/**
+ * uring_prep_openat() - Prepares a request which opens a file like openat().
+ * @r: The ring.
+ * @dir_fd: The directory the path is relative to, or AT_FDCWD.
+ * @path: The path, which must stay valid until the request completes.
+ * @flags: The flags of openat().
+ * @user_data: A value which is handed back with the result.
+ * Returns: true if prepared, false if the ring is full.
+ */
+bool uring_prep_openat(uring *r, int dir_fd, const char *path, int flags,
+		uint64_t user_data){
+	struct io_uring_sqe *sqe = get_sqe(r);
+	if(sqe == NULL){
+		return false;
+	}
+
+	sqe->opcode = IORING_OP_OPENAT;
+	sqe->fd = dir_fd;
+	sqe->addr = (uint64_t)(uintptr_t)path;
+	sqe->open_flags = (uint32_t)flags;
+	sqe->user_data = user_data;
+
+	return true;
+}
+
+/**
+ * uring_prep_statx() - Prepares a request which examines a file like statx().
+ * @r: The ring.
+ * @dir_fd: The directory the path is relative to, or AT_FDCWD.
+ * @path: The path, which must stay valid until the request completes.
+ * @flags: The flags of statx(), for example AT_SYMLINK_NOFOLLOW.
+ * @mask: The fields which are wanted, for example STATX_TYPE.
+ * @buffer: A struct statx which must stay valid until the request completes.
+ * @user_data: A value which is handed back with the result.
+ * Returns: true if prepared, false if the ring is full.
+ */
+bool uring_prep_statx(uring *r, int dir_fd, const char *path, int flags,
+		unsigned mask, void *buffer, uint64_t user_data){
+	struct io_uring_sqe *sqe = get_sqe(r);
+	if(sqe == NULL){
+		return false;
+	}
+
+	sqe->opcode = IORING_OP_STATX;
+	sqe->fd = dir_fd;
+	sqe->addr = (uint64_t)(uintptr_t)path;
+	sqe->len = mask;
+	sqe->off = (uint64_t)(uintptr_t)buffer;
+	sqe->statx_flags = (uint32_t)flags;
+	sqe->user_data = user_data;
+
+	return true;
+}
+
+/**
+ * uring_submit_and_wait() - Sends the prepared requests to the kernel and
+ * waits for results.
+ * @r: The ring.
+ * @wait_nr: The number of results to wait for, 0 to not wait.
+ * Returns: 0 on success, -1 on failure with errno set.
+ */
+int uring_submit_and_wait(uring *r, unsigned wait_nr){
+	__atomic_store_n(r->sq_tail, r->sq_local_tail, __ATOMIC_RELEASE);
+
+	while((r->to_submit > 0) || (wait_nr > 0)){
+		long ret = syscall(__NR_io_uring_enter, r->fd, r->to_submit, wait_nr,
+				(wait_nr > 0) ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+		if(ret < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			return -1;
+		}
+
+		r->to_submit -= (unsigned)ret;
+		wait_nr = 0;
+	}
+
+	return 0;
+}
+
+/**
+ * uring_next_completion() - Takes the next result from the ring, without
+ * waiting.
+ * @r: The ring.
+ * @c: Filled in with the result.
+ * Returns: true if a result was taken, false if there is none.
+ */
+bool uring_next_completion(uring *r, uring_completion *c){
+	unsigned head = *r->cq_head;
+	unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+
+	if(head == tail){
+		return false;
+	}
+
+	struct io_uring_cqe *cqe = &r->cqes[head & r->cq_mask];
+	c->user_data = cqe->user_data;
+	c->res = cqe->res;
+	__atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/**
+ * uring_kill() - Removes the ring.
+ * @r: The ring which to remove.
+ */
+void uring_kill(uring *r){
+	if(r->sqes != NULL){
+		munmap(r->sqes, r->sqes_size);
+	}
+	if((r->cq_ring != NULL) && (r->cq_ring != r->sq_ring)){
+		munmap(r->cq_ring, r->cq_ring_size);
+	}
+	if((r->sq_ring != NULL) && (r->sq_ring != MAP_FAILED)){
+		munmap(r->sq_ring, r->sq_ring_size);
+	}
+
+	close(r->fd);
+	free(r);
+}
+
+#else //No io_uring, every ring fails to set up.
+
+uring *uring_new(unsigned entries){
+	(void)entries;
+	errno = ENOSYS;
+
+	return NULL;
+}
+
+bool uring_prep_openat(uring *r, int dir_fd, const char *path, int flags,
+		uint64_t user_data){
+	(void)r; (void)dir_fd; (void)path; (void)flags; (void)user_data;
+
+	return false;
+}
+
+bool uring_prep_statx(uring *r, int dir_fd, const char *path, int flags,
+		unsigned mask, void *buffer, uint64_t user_data){
+	(void)r; (void)dir_fd; (void)path; (void)flags; (void)mask; (void)buffer;
+	(void)user_data;
+
+	return false;
+}
+
+int uring_submit_and_wait(uring *r, unsigned wait_nr){
+	(void)r; (void)wait_nr;
+	errno = ENOSYS;
+
+	return -1;
+}
+
+bool uring_next_completion(uring *r, uring_completion *c){
+	(void)r; (void)c;
+
+	return false;
+}
+
+void uring_kill(uring *r){
+	(void)r;
+}
+
+#endif //HAVE_IO_URING
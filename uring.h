@@ -0,0 +1,85 @@
+#ifndef __URING_H_
+#define __URING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * A minimal io_uring ring, set up with the raw system calls so no library is
+ * needed. A ring may only be used by one thread. Requests are prepared with
+ * uring_prep_openat() and uring_prep_statx(), sent to the kernel with
+ * uring_submit_and_wait() and their results taken with uring_next_completion().
+ * Where io_uring is not available uring_new() fails, and the caller should
+ * fall back to the normal system calls.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The ring type.
+typedef struct uring uring;
+
+// The result of a request, res is negative errno on failure.
+typedef struct uring_completion{
+	uint64_t user_data;
+	int32_t res;
+}uring_completion;
+
+/**
+ * uring_new() - Create a new ring.
+ * @entries: The number of requests which can be prepared at once.
+ * Returns: A pointer to the new ring or NULL with errno set if io_uring can
+ * not be used.
+ */
+uring *uring_new(unsigned entries);
+
+/**
+ * uring_prep_openat() - Prepares a request which opens a file like openat().
+ * @r: The ring.
+ * @dir_fd: The directory the path is relative to, or AT_FDCWD.
+ * @path: The path, which must stay valid until the request completes.
+ * @flags: The flags of openat().
+ * @user_data: A value which is handed back with the result.
+ * Returns: true if prepared, false if the ring is full.
+ */
+bool uring_prep_openat(uring *r, int dir_fd, const char *path, int flags,
+		uint64_t user_data);
+
+/**
+ * uring_prep_statx() - Prepares a request which examines a file like statx().
+ * @r: The ring.
+ * @dir_fd: The directory the path is relative to, or AT_FDCWD.
+ * @path: The path, which must stay valid until the request completes.
+ * @flags: The flags of statx(), for example AT_SYMLINK_NOFOLLOW.
+ * @mask: The fields which are wanted, for example STATX_TYPE.
+ * @buffer: A struct statx which must stay valid until the request completes.
+ * @user_data: A value which is handed back with the result.
+ * Returns: true if prepared, false if the ring is full.
+ */
+bool uring_prep_statx(uring *r, int dir_fd, const char *path, int flags,
+		unsigned mask, void *buffer, uint64_t user_data);
+
+/**
+ * uring_submit_and_wait() - Sends the prepared requests to the kernel and
+ * waits for results.
+ * @r: The ring.
+ * @wait_nr: The number of results to wait for, 0 to not wait.
+ * Returns: 0 on success, -1 on failure with errno set.
+ */
+int uring_submit_and_wait(uring *r, unsigned wait_nr);
+
+/**
+ * uring_next_completion() - Takes the next result from the ring, without
+ * waiting.
+ * @r: The ring.
+ * @c: Filled in with the result.
+ * Returns: true if a result was taken, false if there is none.
+ */
+bool uring_next_completion(uring *r, uring_completion *c);
+
+/**
+ * uring_kill() - Removes the ring.
+ * @r: The ring which to remove.
+ */
+void uring_kill(uring *r);
+
+#endif //__URING_H_
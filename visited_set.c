@@ -0,0 +1,361 @@
+#include "visited_set.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * A set of the directories visited by a search following symbolic links, by
+ * their device and inode numbers, which all the threads add to at once
+ * without any lock. A directory reached again, through a link, a bind mount
+ * or a loop, is found in the set and not searched again.
+ *
+ * Each directory is kept by its whole device and inode numbers, so no two
+ * directories are ever taken for the same one, on any number of devices. The
+ * directories are kept in a split-ordered list, one linked list sorted on the
+ * bit-reversed hashes of their numbers, which the buckets of the hash table
+ * point into. Growing the table only adds buckets, pointing into the same
+ * list, so nothing is ever moved or locked. A directory takes a node of 32
+ * bytes, allocated in large chunks, and the buckets and their nodes add up to
+ * 10 more, so ten million directories take about 450 MB.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The hashes are below 2^63, so the order of a directory always has its
+// lowest bit set and never equals that of a bucket.
+#define KEY_MASK ((UINT64_C(1) << 63) - 1)
+
+// The buckets of the first segment, which holds buckets 0 to 2^FIRST_BITS - 1.
+// Segment i > 0 holds buckets 2^(FIRST_BITS + i - 1) to 2^(FIRST_BITS + i) - 1.
+#define FIRST_BITS 10
+#define MAX_SEGMENTS (64 - FIRST_BITS)
+
+// The table grows when there are this many directories per bucket.
+#define MAX_LOAD 4
+
+// The number of nodes allocated at once.
+#define CHUNK_NODES (64 * 1024)
+
+// A node of the list, a directory or the start of a bucket, whose numbers
+// are 0. Sorted on order, those of the same order in no particular order.
+struct node{
+	uint64_t order;
+	uint64_t dev;
+	uint64_t ino;
+	_Atomic(struct node *) next;
+};
+
+// A block of nodes, handed out from the front.
+struct chunk{
+	struct chunk *older; //Kept for freeing the set
+	atomic_size_t used;
+	struct node nodes[CHUNK_NODES];
+};
+
+// The set type.
+struct visited_set{
+	struct node head; //The start of bucket 0, and of the list
+	atomic_size_t num_buckets; //Always a power of two
+	atomic_size_t size;
+	_Atomic(struct node *) *_Atomic segments[MAX_SEGMENTS];
+	_Atomic(struct chunk *) chunk;
+};
+
+/**
+ * mix() - Mixes the bits of a number, a bijection on the numbers below 2^63.
+ * @x: The number.
+ * Returns: The mixed number.
+ */
+static uint64_t mix(uint64_t x){
+	x ^= x >> 31;
+	x = (x * UINT64_C(0x7fb5d329728ea185)) & KEY_MASK;
+	x ^= x >> 27;
+	x = (x * UINT64_C(0x81dadef4bc2dd44d)) & KEY_MASK;
+	x ^= x >> 33;
+
+	return x;
+}
+
+/**
+ * hash_dir() - Hashes the numbers of a directory. Different directories may
+ * get the same hash, which only makes them share a place in the list.
+ * @dev: The device holding the directory.
+ * @ino: The inode number of the directory.
+ * Returns: The hash, below 2^63.
+ */
+static uint64_t hash_dir(uint64_t dev, uint64_t ino){
+	uint64_t x = ino + UINT64_C(0x9e3779b97f4a7c15) * mix(dev & KEY_MASK);
+
+	return mix((x ^ (x >> 63)) & KEY_MASK);
+}
+
+/**
+ * reverse_bits() - Reverses the order of the bits of a number.
+ * @x: The number.
+ * Returns: The number with bit 0 as bit 63, bit 1 as bit 62 and so on.
+ */
+static uint64_t reverse_bits(uint64_t x){
+	x = ((x >> 1) & UINT64_C(0x5555555555555555)) |
+			((x & UINT64_C(0x5555555555555555)) << 1);
+	x = ((x >> 2) & UINT64_C(0x3333333333333333)) |
+			((x & UINT64_C(0x3333333333333333)) << 2);
+	x = ((x >> 4) & UINT64_C(0x0f0f0f0f0f0f0f0f)) |
+			((x & UINT64_C(0x0f0f0f0f0f0f0f0f)) << 4);
+
+	return __builtin_bswap64(x);
+}
+
+/**
+ * node_new() - Takes a node from the current chunk, or from a new chunk when
+ * it is used up.
+ * @v: The set.
+ * @order: The order of the node.
+ * @dev: The device of the directory of the node.
+ * @ino: The inode number of the directory of the node.
+ * Returns: A pointer to the node.
+ */
+static struct node *node_new(visited_set *v, uint64_t order, uint64_t dev,
+		uint64_t ino){
+	struct chunk *c = atomic_load_explicit(&v->chunk, memory_order_acquire);
+	struct node *n;
+
+	while(true){
+		size_t i = atomic_fetch_add_explicit(&c->used, 1,
+				memory_order_relaxed);
+
+		if(i < CHUNK_NODES){
+			n = &c->nodes[i];
+			break;
+		}
+
+		struct chunk *fresh = malloc(sizeof(*fresh));
+		if(fresh == NULL){
+			perror("visited_set.c");
+			exit(errno);
+		}
+		fresh->older = c;
+		atomic_init(&fresh->used, 1);
+		if(atomic_compare_exchange_strong_explicit(&v->chunk, &c, fresh,
+				memory_order_acq_rel, memory_order_acquire)){
+			n = &fresh->nodes[0];
+			break;
+		}
+		//Another thread added a chunk first, c is now that one
+		free(fresh);
+	}
+
+	n->order = order;
+	n->dev = dev;
+	n->ino = ino;
+	atomic_init(&n->next, NULL);
+
+	return n;
+}
+
+/**
+ * list_insert() - Adds a node to the list, after a node which comes before
+ * it, unless a node of the same order and numbers is in the list already. A
+ * new node goes after all those of its order, which is where any other
+ * thread adding the same one looks for it. The node is only taken from the
+ * set when it is about to be added, so looking for directories already in
+ * the set uses no memory.
+ * @v: The set.
+ * @start: A node of the list ordered before the new node.
+ * @order: The order of the new node.
+ * @dev: The device of the directory of the new node.
+ * @ino: The inode number of the directory of the new node.
+ * @added: Set to true if the node was added, else to false.
+ * Returns: The node of the order and numbers in the list.
+ */
+static struct node *list_insert(visited_set *v, struct node *start,
+		uint64_t order, uint64_t dev, uint64_t ino, bool *added){
+	struct node *n = NULL;
+	struct node *prev = start;
+	struct node *cur = atomic_load_explicit(&prev->next, memory_order_acquire);
+
+	while(true){
+		while((cur != NULL) && (cur->order <= order)){
+			if((cur->order == order) && (cur->dev == dev) &&
+					(cur->ino == ino)){
+				//A node taken before another thread added it is left unused
+				*added = false;
+				return cur;
+			}
+			prev = cur;
+			cur = atomic_load_explicit(&prev->next, memory_order_acquire);
+		}
+
+		if(n == NULL){
+			n = node_new(v, order, dev, ino);
+		}
+		atomic_store_explicit(&n->next, cur, memory_order_relaxed);
+
+		//Nodes are never removed, so on failure the search goes on from prev
+		if(atomic_compare_exchange_weak_explicit(&prev->next, &cur, n,
+				memory_order_release, memory_order_acquire)){
+			*added = true;
+			return n;
+		}
+	}
+}
+
+/**
+ * bucket_slot() - Finds the place of a bucket in the segments, allocating
+ * its segment if it has not been.
+ * @v: The set.
+ * @bucket: The number of the bucket.
+ * Returns: The place holding the start of the bucket.
+ */
+static _Atomic(struct node *) *bucket_slot(visited_set *v, size_t bucket){
+	size_t seg = 0;
+	size_t index = bucket;
+	size_t seg_size = (size_t)1 << FIRST_BITS;
+
+	if(bucket >= seg_size){
+		int high = 63 - __builtin_clzll(bucket);
+
+		seg = high - FIRST_BITS + 1;
+		seg_size = (size_t)1 << high;
+		index = bucket - seg_size;
+	}
+
+	_Atomic(struct node *) *nodes = atomic_load_explicit(&v->segments[seg],
+			memory_order_acquire);
+	if(nodes == NULL){
+		_Atomic(struct node *) *fresh = calloc(seg_size, sizeof(*fresh));
+		if(fresh == NULL){
+			perror("visited_set.c");
+			exit(errno);
+		}
+		if(atomic_compare_exchange_strong_explicit(&v->segments[seg], &nodes,
+				fresh, memory_order_acq_rel, memory_order_acquire)){
+			nodes = fresh;
+		}
+		else{
+			free(fresh);
+		}
+	}
+
+	return &nodes[index];
+}
+
+/**
+ * bucket_start() - Gives the node starting a bucket, adding it to the list
+ * first if no thread has yet. A new bucket starts within its parent, the
+ * bucket whose directories were split between the two when the table grew.
+ * @v: The set.
+ * @bucket: The number of the bucket.
+ * Returns: The node starting the bucket.
+ */
+static struct node *bucket_start(visited_set *v, size_t bucket){
+	if(bucket == 0){
+		return &v->head;
+	}
+
+	_Atomic(struct node *) *slot = bucket_slot(v, bucket);
+	struct node *start = atomic_load_explicit(slot, memory_order_acquire);
+	if(start != NULL){
+		return start;
+	}
+
+	size_t parent = bucket & ~((size_t)1 << (63 - __builtin_clzll(bucket)));
+	bool added;
+
+	start = list_insert(v, bucket_start(v, parent), reverse_bits(bucket), 0, 0,
+			&added);
+	atomic_store_explicit(slot, start, memory_order_release);
+
+	return start;
+}
+
+/**
+ * visited_set_new() - Create a new and empty set.
+ * Returns: A pointer to the new set.
+ */
+visited_set *visited_set_new(void){
+	visited_set *v = calloc(1, sizeof(*v));
+	struct chunk *c = malloc(sizeof(*c));
+	if((v == NULL) || (c == NULL)){
+		perror("visited_set.c");
+		exit(errno);
+	}
+
+	c->older = NULL;
+	atomic_init(&c->used, 0);
+	atomic_init(&v->chunk, c);
+	atomic_init(&v->head.next, NULL);
+	atomic_init(&v->num_buckets, 2);
+	atomic_init(&v->size, 0);
+
+	return v;
+}
+
+/**
+ * visited_set_add() - Adds a directory to the set, if it is not in it yet.
+ * May be called by any number of threads at once.
+ * @v: The set.
+ * @dev: The device holding the directory.
+ * @ino: The inode number of the directory.
+ * Returns: true if the directory was added, false if it was already in the
+ * set. Of the threads adding the same directory only one gets true.
+ */
+bool visited_set_add(visited_set *v, dev_t dev, ino_t ino){
+	uint64_t hash = hash_dir((uint64_t)dev, (uint64_t)ino);
+	size_t num_buckets = atomic_load_explicit(&v->num_buckets,
+			memory_order_acquire);
+	struct node *start = bucket_start(v, hash & (num_buckets - 1));
+	bool added;
+
+	list_insert(v, start, reverse_bits(hash) | 1, (uint64_t)dev,
+			(uint64_t)ino, &added);
+	if(!added){
+		return false;
+	}
+
+	size_t size = atomic_fetch_add_explicit(&v->size, 1,
+			memory_order_relaxed) + 1;
+	if((size > MAX_LOAD * num_buckets) &&
+			(num_buckets < ((size_t)1 << (FIRST_BITS + MAX_SEGMENTS - 1)))){
+		atomic_compare_exchange_strong_explicit(&v->num_buckets,
+				&num_buckets, num_buckets * 2, memory_order_acq_rel,
+				memory_order_relaxed);
+	}
+
+	return true;
+}
+
+/**
+ * visited_set_size() - Gives the number of directories in the set.
+ * @v: The set.
+ * Returns: The number of directories.
+ */
+size_t visited_set_size(const visited_set *v){
+	return atomic_load_explicit(&v->size, memory_order_relaxed);
+}
+
+/**
+ * visited_set_kill() - Removes the set. No thread may be adding to it.
+ * @v: The set which to remove, or NULL.
+ */
+void visited_set_kill(visited_set *v){
+	if(v == NULL){
+		return;
+	}
+
+	for(int i = 0; i < MAX_SEGMENTS; i++){
+		free(atomic_load_explicit(&v->segments[i], memory_order_relaxed));
+	}
+
+	struct chunk *c = atomic_load_explicit(&v->chunk, memory_order_relaxed);
+	while(c != NULL){
+		struct chunk *older = c->older;
+
+		free(c);
+		c = older;
+	}
+
+	free(v);
+}
@@ -0,0 +1,59 @@
+#ifndef __VISITED_SET_H_
+#define __VISITED_SET_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+ * A set of the directories visited by a search following symbolic links, by
+ * their device and inode numbers, which all the threads add to at once
+ * without any lock. A directory reached again, through a link, a bind mount
+ * or a loop, is found in the set and not searched again.
+ *
+ * Each directory is kept by its whole device and inode numbers, so no two
+ * directories are ever taken for the same one, on any number of devices. The
+ * directories are kept in a split-ordered list, one linked list sorted on the
+ * bit-reversed hashes of their numbers, which the buckets of the hash table
+ * point into. Growing the table only adds buckets, pointing into the same
+ * list, so nothing is ever moved or locked. A directory takes a node of 32
+ * bytes, allocated in large chunks, and the buckets and their nodes add up to
+ * 10 more, so ten million directories take about 450 MB.
+ *
+ * Authors: Bram Coenen (brco0009@student.umu.se)
+ */
+
+// The set type.
+typedef struct visited_set visited_set;
+
+/**
+ * visited_set_new() - Create a new and empty set.
+ * Returns: A pointer to the new set.
+ */
+visited_set *visited_set_new(void);
+
+/**
+ * visited_set_add() - Adds a directory to the set, if it is not in it yet.
+ * May be called by any number of threads at once.
+ * @v: The set.
+ * @dev: The device holding the directory.
+ * @ino: The inode number of the directory.
+ * Returns: true if the directory was added, false if it was already in the
+ * set. Of the threads adding the same directory only one gets true.
+ */
+bool visited_set_add(visited_set *v, dev_t dev, ino_t ino);
+
+/**
+ * visited_set_size() - Gives the number of directories in the set.
+ * @v: The set.
+ * Returns: The number of directories.
+ */
+size_t visited_set_size(const visited_set *v);
+
+/**
+ * visited_set_kill() - Removes the set. No thread may be adding to it.
+ * @v: The set which to remove, or NULL.
+ */
+void visited_set_kill(visited_set *v);
+
+#endif //__VISITED_SET_H_